@@ -0,0 +1,95 @@
+#include "BlueNRG1_AdvScheduler.h"
+#include "BlueNRG1_ble.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "bluenrg1_stack.h"
+#ifdef __cplusplus
+}
+#endif
+
+BlueNRG1_AdvScheduler::BlueNRG1_AdvScheduler() :
+    fastInterval(GapAdvertisingParams::MSEC_TO_ADVERTISEMENT_DURATION_UNITS(BLE_ADV_FAST_INTERVAL_MS)),
+    fastWindowMs(BLE_ADV_FAST_WINDOW_MS),
+    slowInterval(0),
+    phase(ADV_PHASE_IDLE),
+    phaseStart(0)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+void BlueNRG1_AdvScheduler::setFastPhase(uint16_t intervalMs, uint32_t windowMs)
+{
+    fastInterval = GapAdvertisingParams::MSEC_TO_ADVERTISEMENT_DURATION_UNITS(intervalMs);
+    fastWindowMs = windowMs;
+}
+
+/* Add the time elapsed since the last call to the current phase */
+void BlueNRG1_AdvScheduler::account(void)
+{
+    uint32_t now     = HAL_VTimerGetCurrentTime_sysT32();
+    int32_t  elapsed = HAL_VTimerDiff_ms_sysT32(now, phaseStart);
+
+    if (elapsed > 0) {
+        if (phase == ADV_PHASE_FAST) {
+            stats.fastTimeMs += elapsed;
+        } else if (phase == ADV_PHASE_SLOW) {
+            stats.slowTimeMs += elapsed;
+        }
+    }
+    phaseStart = now;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start advertising, in the fast phase when requested, enabled
+            and faster than what the application asked for
+
+    @returns    The advertising interval, in 0.625 ms units
+*/
+/**************************************************************************/
+uint16_t BlueNRG1_AdvScheduler::begin(uint16_t interval, bool fastPhase)
+{
+    account();
+    HAL_VTimer_Stop(BLUENRG1_VTIMER_ADV_SCHEDULER);
+    slowInterval = interval;
+
+    if (!fastPhase || (fastWindowMs == 0) || (fastInterval >= slowInterval) ||
+        (HAL_VTimerStart_ms(BLUENRG1_VTIMER_ADV_SCHEDULER, fastWindowMs) != 0)) {
+        phase = ADV_PHASE_SLOW;
+        return slowInterval;
+    }
+
+    phase = ADV_PHASE_FAST;
+    stats.fastPhases++;
+    return fastInterval;
+}
+
+uint16_t BlueNRG1_AdvScheduler::expire(void)
+{
+    account();
+    phase = ADV_PHASE_SLOW;
+    return slowInterval;
+}
+
+void BlueNRG1_AdvScheduler::end(bool connected)
+{
+    account();
+    HAL_VTimer_Stop(BLUENRG1_VTIMER_ADV_SCHEDULER);
+
+    if (connected) {
+        if (phase == ADV_PHASE_FAST) {
+            stats.fastConnections++;
+        } else if (phase == ADV_PHASE_SLOW) {
+            stats.slowConnections++;
+        }
+    }
+    phase = ADV_PHASE_IDLE;
+}
+
+const BlueNRG1_AdvScheduler::Stats_t &BlueNRG1_AdvScheduler::getStats(void)
+{
+    account();
+    return stats;
+}
@@ -0,0 +1,76 @@
+#ifndef __BLUENRG1_ADVSCHEDULER_H__
+#define __BLUENRG1_ADVSCHEDULER_H__
+
+#include <stdint.h>
+
+/* Fast advertising interval used right after boot or disconnection */
+#ifndef BLE_ADV_FAST_INTERVAL_MS
+#define BLE_ADV_FAST_INTERVAL_MS    30
+#endif
+
+/* Duration of the fast phase, 0 disables it */
+#ifndef BLE_ADV_FAST_WINDOW_MS
+#define BLE_ADV_FAST_WINDOW_MS      30000
+#endif
+
+/**************************************************************************/
+/*!
+    \brief
+    Fast/slow advertising policy.
+
+    Every startAdvertising() begins with a fast phase at fastInterval for
+    fastWindowMs, then falls back to the interval requested by the
+    application; a restart while a peer is already connected, where the
+    fast phase was spent finding it, goes straight to the slow phase.
+    The window is timed with a stack virtual timer so it keeps running
+    while the core sleeps. Time spent in each phase is accumulated for
+    the power budget.
+*/
+/**************************************************************************/
+class BlueNRG1_AdvScheduler
+{
+public:
+    typedef enum {
+        ADV_PHASE_IDLE,   /**< Not advertising. */
+        ADV_PHASE_FAST,   /**< Fast interval, the window is running. */
+        ADV_PHASE_SLOW    /**< Application interval. */
+    } Phase_t;
+
+    typedef struct {
+        uint32_t fastTimeMs;        /**< Time spent in the fast phase. */
+        uint32_t slowTimeMs;        /**< Time spent in the slow phase. */
+        uint32_t fastPhases;        /**< Fast phases started. */
+        uint32_t fastConnections;   /**< Connections established in the fast phase. */
+        uint32_t slowConnections;   /**< Connections established in the slow phase. */
+    } Stats_t;
+
+    BlueNRG1_AdvScheduler();
+
+    /* Interval in ms, window in ms (0 disables the fast phase) */
+    void     setFastPhase(uint16_t intervalMs, uint32_t windowMs);
+
+    /* Start a phase, the slow one unless fastPhase, return the interval to
+       advertise with (0.625 ms units) */
+    uint16_t begin(uint16_t slowInterval, bool fastPhase = true);
+    /* Fast window elapsed, return the interval of the slow phase */
+    uint16_t expire(void);
+    /* Advertising stopped, on connection or on request */
+    void     end(bool connected);
+
+    Phase_t  getPhase(void) const {
+        return phase;
+    }
+    const Stats_t &getStats(void);
+
+private:
+    void     account(void);
+
+    uint16_t fastInterval;   /**< 0.625 ms units. */
+    uint32_t fastWindowMs;
+    uint16_t slowInterval;   /**< 0.625 ms units. */
+    Phase_t  phase;
+    uint32_t phaseStart;     /**< Stack time of the last accounting. */
+    Stats_t  stats;
+};
+
+#endif //__BLUENRG1_ADVSCHEDULER_H__
@@ -0,0 +1,340 @@
+#include "BlueNRG1_ConnManager.h"
+#include "BlueNRG1_Events.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_Trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_events.h"
+#include "bluenrg1_stack.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* Result of aci_l2cap_connection_update_resp_event */
+#define L2CAP_CONN_PARAM_ACCEPTED   0x0000
+
+/* Ranges of the connection parameters, Core spec Vol 6 Part B 4.5.1 */
+#define CONN_LATENCY_MAX            0x01F3
+#define CONN_TIMEOUT_MIN            0x000A
+#define CONN_TIMEOUT_MAX            0x0C80
+
+BlueNRG1_ConnManager::BlueNRG1_ConnManager() :
+    enabled(true),
+    running(false)
+{
+}
+
+void BlueNRG1_ConnManager::enable(bool enable)
+{
+    enabled = enable;
+    onLinksChanged();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Parameters in use on a link and why they were requested
+
+    @returns    BLE_ERROR_INVALID_PARAM for an unknown link
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_ConnManager::getStatus(Gap::Handle_t handle, Status_t *status)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    status->interval = link->params.maxConnectionInterval;
+    status->latency  = link->params.slaveLatency;
+    status->timeout  = link->params.connectionSupervisionTimeout;
+    status->profile  = (Profile_t)link->connUpdate.profile;
+    status->reason   = (Reason_t)link->connUpdate.reason;
+    status->pending  = link->connUpdate.pending;
+    status->rate     = link->connUpdate.rate;
+    status->rejected = link->connUpdate.rejected;
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_ConnManager::onLinksChanged(void)
+{
+    bool needed = enabled && (BlueNRG1_Links::getInstance().getCount() > 0);
+
+    if (needed && !running) {
+        running = (HAL_VTimerStart_ms(BLUENRG1_VTIMER_CONN_MANAGER, BLE_CONN_WINDOW_MS) == 0);
+    } else if (!needed && running) {
+        HAL_VTimer_Stop(BLUENRG1_VTIMER_CONN_MANAGER);
+        running = false;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Send the parameters of a profile to the peer
+
+    @returns    The BlueNRG status, the request is tried again on the next
+                window when the stack could not send it
+*/
+/**************************************************************************/
+uint8_t BlueNRG1_ConnManager::request(BlueNRG1_Link_t *link, Profile_t profile, Reason_t reason)
+{
+    uint16_t intervalMin;
+    uint16_t intervalMax;
+    uint16_t latency;
+    uint16_t timeout = BLE_CONN_SUPERVISION_TIMEOUT_MS / 10;
+    tBleStatus ret;
+
+    if (profile == CONN_PROFILE_BURST) {
+        intervalMin = Gap::MSEC_TO_GAP_DURATION_UNITS(BLE_CONN_BURST_INTERVAL_MIN_MS);
+        intervalMax = Gap::MSEC_TO_GAP_DURATION_UNITS(BLE_CONN_BURST_INTERVAL_MAX_MS);
+        latency     = 0;
+    } else {
+        intervalMin = Gap::MSEC_TO_GAP_DURATION_UNITS(BLE_CONN_STEADY_INTERVAL_MIN_MS);
+        intervalMax = Gap::MSEC_TO_GAP_DURATION_UNITS(BLE_CONN_STEADY_INTERVAL_MAX_MS);
+        latency     = BLE_CONN_STEADY_LATENCY;
+    }
+
+    if (link->role == Gap::PERIPHERAL) {
+        ret = BLE_TRACE_COMMAND(ACI_L2CAP_CONN_PARAM_UPDATE_REQ_OPCODE,
+                                BLE_TRACE_PARAMS.u16(link->handle).u16(intervalMin).u16(intervalMax).u16(latency)
+                                                .u16(timeout),
+                                aci_l2cap_connection_parameter_update_req(link->handle, intervalMin, intervalMax,
+                                                                          latency, timeout));
+    } else {
+        /* Connection events may last the whole interval (0.625 ms units) */
+        ret = BLE_TRACE_COMMAND(ACI_GAP_START_CONNECTION_UPDATE_OPCODE,
+                                BLE_TRACE_PARAMS.u16(link->handle).u16(intervalMin).u16(intervalMax).u16(latency)
+                                                .u16(timeout).u16(0).u16(intervalMax * 2),
+                                aci_gap_start_connection_update(link->handle, intervalMin, intervalMax, latency,
+                                                                timeout, 0, intervalMax * 2));
+    }
+    if (ret != BLE_STATUS_SUCCESS) {
+        return ret;
+    }
+
+    link->connUpdate.requested = profile;
+    link->connUpdate.reason    = reason;
+    link->connUpdate.pending   = true;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_STATUS_SUCCESS;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Measure the last window of a link and request the profile its
+            traffic calls for
+*/
+/**************************************************************************/
+void BlueNRG1_ConnManager::evaluate(BlueNRG1_Link_t *link)
+{
+    BlueNRG1_ConnUpdate_t *state = &link->connUpdate;
+    uint32_t count = link->notifyCount - state->notifyMark;
+    Profile_t profile;
+    Reason_t  reason;
+
+    state->notifyMark = link->notifyCount;
+    state->rate       = (uint16_t)((count * 1000) / BLE_CONN_WINDOW_MS);
+    if (state->retryWindows > 0) {
+        state->retryWindows--;
+    }
+
+    if (BlueNRG1_GattServer::getInstance().getPendingCount(link->handle) > 0) {
+        profile = CONN_PROFILE_BURST;
+        reason  = CONN_REASON_BACKLOG;
+        state->steadyWindows = 0;
+    } else if (state->rate >= BLE_CONN_BURST_RATE) {
+        profile = CONN_PROFILE_BURST;
+        reason  = CONN_REASON_RATE_HIGH;
+        state->steadyWindows = 0;
+    } else if (state->rate <= BLE_CONN_STEADY_RATE) {
+        if (state->steadyWindows < BLE_CONN_STEADY_WINDOWS) {
+            state->steadyWindows++;
+        }
+        if (state->steadyWindows < BLE_CONN_STEADY_WINDOWS) {
+            return;
+        }
+        profile = CONN_PROFILE_STEADY;
+        reason  = CONN_REASON_RATE_LOW;
+    } else {
+        /* In between: keep what is in use */
+        state->steadyWindows = 0;
+        return;
+    }
+
+    if (state->profile == CONN_PROFILE_PEER) {
+        /* The peer chose for this traffic: only a change of profile calls for ours */
+        if (state->peerTraffic == CONN_PROFILE_INITIAL) {
+            state->peerTraffic = profile;
+        }
+        if (profile == state->peerTraffic) {
+            return;
+        }
+    }
+    if (state->pending || (profile == state->profile) || (state->retryWindows > 0)) {
+        return;
+    }
+    request(link, profile, reason);
+}
+
+/**************************************************************************/
+/*!
+    @brief  The peer or the stack refused the parameters: back off before
+            the next request, longer at every refusal in a row
+*/
+/**************************************************************************/
+void BlueNRG1_ConnManager::onRefused(BlueNRG1_Link_t *link)
+{
+    BlueNRG1_ConnUpdate_t *state = &link->connUpdate;
+    uint32_t windows = (uint32_t)BLE_CONN_RETRY_WINDOWS << state->retries;
+
+    state->pending = false;
+    state->rejected++;
+    if (windows < BLE_CONN_RETRY_MAX_WINDOWS) {
+        state->retryWindows = (uint8_t)windows;
+        state->retries++;
+    } else {
+        state->retryWindows = BLE_CONN_RETRY_MAX_WINDOWS;
+    }
+}
+
+void BlueNRG1_ConnManager::onTimeout(void)
+{
+    BlueNRG1_Links &links = BlueNRG1_Links::getInstance();
+
+    running = false;
+
+    if (enabled) {
+        for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+            BlueNRG1_Link_t *link = links.at(i);
+            if (link->connected) {
+                evaluate(link);
+            }
+        }
+    }
+
+    onLinksChanged();
+}
+
+/**************************************************************************/
+/*!
+    @brief  New parameters in use, or the central refused ours: an update
+            nobody here requested comes from the peer
+*/
+/**************************************************************************/
+void BlueNRG1_ConnManager::onUpdateComplete(Gap::Handle_t handle, uint8_t status)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link == NULL) {
+        return;
+    }
+
+    if (link->connUpdate.pending) {
+        if (status == BLE_STATUS_SUCCESS) {
+            link->connUpdate.pending = false;
+            link->connUpdate.profile = link->connUpdate.requested;
+            link->connUpdate.retries = 0;
+        } else {
+            onRefused(link);
+        }
+    } else if (status == BLE_STATUS_SUCCESS) {
+        link->connUpdate.profile     = CONN_PROFILE_PEER;
+        link->connUpdate.reason      = CONN_REASON_PEER;
+        link->connUpdate.peerTraffic = CONN_PROFILE_INITIAL;
+    }
+}
+
+void BlueNRG1_ConnManager::onUpdateResponse(Gap::Handle_t handle, uint16_t result)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    /* Accepted: hci_le_connection_update_complete_event follows */
+    if ((link == NULL) || (result == L2CAP_CONN_PARAM_ACCEPTED)) {
+        return;
+    }
+
+    onRefused(link);
+}
+
+void BlueNRG1_ConnManager::onProcedureTimeout(Gap::Handle_t handle)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if ((link != NULL) && link->connUpdate.pending) {
+        onRefused(link);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  A peripheral asked for new parameters: accept them when they
+            are valid, the link layer update is then started by the stack
+*/
+/**************************************************************************/
+void BlueNRG1_ConnManager::onUpdateRequest(Gap::Handle_t handle, uint8_t identifier, uint16_t intervalMin,
+                                           uint16_t intervalMax, uint16_t latency, uint16_t timeout)
+{
+    bool accept = (intervalMin >= MIN_INT_CONN) && (intervalMax <= MAX_INT_CONN) &&
+                  (intervalMin <= intervalMax) && (latency <= CONN_LATENCY_MAX) &&
+                  (timeout >= CONN_TIMEOUT_MIN) && (timeout <= CONN_TIMEOUT_MAX) &&
+                  /* timeout * 10 ms > 2 * (1 + latency) * intervalMax * 1.25 ms */
+                  (((uint32_t)timeout * 4) > ((uint32_t)(1 + latency) * intervalMax));
+
+    BLE_TRACE_COMMAND(ACI_L2CAP_CONN_PARAM_UPDATE_RESP_OPCODE,
+                      BLE_TRACE_PARAMS.u16(handle).u16(intervalMin).u16(intervalMax).u16(latency).u16(timeout)
+                                      .u16(0).u16(intervalMax * 2).u8(identifier).u8(accept ? 1 : 0),
+                      aci_l2cap_connection_parameter_update_resp(handle, intervalMin, intervalMax, latency, timeout,
+                                                                 0, intervalMax * 2, identifier, accept ? 1 : 0));
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+
+extern "C" void aci_l2cap_connection_update_resp_event(uint16_t Connection_Handle,
+                                                       uint16_t Result)
+{
+    BLE_EVENT_SCOPE(L2CAP_CONNECTION_UPDATE_RESP);
+    BLE_TRACE_VS_EVENT(ACI_L2CAP_CONN_UPDATE_RESP_VSEVT_CODE, BLE_TRACE_PARAMS.u16(Connection_Handle).u16(Result));
+
+    BlueNRG1_Gap::getInstance().getConnManager().onUpdateResponse(Connection_Handle, Result);
+}
+
+extern "C" void aci_l2cap_connection_update_req_event(uint16_t Connection_Handle,
+                                                      uint8_t Identifier,
+                                                      uint16_t L2CAP_Length,
+                                                      uint16_t Interval_Min,
+                                                      uint16_t Interval_Max,
+                                                      uint16_t Slave_Latency,
+                                                      uint16_t Timeout_Multiplier)
+{
+    BLE_EVENT_SCOPE(L2CAP_CONNECTION_UPDATE_REQ);
+
+    (void)L2CAP_Length;
+
+    BLE_TRACE_VS_EVENT(ACI_L2CAP_CONN_UPDATE_REQ_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u8(Identifier).u16(L2CAP_Length).u16(Interval_Min)
+                                       .u16(Interval_Max).u16(Slave_Latency).u16(Timeout_Multiplier));
+
+    BlueNRG1_Gap::getInstance().getConnManager().onUpdateRequest(Connection_Handle, Identifier, Interval_Min,
+                                                                 Interval_Max, Slave_Latency, Timeout_Multiplier);
+}
+
+extern "C" void aci_l2cap_proc_timeout_event(uint16_t Connection_Handle,
+                                             uint8_t Data_Length,
+                                             uint8_t Data[])
+{
+    BLE_EVENT_SCOPE(L2CAP_PROC_TIMEOUT);
+
+    (void)Data_Length;
+    (void)Data;
+
+    BLE_TRACE_VS_EVENT(ACI_L2CAP_PROC_TIMEOUT_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u8(Data_Length).bytes(Data, Data_Length));
+
+    BlueNRG1_Gap::getInstance().getConnManager().onProcedureTimeout(Connection_Handle);
+}
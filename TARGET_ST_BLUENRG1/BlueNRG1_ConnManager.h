@@ -0,0 +1,143 @@
+#ifndef __BLUENRG1_CONNMANAGER_H__
+#define __BLUENRG1_CONNMANAGER_H__
+
+#include <stdint.h>
+
+#include "BlueNRG1_Links.h"
+
+/* Period over which the notification rate of every link is measured */
+#ifndef BLE_CONN_WINDOW_MS
+#define BLE_CONN_WINDOW_MS              2000
+#endif
+
+/* Notifications per second from which a link is in burst */
+#ifndef BLE_CONN_BURST_RATE
+#define BLE_CONN_BURST_RATE             8
+#endif
+
+/* Notifications per second up to which a link is steady */
+#ifndef BLE_CONN_STEADY_RATE
+#define BLE_CONN_STEADY_RATE            2
+#endif
+
+/* Windows in a row at the steady rate before slowing the link down */
+#ifndef BLE_CONN_STEADY_WINDOWS
+#define BLE_CONN_STEADY_WINDOWS         3
+#endif
+
+/* Windows to wait after a refused request, doubled at every refusal in a
+   row up to BLE_CONN_RETRY_MAX_WINDOWS */
+#ifndef BLE_CONN_RETRY_WINDOWS
+#define BLE_CONN_RETRY_WINDOWS          1
+#endif
+#ifndef BLE_CONN_RETRY_MAX_WINDOWS
+#define BLE_CONN_RETRY_MAX_WINDOWS      32
+#endif
+
+/* Burst parameters: short interval, no slave latency */
+#ifndef BLE_CONN_BURST_INTERVAL_MIN_MS
+#define BLE_CONN_BURST_INTERVAL_MIN_MS  8     /* Truncated to MIN_INT_CONN, 7.5 ms */
+#endif
+#ifndef BLE_CONN_BURST_INTERVAL_MAX_MS
+#define BLE_CONN_BURST_INTERVAL_MAX_MS  15
+#endif
+
+/* Steady parameters: long interval for the 1 Hz heart rate updates */
+#ifndef BLE_CONN_STEADY_INTERVAL_MIN_MS
+#define BLE_CONN_STEADY_INTERVAL_MIN_MS 400   /* DEF_INT_CONN */
+#endif
+#ifndef BLE_CONN_STEADY_INTERVAL_MAX_MS
+#define BLE_CONN_STEADY_INTERVAL_MAX_MS 1000
+#endif
+#ifndef BLE_CONN_STEADY_LATENCY
+#define BLE_CONN_STEADY_LATENCY         0
+#endif
+
+/* Supervision timeout of both profiles, above 2 * (1 + latency) * interval */
+#ifndef BLE_CONN_SUPERVISION_TIMEOUT_MS
+#define BLE_CONN_SUPERVISION_TIMEOUT_MS 6000
+#endif
+
+/**************************************************************************/
+/*!
+    \brief
+    Connection parameters that follow the traffic of each link.
+
+    Every BLE_CONN_WINDOW_MS, timed with a stack virtual timer, the manager
+    counts the notifications each link carried, sent by the GATT server or
+    received by the collector, and how many are still queued. A link at
+    BLE_CONN_BURST_RATE or with a backlog gets the burst parameters right
+    away; a link that stays at or below BLE_CONN_STEADY_RATE for
+    BLE_CONN_STEADY_WINDOWS gets the steady ones. The profile is requested
+    again whenever the parameters in use differ from it; the parameters
+    of an update started by the peer are kept until the traffic moves to
+    the other profile. A refused request waits BLE_CONN_RETRY_WINDOWS,
+    doubling while the peer keeps refusing. As peripheral the request
+    is an L2CAP connection parameter update, as central a link layer
+    connection update; the update requests of the peripherals are accepted
+    when within the spec ranges.
+*/
+/**************************************************************************/
+class BlueNRG1_ConnManager
+{
+public:
+    typedef enum {
+        CONN_PROFILE_INITIAL,   /**< Parameters set by the central at connection. */
+        CONN_PROFILE_BURST,
+        CONN_PROFILE_STEADY,
+        CONN_PROFILE_PEER       /**< Parameters requested by the peer. */
+    } Profile_t;
+
+    typedef enum {
+        CONN_REASON_NONE,
+        CONN_REASON_RATE_HIGH,  /**< Notification rate at or above BLE_CONN_BURST_RATE. */
+        CONN_REASON_BACKLOG,    /**< Notifications queued for lack of TX buffers. */
+        CONN_REASON_RATE_LOW,   /**< Rate at or below BLE_CONN_STEADY_RATE long enough. */
+        CONN_REASON_PEER        /**< Update started by the peer. */
+    } Reason_t;
+
+    typedef struct {
+        uint16_t  interval;     /**< In use, 1.25 ms units. */
+        uint16_t  latency;
+        uint16_t  timeout;      /**< 10 ms units. */
+        Profile_t profile;      /**< Profile of the parameters in use. */
+        Reason_t  reason;       /**< Why they were requested. */
+        bool      pending;      /**< A request is waiting for the peer. */
+        uint16_t  rate;         /**< Notifications per second over the last window. */
+        uint32_t  rejected;     /**< Requests the peer refused. */
+    } Status_t;
+
+    BlueNRG1_ConnManager();
+
+    void        enable(bool enable);
+    bool        isEnabled(void) const {
+        return enabled;
+    }
+    ble_error_t getStatus(Gap::Handle_t handle, Status_t *status);
+
+    /* A link connected or disconnected: run the window timer while links exist */
+    void        onLinksChanged(void);
+    /* Entry point for hci_le_connection_update_complete_event, after the link table update */
+    void        onUpdateComplete(Gap::Handle_t handle, uint8_t status);
+    /* Entry point for aci_l2cap_connection_update_resp_event */
+    void        onUpdateResponse(Gap::Handle_t handle, uint16_t result);
+    /* Entry point for aci_l2cap_connection_update_req_event */
+    void        onUpdateRequest(Gap::Handle_t handle, uint8_t identifier, uint16_t intervalMin,
+                                uint16_t intervalMax, uint16_t latency, uint16_t timeout);
+    /* Entry point for aci_l2cap_proc_timeout_event */
+    void        onProcedureTimeout(Gap::Handle_t handle);
+    /* Entry point for the BLUENRG1_VTIMER_CONN_MANAGER expiry */
+    void        onTimeout(void);
+
+private:
+    void        evaluate(BlueNRG1_Link_t *link);
+    uint8_t     request(BlueNRG1_Link_t *link, Profile_t profile, Reason_t reason);
+    void        onRefused(BlueNRG1_Link_t *link);
+
+    bool        enabled;
+    bool        running;   /**< Window timer started. */
+
+    MBED_STATIC_ASSERT(BLE_CONN_RETRY_MAX_WINDOWS <= 255, "BLE_CONN_RETRY_MAX_WINDOWS too large for the uint8_t count");
+};
+
+#endif //__BLUENRG1_CONNMANAGER_H__
@@ -0,0 +1,28 @@
+#include "BlueNRG1_Events.h"
+
+#if BLE_EVENT_STATS
+
+#include <string.h>
+
+#define BLUENRG1_EVENT_NAME(id, callback)   #callback,
+
+static const char *const eventNames[BLUENRG1_EVT_COUNT] = {
+    BLUENRG1_EVENT_TABLE(BLUENRG1_EVENT_NAME)
+};
+
+BlueNRG1_EventStats::BlueNRG1_EventStats()
+{
+    reset();
+}
+
+void BlueNRG1_EventStats::reset(void)
+{
+    memset(stats, 0, sizeof(stats));
+}
+
+const char *BlueNRG1_EventStats::getName(BlueNRG1_EventId_t id)
+{
+    return (id < BLUENRG1_EVT_COUNT) ? eventNames[id] : "";
+}
+
+#endif //BLE_EVENT_STATS
@@ -0,0 +1,129 @@
+#ifndef __BLUENRG1_EVENTS_H__
+#define __BLUENRG1_EVENTS_H__
+
+#include <stdint.h>
+
+/* Count and time the stack event handlers, 0 compiles it out */
+#ifndef BLE_EVENT_STATS
+#define BLE_EVENT_STATS             1
+#endif
+
+/* Stack events the port handles: identifier, callback of bluenrg1_events.h */
+#define BLUENRG1_EVENT_TABLE(X)                                                         \
+    X(DISCONNECTION_COMPLETE,           hci_disconnection_complete_event)               \
+    X(ENCRYPTION_CHANGE,                hci_encryption_change_event)                    \
+    X(NUMBER_OF_COMPLETED_PACKETS,      hci_number_of_completed_packets_event)          \
+    X(LE_CONNECTION_COMPLETE,           hci_le_connection_complete_event)               \
+    X(LE_ADVERTISING_REPORT,            hci_le_advertising_report_event)                \
+    X(LE_CONNECTION_UPDATE_COMPLETE,    hci_le_connection_update_complete_event)        \
+    X(LE_ENHANCED_CONNECTION_COMPLETE,  hci_le_enhanced_connection_complete_event)      \
+    X(END_OF_RADIO_ACTIVITY,            aci_hal_end_of_radio_activity_event)            \
+    X(PAIRING_COMPLETE,                 aci_gap_pairing_complete_event)                 \
+    X(PASS_KEY_REQ,                     aci_gap_pass_key_req_event)                     \
+    X(BOND_LOST,                        aci_gap_bond_lost_event)                        \
+    X(GAP_PROC_COMPLETE,                aci_gap_proc_complete_event)                    \
+    X(NUMERIC_COMPARISON_VALUE,         aci_gap_numeric_comparison_value_event)         \
+    X(L2CAP_CONNECTION_UPDATE_RESP,     aci_l2cap_connection_update_resp_event)         \
+    X(L2CAP_PROC_TIMEOUT,               aci_l2cap_proc_timeout_event)                   \
+    X(L2CAP_CONNECTION_UPDATE_REQ,      aci_l2cap_connection_update_req_event)          \
+    X(ATTRIBUTE_MODIFIED,               aci_gatt_attribute_modified_event)              \
+    X(EXCHANGE_MTU_RESP,                aci_att_exchange_mtu_resp_event)                \
+    X(FIND_INFO_RESP,                   aci_att_find_info_resp_event)                   \
+    X(FIND_BY_TYPE_VALUE_RESP,          aci_att_find_by_type_value_resp_event)          \
+    X(INDICATION,                       aci_gatt_indication_event)                      \
+    X(NOTIFICATION,                     aci_gatt_notification_event)                    \
+    X(GATT_PROC_COMPLETE,               aci_gatt_proc_complete_event)                   \
+    X(DISC_READ_CHAR_BY_UUID_RESP,      aci_gatt_disc_read_char_by_uuid_resp_event)     \
+    X(TX_POOL_AVAILABLE,                aci_gatt_tx_pool_available_event)
+
+#define BLUENRG1_EVENT_ID(id, callback)     BLUENRG1_EVT_##id,
+
+typedef enum {
+    BLUENRG1_EVENT_TABLE(BLUENRG1_EVENT_ID)
+    BLUENRG1_EVT_COUNT
+} BlueNRG1_EventId_t;
+
+#undef BLUENRG1_EVENT_ID
+
+#if BLE_EVENT_STATS
+
+#include "hal/us_ticker_api.h"
+
+/**************************************************************************/
+/*!
+    \brief
+    Handler statistics of the stack events.
+
+    The stack library calls the event callbacks of bluenrg1_events.h by
+    name: the port defines them next to the object they belong to, and
+    each one calls that object directly, so the linker resolves the
+    whole dispatch. BLUENRG1_EVENT_TABLE lists them once, giving every
+    event an index in a fixed array of counters.
+
+    BLE_EVENT_SCOPE() opens a callback: the handler is counted, and timed
+    with us_ticker_read() until the callback returns, the trace included.
+    The callbacks all run from BTLE_StackTick(), in processEvents().
+*/
+/**************************************************************************/
+class BlueNRG1_EventStats
+{
+public:
+    typedef struct {
+        uint32_t count;
+        uint32_t maxUs;        /**< Longest handler. */
+        uint32_t totalUs;      /**< Time spent in the handler, wraps after 71 minutes. */
+    } Stats_t;
+
+    static BlueNRG1_EventStats &getInstance() {
+        static BlueNRG1_EventStats m_instance;
+        return m_instance;
+    }
+
+    const Stats_t &getStats(BlueNRG1_EventId_t id) const {
+        return stats[id];
+    }
+    /* Name of the callback */
+    static const char *getName(BlueNRG1_EventId_t id);
+    void reset(void);
+
+    void record(BlueNRG1_EventId_t id, uint32_t durationUs) {
+        Stats_t &entry = stats[id];
+
+        entry.count++;
+        entry.totalUs += durationUs;
+        if (durationUs > entry.maxUs) {
+            entry.maxUs = durationUs;
+        }
+    }
+
+private:
+    BlueNRG1_EventStats();
+
+    Stats_t stats[BLUENRG1_EVT_COUNT];
+};
+
+/* Records the handler of an event when it goes out of scope */
+class BlueNRG1_EventScope
+{
+public:
+    explicit BlueNRG1_EventScope(BlueNRG1_EventId_t eventId) : id(eventId), start(us_ticker_read()) {
+    }
+
+    ~BlueNRG1_EventScope() {
+        BlueNRG1_EventStats::getInstance().record(id, us_ticker_read() - start);
+    }
+
+private:
+    BlueNRG1_EventId_t id;
+    uint32_t           start;
+};
+
+#define BLE_EVENT_SCOPE(id)         BlueNRG1_EventScope bleEventScope(BLUENRG1_EVT_##id)
+
+#else
+
+#define BLE_EVENT_SCOPE(id)         do { } while (0)
+
+#endif //BLE_EVENT_STATS
+
+#endif //__BLUENRG1_EVENTS_H__
@@ -1,13 +1,911 @@
 #include "BlueNRG1_Gap.h"
+#include "BlueNRG1_Events.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_GattServer.h"
+#include "BlueNRG1_Links.h"
+#include "BlueNRG1_OtaService.h"
+#include "BlueNRG1_SecurityManager.h"
+#include "BlueNRG1_Trace.h"
 
-ble_error_t BlueNRG1_Gap::setAdvertisingData(const GapAdvertisingData &advData, const GapAdvertisingData &scanResponse)
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_const.h"
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_events.h"
+#include "bluenrg1_gap.h"
+#include "bluenrg1_stack.h"
+#include "hci_const.h"
+#include "link_layer.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* Role of hci_le_connection_complete_event */
+#define HCI_ROLE_MASTER         0x00
+
+/* Own address of the advertising, scanning and connection procedures */
+#if BLE_PRIVACY
+#define GAP_OWN_ADDR_TYPE       RESOLVABLE_PRIVATE_ADDR
+#else
+#define GAP_OWN_ADDR_TYPE       PUBLIC_ADDR
+#endif
+
+/* Flags the GAP inserts when it enters general discoverable mode */
+#define GAP_DISCOVERABLE_FLAGS  (FLAG_BIT_LE_GENERAL_DISCOVERABLE_MODE | FLAG_BIT_BR_EDR_NOT_SUPPORTED)
+
+/* Return the AD structure of the given type in payload, NULL if absent */
+static const uint8_t *findADStructure(const uint8_t *payload, uint8_t len, uint8_t type)
 {
-    printf("setAdvertisingData()\n\r");
+    uint8_t pos = 0;
+
+    while ((pos + 1) < len) {
+        uint8_t fieldLen = payload[pos];
+        if (fieldLen == 0) {
+            break;
+        }
+        if (payload[pos + 1] == type) {
+            return &payload[pos];
+        }
+        pos += fieldLen + 1;
+    }
+
+    return NULL;
+}
+
+BlueNRG1_Gap::BlueNRG1_Gap() :
+    Gap(),
+    advDataLen(0),
+    scanRspLen(0),
+    advType(ADV_IND),
+    advPolicy(ADV_POLICY_IGNORE_WHITELIST),
+    directedAdv(false),
+    scanState(SCAN_IDLE),
+    reportAddrType(BLEProtocol::AddressType::PUBLIC),
+    connectPending(false),
+    connecting(false),
+    connectTimedOut(false),
+    peerAddrType(PUBLIC_ADDR),
+    connScanInterval(SCAN_P),
+    connScanWindow(SCAN_L),
+    localRpaValid(false)
+{
+    memset(peerAddr, 0, sizeof(peerAddr));
+    memset(&peerParams, 0, sizeof(peerParams));
+    memset(localRpa, 0, sizeof(localRpa));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Address the device is seen with
+
+    With BLE_PRIVACY the controller advertises and connects with a
+    resolvable private address generated from the resolving list, which
+    only holds bonded peers: the address in use with the last bonded peer,
+    else the one of the last connection. Without any the controller uses
+    the public address, as without privacy.
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::getAddress(BLEProtocol::AddressType_t *typeP, BLEProtocol::AddressBytes_t address)
+{
+#if BLE_PRIVACY
+    BLEProtocol::AddressType_t  bondedType;
+    BLEProtocol::AddressBytes_t bondedAddr;
+
+    if (BlueNRG1_SecurityManager::getInstance().getLastBondedPeer(&bondedType, bondedAddr)) {
+        uint8_t identityType = (bondedType == BLEProtocol::AddressType::PUBLIC) ? PUBLIC_ADDR : STATIC_RANDOM_ADDR;
+        tBleStatus ret = BLE_TRACE_COMMAND(HCI_LE_READ_LOCAL_RESOLVABLE_ADDRESS_OPCODE,
+                                           BLE_TRACE_PARAMS.u8(identityType).bytes(bondedAddr, BDADDR_SIZE),
+                                           hci_le_read_local_resolvable_address(identityType, bondedAddr, address));
+        if (ret == BLE_STATUS_SUCCESS) {
+            if (typeP != NULL) {
+                *typeP = BLEProtocol::AddressType::RANDOM_PRIVATE_RESOLVABLE;
+            }
+            return BLE_ERROR_NONE;
+        }
+    }
+    if (localRpaValid) {
+        memcpy(address, localRpa, sizeof(localRpa));
+        if (typeP != NULL) {
+            *typeP = BLEProtocol::AddressType::RANDOM_PRIVATE_RESOLVABLE;
+        }
+        return BLE_ERROR_NONE;
+    }
+#endif
+
+    if (typeP != NULL) {
+        *typeP = BLEProtocol::AddressType::PUBLIC;
+    }
+    return readPublicAddress(address);
+}
+
+ble_error_t BlueNRG1_Gap::readPublicAddress(BLEProtocol::AddressBytes_t address)
+{
+    tBleStatus ret = BLE_TRACE_COMMAND(HCI_READ_BD_ADDR_OPCODE, BLE_TRACE_PARAMS, hci_read_bd_addr(address));
+
+    return BlueNRG1_ble::bleStatusToError(ret);
+}
+
+uint16_t BlueNRG1_Gap::getMinAdvertisingInterval(void) const
+{
+    return GapAdvertisingParams::ADVERTISEMENT_DURATION_UNITS_TO_MS(BLUENRG_GAP_ADV_INTERVAL_MIN);
+}
+
+uint16_t BlueNRG1_Gap::getMinNonConnectableAdvertisingInterval(void) const
+{
+    return GapAdvertisingParams::ADVERTISEMENT_DURATION_UNITS_TO_MS(BLUENRG_GAP_ADV_NONCON_INTERVAL_MIN);
+}
+
+uint16_t BlueNRG1_Gap::getMaxAdvertisingInterval(void) const
+{
+    return GapAdvertisingParams::ADVERTISEMENT_DURATION_UNITS_TO_MS(BLUENRG_GAP_ADV_INTERVAL_MAX);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Bring the controller advertising data to advPayload
+
+    AD types no longer present are removed with aci_gap_delete_ad_type(),
+    the new and modified ones are sent together in a single
+    aci_gap_update_adv_data(). Unchanged AD structures are not touched, so
+    advertising is not interrupted.
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::updateAdvData(const GapAdvertisingData &advPayload)
+{
+    const uint8_t *payload = advPayload.getPayload();
+    uint8_t        len     = advPayload.getPayloadLen();
+    uint8_t        changed[BLE_ADV_DATA_MAX_LEN];
+    uint8_t        changedLen = 0;
+    uint8_t        pos;
+    tBleStatus     ret;
+
+    /* Remove what disappeared; the flags belong to the discoverable mode */
+    for (pos = 0; ((pos + 1) < advDataLen) && (advData[pos] != 0); pos += advData[pos] + 1) {
+        uint8_t type = advData[pos + 1];
+        if ((type != AD_TYPE_FLAGS) && (findADStructure(payload, len, type) == NULL)) {
+            ret = BLE_TRACE_COMMAND(ACI_GAP_DELETE_AD_TYPE_OPCODE, BLE_TRACE_PARAMS.u8(type),
+                                    aci_gap_delete_ad_type(type));
+            if (ret != BLE_STATUS_SUCCESS) {
+                return BlueNRG1_ble::bleStatusToError(ret);
+            }
+        }
+    }
+
+    /* Collect what is new or different */
+    for (pos = 0; ((pos + 1) < len) && (payload[pos] != 0); pos += payload[pos] + 1) {
+        uint8_t        fieldLen = payload[pos] + 1;
+        const uint8_t *current  = findADStructure(advData, advDataLen, payload[pos + 1]);
+        if ((current == NULL) || (memcmp(current, &payload[pos], fieldLen) != 0)) {
+            memcpy(&changed[changedLen], &payload[pos], fieldLen);
+            changedLen += fieldLen;
+        }
+    }
+
+    if (changedLen > 0) {
+        ret = BLE_TRACE_COMMAND(ACI_GAP_UPDATE_ADV_DATA_OPCODE, BLE_TRACE_PARAMS.u8(changedLen).bytes(changed, changedLen),
+                                aci_gap_update_adv_data(changedLen, changed));
+        if (ret != BLE_STATUS_SUCCESS) {
+            return BlueNRG1_ble::bleStatusToError(ret);
+        }
+    }
+
+    memcpy(advData, payload, len);
+    advDataLen = len;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Bring the controller scan response to scanResponse
+
+    HCI only allows replacing the scan response as a whole, so it is only
+    sent when it differs from what the controller holds.
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::updateScanResponse(const GapAdvertisingData &scanResponse)
+{
+    uint8_t len = scanResponse.getPayloadLen();
+
+    if ((len == scanRspLen) && (memcmp(scanRspData, scanResponse.getPayload(), len) == 0)) {
+        return BLE_ERROR_NONE;
+    }
+
+    uint8_t data[BLE_ADV_DATA_MAX_LEN] = {0};
+    memcpy(data, scanResponse.getPayload(), len);
+
+    tBleStatus ret = BLE_TRACE_COMMAND(HCI_LE_SET_SCAN_RESPONSE_DATA_OPCODE,
+                                       BLE_TRACE_PARAMS.u8(len).bytes(data, sizeof(data)),
+                                       hci_le_set_scan_response_data(len, data));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    memcpy(scanRspData, data, len);
+    scanRspLen = len;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
     return BLE_ERROR_NONE;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Update the advertising payloads
+
+    While advertising only the changes are pushed to the controller,
+    otherwise the payloads are programmed by startAdvertising().
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::setAdvertisingData(const GapAdvertisingData &advPayload, const GapAdvertisingData &scanResponse)
+{
+    if (!state.advertising || directedAdv) {
+        return BLE_ERROR_NONE;
+    }
+
+    ble_error_t error = updateScanResponse(scanResponse);
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+
+    return updateAdvData(advPayload);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enter discoverable mode with aci_gap_set_discoverable(), then
+            push the advertising payloads
+
+    Advertising already running is restarted with the new interval.
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::enterDiscoverable(uint8_t type, uint16_t interval)
+{
+    uint16_t minInterval = (type == ADV_IND) ? BLUENRG_GAP_ADV_INTERVAL_MIN : BLUENRG_GAP_ADV_NONCON_INTERVAL_MIN;
+
+    if (interval < minInterval) {
+        interval = minInterval;
+    }
+    if (interval > BLUENRG_GAP_ADV_INTERVAL_MAX) {
+        interval = BLUENRG_GAP_ADV_INTERVAL_MAX;
+    }
+
+    tBleStatus ret;
+    if (state.advertising) {
+        ret = BLE_TRACE_COMMAND(ACI_GAP_SET_NON_DISCOVERABLE_OPCODE, BLE_TRACE_PARAMS,
+                                aci_gap_set_non_discoverable());
+        if (ret != BLE_STATUS_SUCCESS) {
+            return BlueNRG1_ble::bleStatusToError(ret);
+        }
+        state.advertising = 0;
+        directedAdv = false;
+    }
+
+    ble_error_t error = updateScanResponse(_scanResponse);
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+
+    /* AdvertisingPolicyMode_t follows the HCI advertising filter policy */
+    uint8_t filter = (uint8_t)advPolicy;
+
+    ret = BLE_TRACE_COMMAND(ACI_GAP_SET_DISCOVERABLE_OPCODE,
+                            BLE_TRACE_PARAMS.u8(type).u16(interval).u16(interval).u8(GAP_OWN_ADDR_TYPE)
+                                            .u8(filter).u8(0).u8(0).u16(0).u16(0),
+                            aci_gap_set_discoverable(type, interval, interval, GAP_OWN_ADDR_TYPE, filter,
+                                                     0, NULL, 0, NULL, 0, 0));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    state.advertising = 1;
+
+    /* Discoverable mode starts with the flags only */
+    advData[0]  = 2;
+    advData[1]  = AD_TYPE_FLAGS;
+    advData[2]  = GAP_DISCOVERABLE_FLAGS;
+    advDataLen  = 3;
+
+    error = updateAdvData(_advPayload);
+    if (error != BLE_ERROR_NONE) {
+        BLE_TRACE_COMMAND(ACI_GAP_SET_NON_DISCOVERABLE_OPCODE, BLE_TRACE_PARAMS, aci_gap_set_non_discoverable());
+        state.advertising = 0;
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return error;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start advertising, beginning with the fast phase of advScheduler;
+            the interval in params is the one of the slow phase
+
+    @returns    BLE_ERROR_NOT_IMPLEMENTED for directed advertising, see
+                startDirectedAdvertising()
+*/
+/**************************************************************************/
 ble_error_t BlueNRG1_Gap::startAdvertising(const GapAdvertisingParams &params)
-{   
-    printf("startAdvertising()\n\r");     
+{
+    return beginAdvertising(params, true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start advertising with the parameters of Gap::startAdvertising(),
+            in the slow phase at once: for a restart while a peer is
+            connected, which the fast phase was there to find
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::startSlowAdvertising(void)
+{
+    ble_error_t error = beginAdvertising(getAdvertisingParams(), false);
+
+    if (error == BLE_ERROR_NONE) {
+        state.advertising = 1;
+    }
+
+    return error;
+}
+
+ble_error_t BlueNRG1_Gap::beginAdvertising(const GapAdvertisingParams &params, bool fastPhase)
+{
+    switch (params.getAdvertisingType()) {
+        case GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED:
+            advType = ADV_IND;
+            break;
+        case GapAdvertisingParams::ADV_SCANNABLE_UNDIRECTED:
+            advType = ADV_SCAN_IND;
+            break;
+        case GapAdvertisingParams::ADV_NON_CONNECTABLE_UNDIRECTED:
+            advType = ADV_NONCONN_IND;
+            break;
+        default:
+            return BLE_ERROR_NOT_IMPLEMENTED;
+    }
+
+    uint16_t interval = advScheduler.begin(params.getIntervalInADVUnits(), fastPhase);
+
+    ble_error_t error = enterDiscoverable(advType, interval);
+    if (error != BLE_ERROR_NONE) {
+        advScheduler.end(false);
+    }
+
+    return error;
+}
+
+/**************************************************************************/
+/*!
+    @brief  End of the fast advertising window, continue at the slow interval
+*/
+/**************************************************************************/
+void BlueNRG1_Gap::onAdvSchedulerTimeout(void)
+{
+    if ((advScheduler.getPhase() != BlueNRG1_AdvScheduler::ADV_PHASE_FAST) || !state.advertising) {
+        return;
+    }
+
+    if (enterDiscoverable(advType, advScheduler.expire()) != BLE_ERROR_NONE) {
+        advScheduler.end(false);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Only accept scan or connection requests from the whitelist on
+            the next undirected advertising
+
+    @returns    BLE_ERROR_INVALID_STATE while advertising
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::setAdvertisingPolicyMode(AdvertisingPolicyMode_t mode)
+{
+    if (state.advertising) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    advPolicy = mode;
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Call a known peer back with high duty cycle directed
+            advertising, to reconnect in a few ms
+
+    The controller gives up after 1.28 s: hci_le_connection_complete_event
+    reports HCI_DIRECTED_ADV_TIMEOUT and the application gets an
+    advertising timeout, see onConnectionComplete().
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::startDirectedAdvertising(BLEProtocol::AddressType_t peerAddrType,
+                                                   const BLEProtocol::AddressBytes_t peerAddr)
+{
+    uint8_t addrType = (peerAddrType == BLEProtocol::AddressType::PUBLIC) ? PUBLIC_ADDR : RANDOM_ADDR;
+    uint8_t addr[BDADDR_SIZE];
+
+    ble_error_t error = stopAdvertising();
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+
+    memcpy(addr, peerAddr, sizeof(addr));
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GAP_SET_DIRECT_CONNECTABLE_OPCODE,
+                                       BLE_TRACE_PARAMS.u8(GAP_OWN_ADDR_TYPE).u8(HIGH_DUTY_CYCLE_DIRECTED_ADV).u8(addrType)
+                                                       .bytes(addr, sizeof(addr)).u16(BLUENRG_GAP_ADV_INTERVAL_MIN)
+                                                       .u16(BLUENRG_GAP_ADV_INTERVAL_MIN),
+                                       aci_gap_set_direct_connectable(GAP_OWN_ADDR_TYPE, HIGH_DUTY_CYCLE_DIRECTED_ADV, addrType,
+                                                                      addr, BLUENRG_GAP_ADV_INTERVAL_MIN,
+                                                                      BLUENRG_GAP_ADV_INTERVAL_MIN));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    state.advertising = 1;
+    directedAdv = true;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t BlueNRG1_Gap::stopAdvertising(void)
+{
+    if (!state.advertising) {
+        return BLE_ERROR_NONE;
+    }
+
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GAP_SET_NON_DISCOVERABLE_OPCODE, BLE_TRACE_PARAMS,
+                                       aci_gap_set_non_discoverable());
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    state.advertising = 0;
+    directedAdv = false;
+    advDataLen = 0;
+    advScheduler.end(false);
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
     return BLE_ERROR_NONE;
-}
\ No newline at end of file
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start the observation procedure, advertising reports are
+            forwarded to the onAdvertisementReport callback
+
+    The scan runs until stopScan() or connect(): the scanning params
+    timeout is not supported.
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::startRadioScan(const GapScanningParams &scanningParams)
+{
+    if (connectPending || connecting || (scanState == SCAN_STOPPING)) {
+        return BLE_STACK_BUSY;
+    }
+    if (scanState == SCAN_RUNNING) {
+        return BLE_ERROR_NONE;
+    }
+
+    uint8_t scanType = scanningParams.getActiveScanning() ? ACTIVE_SCAN : PASSIVE_SCAN;
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GAP_START_OBSERVATION_PROC_OPCODE,
+                                       BLE_TRACE_PARAMS.u16(scanningParams.getInterval()).u16(scanningParams.getWindow())
+                                                       .u8(scanType).u8(GAP_OWN_ADDR_TYPE).u8(0x00).u8(NO_WHITE_LIST_USE),
+                                       aci_gap_start_observation_proc(scanningParams.getInterval(),
+                                                                      scanningParams.getWindow(),
+                                                                      scanType,
+                                                                      GAP_OWN_ADDR_TYPE,
+                                                                      0x00, /* Report every packet */
+                                                                      NO_WHITE_LIST_USE));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    scanState = SCAN_RUNNING;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t BlueNRG1_Gap::stopScan(void)
+{
+    if (scanState != SCAN_RUNNING) {
+        return BLE_ERROR_NONE;
+    }
+
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GAP_TERMINATE_GAP_PROC_OPCODE, BLE_TRACE_PARAMS.u8(GAP_OBSERVATION_PROC),
+                                       aci_gap_terminate_gap_proc(GAP_OBSERVATION_PROC));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    scanState = SCAN_STOPPING;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start the direct connection establishment procedure with the
+            parameters saved by connect()
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::createConnection(void)
+{
+    connectPending = false;
+
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GAP_CREATE_CONNECTION_OPCODE,
+                                       BLE_TRACE_PARAMS.u16(connScanInterval).u16(connScanWindow).u8(peerAddrType)
+                                                       .bytes(peerAddr, sizeof(peerAddr)).u8(GAP_OWN_ADDR_TYPE)
+                                                       .u16(peerParams.minConnectionInterval)
+                                                       .u16(peerParams.maxConnectionInterval)
+                                                       .u16(peerParams.slaveLatency)
+                                                       .u16(peerParams.connectionSupervisionTimeout)
+                                                       .u16(0).u16(0),
+                                       aci_gap_create_connection(connScanInterval,
+                                                                 connScanWindow,
+                                                                 peerAddrType,
+                                                                 peerAddr,
+                                                                 GAP_OWN_ADDR_TYPE,
+                                                                 peerParams.minConnectionInterval,
+                                                                 peerParams.maxConnectionInterval,
+                                                                 peerParams.slaveLatency,
+                                                                 peerParams.connectionSupervisionTimeout,
+                                                                 0, 0));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    connecting      = true;
+    connectTimedOut = false;
+    HAL_VTimerStart_ms(BLUENRG1_VTIMER_CONNECT, BLE_CONNECT_TIMEOUT_MS);
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Connect to an advertiser as central
+
+    A running scan is stopped first. The outcome is reported by the
+    onConnection callback, or by onTimeout with TIMEOUT_SRC_CONN when the
+    peer did not answer within BLE_CONNECT_TIMEOUT_MS.
+
+    @returns    BLE_STACK_BUSY while another connection is being created
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Gap::connect(const BLEProtocol::AddressBytes_t peerAddress,
+                                  BLEProtocol::AddressType_t peerAddressType,
+                                  const ConnectionParams_t *connectionParams,
+                                  const GapScanningParams *scanParams)
+{
+    if (connectPending || connecting) {
+        return BLE_STACK_BUSY;
+    }
+
+    memcpy(peerAddr, peerAddress, sizeof(peerAddr));
+    peerAddrType = (peerAddressType == BLEProtocol::AddressType::PUBLIC) ? PUBLIC_ADDR : STATIC_RANDOM_ADDR;
+
+    if (connectionParams != NULL) {
+        peerParams = *connectionParams;
+    } else {
+        peerParams.minConnectionInterval        = DEF_INT_CONN;
+        peerParams.maxConnectionInterval        = DEF_INT_CONN;
+        peerParams.slaveLatency                 = 0;
+        peerParams.connectionSupervisionTimeout = SUPERV_TIMEOUT;
+    }
+    connScanInterval = (scanParams != NULL) ? scanParams->getInterval() : SCAN_P;
+    connScanWindow   = (scanParams != NULL) ? scanParams->getWindow()   : SCAN_L;
+
+    if (scanState == SCAN_IDLE) {
+        return createConnection();
+    }
+
+    /* Resumed from onProcedureComplete(GAP_OBSERVATION_PROC) */
+    connectPending = true;
+    if (scanState == SCAN_RUNNING) {
+        ble_error_t error = stopScan();
+        if (error != BLE_ERROR_NONE) {
+            connectPending = false;
+            return error;
+        }
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t BlueNRG1_Gap::disconnect(Handle_t connectionHandle, DisconnectionReason_t reason)
+{
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GAP_TERMINATE_OPCODE, BLE_TRACE_PARAMS.u16(connectionHandle).u8(reason),
+                                       aci_gap_terminate(connectionHandle, reason));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_Gap::onConnectTimeout(void)
+{
+    if (connecting) {
+        connectTimedOut = true;
+        BLE_TRACE_COMMAND(ACI_GAP_TERMINATE_GAP_PROC_OPCODE, BLE_TRACE_PARAMS.u8(GAP_DIRECT_CONNECTION_ESTABLISHMENT_PROC),
+                          aci_gap_terminate_gap_proc(GAP_DIRECT_CONNECTION_ESTABLISHMENT_PROC));
+        BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  The observation or connection procedure ended: chain the
+            pending connection, report the failed ones
+*/
+/**************************************************************************/
+void BlueNRG1_Gap::onProcedureComplete(uint8_t procedureCode, uint8_t status)
+{
+    switch (procedureCode) {
+        case GAP_OBSERVATION_PROC:
+            scanState = SCAN_IDLE;
+            if (connectPending && (createConnection() != BLE_ERROR_NONE)) {
+                processTimeoutEvent(TIMEOUT_SRC_CONN);
+            }
+            break;
+        case GAP_DIRECT_CONNECTION_ESTABLISHMENT_PROC:
+            connecting = false;
+            HAL_VTimer_Stop(BLUENRG1_VTIMER_CONNECT);
+            if ((status != BLE_STATUS_SUCCESS) || connectTimedOut) {
+                processTimeoutEvent(TIMEOUT_SRC_CONN);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void BlueNRG1_Gap::onAdvertisingReport(uint8_t eventType, uint8_t addrType, const uint8_t addr[BDADDR_SIZE],
+                                       int8_t rssi, uint8_t len, const uint8_t *data)
+{
+    GapAdvertisingParams::AdvertisingType_t type;
+
+    switch (eventType) {
+        case ADV_DIRECT_IND:
+            type = GapAdvertisingParams::ADV_CONNECTABLE_DIRECTED;
+            break;
+        case ADV_SCAN_IND:
+            type = GapAdvertisingParams::ADV_SCANNABLE_UNDIRECTED;
+            break;
+        case ADV_NONCONN_IND:
+            type = GapAdvertisingParams::ADV_NON_CONNECTABLE_UNDIRECTED;
+            break;
+        default:
+            /* ADV_IND, and SCAN_RSP which only scannable advertisers send */
+            type = GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED;
+            break;
+    }
+
+    /* Public and public identity addresses have even types */
+    reportAddrType = (addrType & 0x01) ? BLEProtocol::AddressType::RANDOM_STATIC : BLEProtocol::AddressType::PUBLIC;
+
+    processAdvertisementReport(addr, rssi, eventType == SCAN_RSP, type, len, data);
+}
+
+/**************************************************************************/
+/*!
+    @brief  A connection stops advertising: forget the controller payload,
+            take a slot in the link table, start the exchange MTU procedure
+            and notify the application
+*/
+/**************************************************************************/
+void BlueNRG1_Gap::onConnectionComplete(uint8_t status, Handle_t handle, uint8_t role,
+                                        uint8_t peerAddrType, const uint8_t peerAddr[BDADDR_SIZE],
+                                        uint16_t interval, uint16_t latency, uint16_t supervisionTimeout,
+                                        const uint8_t ownRpa[BDADDR_SIZE])
+{
+    if ((status == HCI_DIRECTED_ADV_TIMEOUT) && directedAdv) {
+        directedAdv = false;
+        processTimeoutEvent(TIMEOUT_SRC_ADVERTISING);
+        return;
+    }
+    if (status != BLE_STATUS_SUCCESS) {
+        return;
+    }
+
+    advDataLen = 0;
+    directedAdv = false;
+    if (role != HCI_ROLE_MASTER) {
+        advScheduler.end(true);
+    }
+
+    BLEProtocol::AddressType_t  ownAddrType;
+    BLEProtocol::AddressBytes_t ownAddr;
+    static const uint8_t noRpa[BDADDR_SIZE] = { 0 };
+
+    /* All zero when the controller connected with the public address */
+    if ((ownRpa != NULL) && (memcmp(ownRpa, noRpa, BDADDR_SIZE) != 0)) {
+        ownAddrType = BLEProtocol::AddressType::RANDOM_PRIVATE_RESOLVABLE;
+        memcpy(ownAddr, ownRpa, BDADDR_SIZE);
+#if BLE_PRIVACY
+        memcpy(localRpa, ownRpa, BDADDR_SIZE);
+        localRpaValid = true;
+#endif
+    } else {
+        ownAddrType = BLEProtocol::AddressType::PUBLIC;
+        if (readPublicAddress(ownAddr) != BLE_ERROR_NONE) {
+            memset(ownAddr, 0, BDADDR_SIZE);
+        }
+    }
+
+    ConnectionParams_t connectionParams;
+    connectionParams.minConnectionInterval        = interval;
+    connectionParams.maxConnectionInterval        = interval;
+    connectionParams.slaveLatency                 = latency;
+    connectionParams.connectionSupervisionTimeout = supervisionTimeout;
+
+    Role_t ownRole = (role == HCI_ROLE_MASTER) ? Gap::CENTRAL : Gap::PERIPHERAL;
+    BLEProtocol::AddressType_t peerType = (peerAddrType == PUBLIC_ADDR) ? BLEProtocol::AddressType::PUBLIC
+                                                                        : BLEProtocol::AddressType::RANDOM_STATIC;
+    BlueNRG1_Links::getInstance().add(handle, ownRole, peerType, peerAddr, &connectionParams);
+    connManager.onLinksChanged();
+    telemetry.onLinksChanged();
+
+    /* The collector exchanges the MTU before its discovery, see BlueNRG1_GattClient */
+    if ((ownRole == Gap::PERIPHERAL) && (BLE_MAX_ATT_MTU > BLE_LINK_DEFAULT_ATT_MTU)) {
+        BLE_TRACE_COMMAND(ACI_GATT_EXCHANGE_CONFIG_OPCODE, BLE_TRACE_PARAMS.u16(handle),
+                          aci_gatt_exchange_config(handle));
+        BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    }
+
+    processConnectionEvent(handle,
+                           ownRole,
+                           peerType,
+                           peerAddr,
+                           ownAddrType,
+                           ownAddr,
+                           &connectionParams);
+}
+
+void BlueNRG1_Gap::onDisconnectionComplete(uint8_t status, Handle_t handle, uint8_t reason)
+{
+    if (status != BLE_STATUS_SUCCESS) {
+        return;
+    }
+
+    BlueNRG1_SecurityManager::getInstance().onDisconnection(handle);
+    BlueNRG1_Links::getInstance().remove(handle);
+    connManager.onLinksChanged();
+    telemetry.onLinksChanged();
+    radioScheduler.onLinksChanged();
+    txPowerControl.onLinksChanged();
+    BlueNRG1_GattServer::getInstance().onDisconnection(handle);
+    BlueNRG1_GattClient::getInstance().onDisconnection(handle);
+#if BLE_OTA
+    BlueNRG1_OtaService::getInstance().onDisconnection(handle);
+#endif
+
+    processDisconnectionEvent(handle, (DisconnectionReason_t)reason);
+}
+
+void BlueNRG1_Gap::onConnectionUpdateComplete(uint8_t status, Handle_t handle, uint16_t interval,
+                                              uint16_t latency, uint16_t supervisionTimeout)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link == NULL) {
+        return;
+    }
+
+    if (status == BLE_STATUS_SUCCESS) {
+        link->params.minConnectionInterval        = interval;
+        link->params.maxConnectionInterval        = interval;
+        link->params.slaveLatency                 = latency;
+        link->params.connectionSupervisionTimeout = supervisionTimeout;
+    }
+    connManager.onUpdateComplete(handle, status);
+}
+
+
+extern "C" void hci_le_connection_complete_event(uint8_t Status,
+                                                 uint16_t Connection_Handle,
+                                                 uint8_t Role,
+                                                 uint8_t Peer_Address_Type,
+                                                 uint8_t Peer_Address[6],
+                                                 uint16_t Conn_Interval,
+                                                 uint16_t Conn_Latency,
+                                                 uint16_t Supervision_Timeout,
+                                                 uint8_t Master_Clock_Accuracy)
+{
+    BLE_EVENT_SCOPE(LE_CONNECTION_COMPLETE);
+    BLE_TRACE_LE_EVENT(HCI_LE_EVT_CONN_COMPLETE,
+                       BLE_TRACE_PARAMS.u8(Status).u16(Connection_Handle).u8(Role).u8(Peer_Address_Type)
+                                       .bytes(Peer_Address, 6).u16(Conn_Interval).u16(Conn_Latency)
+                                       .u16(Supervision_Timeout).u8(Master_Clock_Accuracy));
+
+    BlueNRG1_Gap::getInstance().onConnectionComplete(Status, Connection_Handle, Role, Peer_Address_Type, Peer_Address,
+                                                     Conn_Interval, Conn_Latency, Supervision_Timeout, NULL);
+}
+
+/* Sent instead of hci_le_connection_complete_event with the controller privacy */
+extern "C" void hci_le_enhanced_connection_complete_event(uint8_t Status,
+                                                          uint16_t Connection_Handle,
+                                                          uint8_t Role,
+                                                          uint8_t Peer_Address_Type,
+                                                          uint8_t Peer_Address[6],
+                                                          uint8_t Local_Resolvable_Private_Address[6],
+                                                          uint8_t Peer_Resolvable_Private_Address[6],
+                                                          uint16_t Conn_Interval,
+                                                          uint16_t Conn_Latency,
+                                                          uint16_t Supervision_Timeout,
+                                                          uint8_t Master_Clock_Accuracy)
+{
+    BLE_EVENT_SCOPE(LE_ENHANCED_CONNECTION_COMPLETE);
+    BLE_TRACE_LE_EVENT(HCI_LE_EVT_ENHANCED_CONN_COMPLETE,
+                       BLE_TRACE_PARAMS.u8(Status).u16(Connection_Handle).u8(Role).u8(Peer_Address_Type)
+                                       .bytes(Peer_Address, 6).bytes(Local_Resolvable_Private_Address, 6)
+                                       .bytes(Peer_Resolvable_Private_Address, 6).u16(Conn_Interval)
+                                       .u16(Conn_Latency).u16(Supervision_Timeout).u8(Master_Clock_Accuracy));
+
+    /* A resolved peer comes with its identity address, public and public identity types are even */
+    BlueNRG1_Gap::getInstance().onConnectionComplete(Status, Connection_Handle, Role,
+                                                     (Peer_Address_Type & 0x01) ? STATIC_RANDOM_ADDR : PUBLIC_ADDR,
+                                                     Peer_Address, Conn_Interval, Conn_Latency, Supervision_Timeout,
+                                                     Local_Resolvable_Private_Address);
+}
+
+extern "C" void hci_disconnection_complete_event(uint8_t Status,
+                                                 uint16_t Connection_Handle,
+                                                 uint8_t Reason)
+{
+    BLE_EVENT_SCOPE(DISCONNECTION_COMPLETE);
+    BLE_TRACE_EVENT(HCI_EVT_DISCONN_COMPLETE, BLE_TRACE_PARAMS.u8(Status).u16(Connection_Handle).u8(Reason));
+
+    BlueNRG1_Gap::getInstance().onDisconnectionComplete(Status, Connection_Handle, Reason);
+}
+
+extern "C" void hci_le_connection_update_complete_event(uint8_t Status,
+                                                        uint16_t Connection_Handle,
+                                                        uint16_t Conn_Interval,
+                                                        uint16_t Conn_Latency,
+                                                        uint16_t Supervision_Timeout)
+{
+    BLE_EVENT_SCOPE(LE_CONNECTION_UPDATE_COMPLETE);
+    BLE_TRACE_LE_EVENT(HCI_LE_EVT_CONN_UPDATE_COMPLETE,
+                       BLE_TRACE_PARAMS.u8(Status).u16(Connection_Handle).u16(Conn_Interval).u16(Conn_Latency)
+                                       .u16(Supervision_Timeout));
+
+    BlueNRG1_Gap::getInstance().onConnectionUpdateComplete(Status, Connection_Handle, Conn_Interval,
+                                                           Conn_Latency, Supervision_Timeout);
+}
+
+extern "C" void hci_le_advertising_report_event(uint8_t Num_Reports,
+                                                Advertising_Report_t Advertising_Report[])
+{
+    BLE_EVENT_SCOPE(LE_ADVERTISING_REPORT);
+
+    for (uint8_t i = 0; i < Num_Reports; i++) {
+        BLE_TRACE_LE_EVENT(HCI_LE_EVT_ADV_REPORT,
+                           BLE_TRACE_PARAMS.u8(1).u8(Advertising_Report[i].Event_Type)
+                                           .u8(Advertising_Report[i].Address_Type)
+                                           .bytes(Advertising_Report[i].Address, 6)
+                                           .u8(Advertising_Report[i].Length_Data)
+                                           .bytes(Advertising_Report[i].Data, Advertising_Report[i].Length_Data)
+                                           .u8(Advertising_Report[i].RSSI));
+        BlueNRG1_Gap::getInstance().onAdvertisingReport(Advertising_Report[i].Event_Type,
+                                                        Advertising_Report[i].Address_Type,
+                                                        Advertising_Report[i].Address,
+                                                        (int8_t)Advertising_Report[i].RSSI,
+                                                        Advertising_Report[i].Length_Data,
+                                                        Advertising_Report[i].Data);
+    }
+}
+
+extern "C" void aci_gap_proc_complete_event(uint8_t Procedure_Code,
+                                            uint8_t Status,
+                                            uint8_t Data_Length,
+                                            uint8_t Data[])
+{
+    BLE_EVENT_SCOPE(GAP_PROC_COMPLETE);
+    BLE_TRACE_VS_EVENT(ACI_GAP_PROC_COMPLETE_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u8(Procedure_Code).u8(Status).u8(Data_Length).bytes(Data, Data_Length));
+
+    BlueNRG1_Gap::getInstance().onProcedureComplete(Procedure_Code, Status);
+}
@@ -13,6 +13,12 @@
 #include "ble/GapAdvertisingData.h"
 #include "ble/Gap.h"
 
+#include "BlueNRG1_AdvScheduler.h"
+#include "BlueNRG1_ConnManager.h"
+#include "BlueNRG1_RadioScheduler.h"
+#include "BlueNRG1_Telemetry.h"
+#include "BlueNRG1_TxPowerControl.h"
+
 #define BLE_CONN_HANDLE_INVALID 0x0
 #define BDADDR_SIZE 6
 
@@ -37,10 +43,40 @@
 #define MAX_INT_CONN   0x0C80 //=>4000msec
 #define DEF_INT_CONN   0x0140 //=>400msec (default value for connection interval)
 
+/* Give up a connection attempt to a silent peer after this delay */
+#ifndef BLE_CONNECT_TIMEOUT_MS
+#define BLE_CONNECT_TIMEOUT_MS 5000
+#endif
+
+/* Largest advertising or scan response payload */
+#define BLE_ADV_DATA_MAX_LEN GAP_ADVERTISING_DATA_MAX_PAYLOAD
+
 /**************************************************************************/
 /*!
     \brief
+    GAP peripheral on top of the BlueNRG-1 ACI.
+
+    advData/scanRspData mirror what the controller currently advertises, so
+    that setAdvertisingData() only pushes the AD structures that changed
+    while advertising keeps running.
+
+    The advertising interval follows advScheduler: fast right after
+    startAdvertising(), then the one set by the application, which
+    startSlowAdvertising() uses from the start. A bonded
+    peer is called back with startDirectedAdvertising(), or let in alone
+    through the whitelist BlueNRG1_SecurityManager fills, with the
+    advertising policy mode. With BLE_PRIVACY every procedure uses a
+    resolvable private address of the controller, and the peers come
+    with their identity address once resolved.
 
+    Once connected, connManager adapts the connection parameters of every
+    link to its notification traffic, telemetry samples its quality and
+    txPowerControl lowers the output power as far as the worst link allows;
+    radioScheduler places application work around the radio activity.
+
+    As central, scanning and connection establishment are both GAP
+    procedures and the stack runs one at a time: connect() stops the scan
+    and the connection is created once the stack reports it stopped.
 */
 /**************************************************************************/
 class BlueNRG1_Gap : public Gap
@@ -51,9 +87,128 @@ public:
         return m_instance;
     }
     
+    virtual ble_error_t getAddress(BLEProtocol::AddressType_t *typeP, BLEProtocol::AddressBytes_t address);
+    virtual uint16_t    getMinAdvertisingInterval(void) const;
+    virtual uint16_t    getMinNonConnectableAdvertisingInterval(void) const;
+    virtual uint16_t    getMaxAdvertisingInterval(void) const;
     virtual ble_error_t setAdvertisingData(const GapAdvertisingData &, const GapAdvertisingData &);
     virtual ble_error_t startAdvertising(const GapAdvertisingParams &);
-    
+    virtual ble_error_t stopAdvertising(void);
+    virtual ble_error_t setAdvertisingPolicyMode(AdvertisingPolicyMode_t mode);
+    virtual AdvertisingPolicyMode_t getAdvertisingPolicyMode(void) const {
+        return advPolicy;
+    }
+    virtual ble_error_t stopScan(void);
+    virtual ble_error_t connect(const BLEProtocol::AddressBytes_t peerAddr,
+                                BLEProtocol::AddressType_t peerAddrType,
+                                const ConnectionParams_t *connectionParams,
+                                const GapScanningParams *scanParams);
+    virtual ble_error_t disconnect(Handle_t connectionHandle, DisconnectionReason_t reason);
+
+    using Gap::connect;
+    using Gap::disconnect;
+
+    /* startAdvertising() with the parameters set, at their interval without fast phase */
+    ble_error_t startSlowAdvertising(void);
+
+    /* High duty cycle directed advertising, an advertising timeout after 1.28 s without connection */
+    ble_error_t startDirectedAdvertising(BLEProtocol::AddressType_t peerAddrType,
+                                         const BLEProtocol::AddressBytes_t peerAddr);
+
+    /* Address type of the advertiser, valid inside an onAdvertisementReport callback */
+    BLEProtocol::AddressType_t getReportAddressType(void) const {
+        return reportAddrType;
+    }
+
+    BlueNRG1_AdvScheduler &getAdvScheduler(void) {
+        return advScheduler;
+    }
+    /* Entry point for the BLUENRG1_VTIMER_ADV_SCHEDULER expiry */
+    void onAdvSchedulerTimeout(void);
+
+    BlueNRG1_ConnManager &getConnManager(void) {
+        return connManager;
+    }
+
+    BlueNRG1_Telemetry &getTelemetry(void) {
+        return telemetry;
+    }
+
+    BlueNRG1_RadioScheduler &getRadioScheduler(void) {
+        return radioScheduler;
+    }
+
+    BlueNRG1_TxPowerControl &getTxPowerControl(void) {
+        return txPowerControl;
+    }
+
+    /* Entry point for hci_le_connection_complete_event and hci_le_enhanced_connection_complete_event,
+       with the resolvable private address the controller connected with, NULL or zero if none */
+    void onConnectionComplete(uint8_t status, Handle_t handle, uint8_t role,
+                              uint8_t peerAddrType, const uint8_t peerAddr[BDADDR_SIZE],
+                              uint16_t interval, uint16_t latency, uint16_t supervisionTimeout,
+                              const uint8_t ownRpa[BDADDR_SIZE]);
+    /* Entry point for hci_disconnection_complete_event */
+    void onDisconnectionComplete(uint8_t status, Handle_t handle, uint8_t reason);
+    /* Entry point for hci_le_connection_update_complete_event */
+    void onConnectionUpdateComplete(uint8_t status, Handle_t handle, uint16_t interval,
+                                    uint16_t latency, uint16_t supervisionTimeout);
+    /* Entry point for hci_le_advertising_report_event */
+    void onAdvertisingReport(uint8_t eventType, uint8_t addrType, const uint8_t addr[BDADDR_SIZE],
+                             int8_t rssi, uint8_t len, const uint8_t *data);
+    /* Entry point for aci_gap_proc_complete_event */
+    void onProcedureComplete(uint8_t procedureCode, uint8_t status);
+    /* Entry point for the BLUENRG1_VTIMER_CONNECT expiry */
+    void onConnectTimeout(void);
+
+protected:
+    virtual ble_error_t startRadioScan(const GapScanningParams &scanningParams);
+
+private:
+    BlueNRG1_Gap();
+
+    ble_error_t readPublicAddress(BLEProtocol::AddressBytes_t address);
+    ble_error_t updateAdvData(const GapAdvertisingData &advPayload);
+    ble_error_t updateScanResponse(const GapAdvertisingData &scanResponse);
+    ble_error_t enterDiscoverable(uint8_t type, uint16_t interval);
+    ble_error_t beginAdvertising(const GapAdvertisingParams &params, bool fastPhase);
+    ble_error_t createConnection(void);
+
+    typedef enum {
+        SCAN_IDLE,
+        SCAN_RUNNING,
+        SCAN_STOPPING     /**< Waiting for aci_gap_proc_complete_event. */
+    } ScanState_t;
+
+    uint8_t advData[BLE_ADV_DATA_MAX_LEN];      /**< AD structures held by the controller. */
+    uint8_t advDataLen;
+    uint8_t scanRspData[BLE_ADV_DATA_MAX_LEN];  /**< Scan response held by the controller. */
+    uint8_t scanRspLen;
+
+    BlueNRG1_AdvScheduler advScheduler;
+    uint8_t               advType;      /**< ADV_IND, ADV_SCAN_IND or ADV_NONCONN_IND. */
+    AdvertisingPolicyMode_t advPolicy;  /**< Filter policy of the next undirected advertising. */
+    bool                  directedAdv;  /**< Advertising is directed, without payload. */
+
+    BlueNRG1_ConnManager  connManager;
+    BlueNRG1_Telemetry    telemetry;
+    BlueNRG1_RadioScheduler radioScheduler;
+    BlueNRG1_TxPowerControl txPowerControl;
+
+    ScanState_t                scanState;
+    BLEProtocol::AddressType_t reportAddrType;
+
+    bool                       connectPending;    /**< connect() waits for the scan to stop. */
+    bool                       connecting;        /**< Connection establishment procedure running. */
+    bool                       connectTimedOut;
+    uint8_t                    peerAddrType;      /**< PUBLIC_ADDR or STATIC_RANDOM_ADDR. */
+    BLEProtocol::AddressBytes_t peerAddr;
+    ConnectionParams_t         peerParams;
+    uint16_t                   connScanInterval;  /**< 0.625 ms units. */
+    uint16_t                   connScanWindow;    /**< 0.625 ms units. */
+
+    bool                       localRpaValid;
+    BLEProtocol::AddressBytes_t localRpa;         /**< Own address of the last connection, with BLE_PRIVACY. */
 };
 
 
@@ -0,0 +1,288 @@
+#include "BlueNRG1_GattCache.h"
+#include "BlueNRG1_Gap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "compiler.h"
+#include "BlueNRG1_flash.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* First word of a valid log record */
+#define GATT_CACHE_MAGIC        0x47434331 /* "GCC1" */
+
+/* Erased flash */
+#define FLASH_ERASED_WORD       0xFFFFFFFF
+
+#define GATT_CACHE_RECORDS      (BLE_GATT_CACHE_PAGE_SIZE / sizeof(Record_t))
+
+/* A record is two bursts */
+#define GATT_CACHE_RECORD_US    (2 * BLE_GATT_CACHE_BURST_PROGRAM_US)
+
+/* FLASH page reserved for the cache log, see BLOCK_GATT_CACHE in the linker scripts */
+ALIGN(2048)
+SECTION(".noinit.gatt_cache_flash_data")
+NOLOAD(const uint32_t gatt_cache_flash_data[BLE_GATT_CACHE_PAGE_SIZE >> 2]);
+
+BlueNRG1_GattCache::BlueNRG1_GattCache() :
+    count(0),
+    nextVictim(0),
+    writeOffset(0),
+    loaded(false),
+    pendingCount(0),
+    compactPending(false),
+    flushScheduled(false),
+    flushBudgetUs(0)
+{
+}
+
+uint32_t BlueNRG1_GattCache::checksum(const Record_t &record)
+{
+    const uint32_t *words = (const uint32_t *)&record;
+    uint32_t sum = 0;
+
+    for (uint8_t i = 0; i < (sizeof(Record_t) >> 2) - 1; i++) {
+        sum = ((sum << 1) | (sum >> 31)) ^ words[i];
+    }
+
+    return sum;
+}
+
+int BlueNRG1_GattCache::indexOf(uint8_t addrType, const uint8_t addr[6]) const
+{
+    for (uint8_t i = 0; i < count; i++) {
+        if ((entries[i].addrType == addrType) && (memcmp(entries[i].addr, addr, 6) == 0)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Insert, replace or remove (valueHandle == 0) the entry of a
+            peer in the RAM table
+*/
+/**************************************************************************/
+void BlueNRG1_GattCache::apply(const BlueNRG1_GattCacheEntry_t &entry)
+{
+    int index = indexOf(entry.addrType, entry.addr);
+
+    if (entry.valueHandle == 0) {
+        if (index >= 0) {
+            entries[index] = entries[count - 1];
+            count--;
+        }
+        return;
+    }
+
+    if (index < 0) {
+        if (count < BLE_GATT_CACHE_ENTRIES) {
+            index = count++;
+        } else {
+            index = nextVictim;
+            nextVictim = (nextVictim + 1) % BLE_GATT_CACHE_ENTRIES;
+        }
+    }
+    entries[index] = entry;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Replay the flash log; a page holding anything else than
+            records is erased
+*/
+/**************************************************************************/
+void BlueNRG1_GattCache::load(void)
+{
+    const Record_t *records = (const Record_t *)gatt_cache_flash_data;
+
+    loaded = true;
+    count  = 0;
+
+    for (writeOffset = 0; writeOffset < GATT_CACHE_RECORDS; writeOffset++) {
+        const Record_t &record = records[writeOffset];
+
+        if (record.magic == FLASH_ERASED_WORD) {
+            return;
+        }
+        if ((record.magic != GATT_CACHE_MAGIC) || (record.checksum != checksum(record))) {
+            break;
+        }
+        apply(record.entry);
+    }
+
+    if (writeOffset < GATT_CACHE_RECORDS) {
+        /* Interrupted write or foreign data: keep what was read */
+        compactPending = true;
+        scheduleFlush();
+    }
+}
+
+/* A change for the log, the whole table is rewritten once more are waiting than it holds */
+void BlueNRG1_GattCache::queue(const BlueNRG1_GattCacheEntry_t &entry)
+{
+    if (!compactPending) {
+        if (pendingCount < BLE_GATT_CACHE_ENTRIES) {
+            pending[pendingCount++] = entry;
+        } else {
+            compactPending = true;
+            pendingCount   = 0;
+        }
+    }
+    scheduleFlush();
+}
+
+/* Window the waiting changes need: the records, or a page erase and the table when the log is full */
+uint16_t BlueNRG1_GattCache::flushDuration(void) const
+{
+    if (compactPending || ((writeOffset + pendingCount) > GATT_CACHE_RECORDS)) {
+        return BLE_GATT_CACHE_PAGE_ERASE_US + (count * GATT_CACHE_RECORD_US);
+    }
+
+    return pendingCount * GATT_CACHE_RECORD_US;
+}
+
+void BlueNRG1_GattCache::scheduleFlush(void)
+{
+    if (flushScheduled) {
+        return;
+    }
+
+    BlueNRG1_RadioScheduler &scheduler = BlueNRG1_Gap::getInstance().getRadioScheduler();
+    flushBudgetUs = flushDuration();
+    flushScheduled = (scheduler.callWhenRadioIdle(callback(this, &BlueNRG1_GattCache::flush), flushBudgetUs) ==
+                      BLE_ERROR_NONE);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Write the waiting changes to the log, in an idle radio window
+
+    Changes made since the window was queued may need a longer one: it
+    is then queued again with their duration.
+*/
+/**************************************************************************/
+void BlueNRG1_GattCache::flush(void)
+{
+    flushScheduled = false;
+
+    if (flushDuration() > flushBudgetUs) {
+        scheduleFlush();
+        return;
+    }
+
+    if (compactPending) {
+        compact();
+    } else {
+        for (uint8_t i = 0; i < pendingCount; i++) {
+            append(pending[i]);
+        }
+    }
+    pendingCount   = 0;
+    compactPending = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Erase the page and write back the RAM entries
+
+    Erasing stalls the core for about 20 ms: it only happens once every
+    GATT_CACHE_RECORDS updates, from flush().
+*/
+/**************************************************************************/
+void BlueNRG1_GattCache::compact(void)
+{
+    FLASH_ErasePage((uint16_t)(((uint32_t)(uintptr_t)gatt_cache_flash_data - FLASH_START) / N_BYTES_PAGE));
+    writeOffset = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        append(entries[i]);
+    }
+}
+
+void BlueNRG1_GattCache::append(const BlueNRG1_GattCacheEntry_t &entry)
+{
+    Record_t record;
+
+    if (writeOffset >= GATT_CACHE_RECORDS) {
+        /* The RAM table already holds entry */
+        compact();
+        return;
+    }
+
+    memset(&record, 0xFF, sizeof(record));
+    record.magic    = GATT_CACHE_MAGIC;
+    record.entry    = entry;
+    record.checksum = checksum(record);
+
+    uint32_t  address = (uint32_t)(uintptr_t)&gatt_cache_flash_data[writeOffset * (sizeof(Record_t) >> 2)];
+    uint32_t *words   = (uint32_t *)&record;
+    FLASH_ProgramWordBurst(address, &words[0]);
+    FLASH_ProgramWordBurst(address + 16, &words[4]);
+    writeOffset++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Handles previously discovered on a peer
+
+    @returns    NULL when the peer is unknown
+*/
+/**************************************************************************/
+const BlueNRG1_GattCacheEntry_t *BlueNRG1_GattCache::find(BLEProtocol::AddressType_t addrType, const BLEProtocol::AddressBytes_t addr)
+{
+    if (!loaded) {
+        load();
+    }
+
+    int index = indexOf((uint8_t)addrType, addr);
+
+    return (index >= 0) ? &entries[index] : NULL;
+}
+
+void BlueNRG1_GattCache::store(const BlueNRG1_GattCacheEntry_t &entry)
+{
+    if (!loaded) {
+        load();
+    }
+
+    int index = indexOf(entry.addrType, entry.addr);
+    if ((index >= 0) && (memcmp(&entries[index], &entry, sizeof(entry)) == 0)) {
+        return;
+    }
+
+    apply(entry);
+    queue(entry);
+}
+
+void BlueNRG1_GattCache::invalidate(BLEProtocol::AddressType_t addrType, const BLEProtocol::AddressBytes_t addr)
+{
+    BlueNRG1_GattCacheEntry_t entry;
+
+    if (!loaded) {
+        load();
+    }
+    if (indexOf((uint8_t)addrType, addr) < 0) {
+        return;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.addrType = (uint8_t)addrType;
+    memcpy(entry.addr, addr, sizeof(entry.addr));
+
+    apply(entry);
+    queue(entry);
+}
+
+void BlueNRG1_GattCache::clear(void)
+{
+    loaded         = true;
+    count          = 0;
+    pendingCount   = 0;
+    compactPending = true;
+    scheduleFlush();
+}
@@ -0,0 +1,106 @@
+#ifndef __BLUENRG1_GATTCACHE_H__
+#define __BLUENRG1_GATTCACHE_H__
+
+#ifdef YOTTA_CFG_MBED_OS
+    #include "mbed-drivers/mbed.h"
+#else
+    #include "mbed.h"
+#endif
+#include "ble/blecommon.h"
+#include "ble/BLEProtocol.h"
+
+/* Peers whose discovery results are kept in RAM */
+#define BLE_GATT_CACHE_ENTRIES      8
+
+/* Flash page holding the cache log, reserved by the linker script */
+#define BLE_GATT_CACHE_PAGE_SIZE    2048
+
+/* Flash timings the idle radio windows are asked for, us */
+#define BLE_GATT_CACHE_PAGE_ERASE_US    21500
+#define BLE_GATT_CACHE_BURST_PROGRAM_US 180
+
+/**************************************************************************/
+/*!
+    \brief
+    Handles discovered on a peer, a valueHandle of 0 marks a removed entry.
+*/
+/**************************************************************************/
+typedef struct {
+    uint8_t  addrType;        /**< BLEProtocol::AddressType_t. */
+    uint8_t  addr[6];
+    uint8_t  reserved;
+    uint16_t serviceStart;    /**< Heart Rate service range. */
+    uint16_t serviceEnd;
+    uint16_t valueHandle;     /**< Heart Rate Measurement value. */
+    uint16_t cccdHandle;
+    uint16_t scValueHandle;   /**< Service Changed value, 0 if absent. */
+    uint16_t scCccdHandle;
+} BlueNRG1_GattCacheEntry_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    Discovery cache keyed by peer identity address.
+
+    The entries live in RAM and every change is appended to a log in a
+    dedicated flash page, replayed on the first lookup after reset. When
+    the page is full it is erased and rewritten with the RAM entries.
+
+    The lookups and changes come from GATT client events while links are
+    up: the flash is only written from an idle window of
+    BlueNRG1_RadioScheduler, the RAM table stays authoritative until then.
+    Changes waiting when no window could be queued go with the next one.
+*/
+/**************************************************************************/
+class BlueNRG1_GattCache
+{
+public:
+    static BlueNRG1_GattCache &getInstance() {
+        static BlueNRG1_GattCache m_instance;
+        return m_instance;
+    }
+
+    const BlueNRG1_GattCacheEntry_t *find(BLEProtocol::AddressType_t addrType, const BLEProtocol::AddressBytes_t addr);
+    void store(const BlueNRG1_GattCacheEntry_t &entry);
+    void invalidate(BLEProtocol::AddressType_t addrType, const BLEProtocol::AddressBytes_t addr);
+    void clear(void);
+
+private:
+    BlueNRG1_GattCache();
+
+    /* Log record: magic, entry, checksum; programmed as two bursts of 4 words */
+    typedef struct {
+        uint32_t                  magic;
+        BlueNRG1_GattCacheEntry_t entry;
+        uint32_t                  unused;
+        uint32_t                  checksum;
+    } Record_t;
+
+    void      load(void);
+    void      apply(const BlueNRG1_GattCacheEntry_t &entry);
+    void      queue(const BlueNRG1_GattCacheEntry_t &entry);
+    uint16_t  flushDuration(void) const;
+    void      scheduleFlush(void);
+    void      flush(void);
+    void      append(const BlueNRG1_GattCacheEntry_t &entry);
+    void      compact(void);
+    int       indexOf(uint8_t addrType, const uint8_t addr[6]) const;
+    static uint32_t checksum(const Record_t &record);
+
+    BlueNRG1_GattCacheEntry_t entries[BLE_GATT_CACHE_ENTRIES];
+    uint8_t                   count;
+    uint8_t                   nextVictim;    /**< Round robin replacement when full. */
+    uint16_t                  writeOffset;   /**< First free record of the log. */
+    bool                      loaded;
+
+    BlueNRG1_GattCacheEntry_t pending[BLE_GATT_CACHE_ENTRIES]; /**< Changes not in the log yet. */
+    uint8_t                   pendingCount;
+    bool                      compactPending; /**< The page must be rewritten from the RAM table. */
+    bool                      flushScheduled;
+    uint16_t                  flushBudgetUs;  /**< Window flush() was queued with. */
+
+    MBED_STATIC_ASSERT(sizeof(Record_t) == 32, "Log record must be two flash bursts");
+    MBED_STATIC_ASSERT((BLE_GATT_CACHE_ENTRIES * 32) <= BLE_GATT_CACHE_PAGE_SIZE, "Cache does not fit its flash page");
+};
+
+#endif //__BLUENRG1_GATTCACHE_H__
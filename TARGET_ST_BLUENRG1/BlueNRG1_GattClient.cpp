@@ -0,0 +1,641 @@
+#include "BlueNRG1_GattClient.h"
+#include "BlueNRG1_Events.h"
+#include "BlueNRG1_Gap.h"
+#include "BlueNRG1_GattCache.h"
+#include "BlueNRG1_Links.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_Trace.h"
+#include "hal/us_ticker_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_const.h"
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_events.h"
+#include "bluenrg1_gatt_server.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* UUIDs of the Heart Rate profile */
+#define HRM_SERVICE_UUID            0x180D
+#define HRM_MEASUREMENT_UUID        0x2A37
+#define CHAR_DECLARATION_UUID       0x2803
+#define CCCD_UUID                   0x2902
+
+/* Flags of the Heart Rate Measurement value */
+#define HRM_FLAG_VALUE_UINT16       0x01
+
+/* Format of aci_att_find_info_resp_event with 16 bit UUIDs */
+#define FIND_INFO_FORMAT_UUID_16    0x01
+
+/* CCCD bits */
+#define CCCD_NOTIFICATION           0x0001
+#define CCCD_INDICATION             0x0002
+
+BlueNRG1_GattClient::BlueNRG1_GattClient() :
+    GattClient()
+{
+    memset(hrmLinks, 0, sizeof(hrmLinks));
+}
+
+BlueNRG1_HrmLink_t *BlueNRG1_GattClient::findLink(Gap::Handle_t connectionHandle)
+{
+    for (uint8_t i = 0; i < MAX_ACTIVE_CONNECTIONS; i++) {
+        if ((hrmLinks[i].state != HRM_IDLE) && (hrmLinks[i].connHandle == connectionHandle)) {
+            return &hrmLinks[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start the full discovery of the link, from the Heart Rate
+            service
+*/
+/**************************************************************************/
+uint8_t BlueNRG1_GattClient::startDiscovery(BlueNRG1_HrmLink_t *link)
+{
+    UUID_t uuid;
+
+    link->serviceStart  = 0;
+    link->serviceEnd    = 0;
+    link->valueHandle   = 0;
+    link->cccdHandle    = 0;
+    link->scValueHandle = 0;
+    link->scCccdHandle  = 0;
+    link->cached        = false;
+    link->stale         = false;
+    link->state         = HRM_DISCOVER_SERVICE;
+
+    uuid.UUID_16 = HRM_SERVICE_UUID;
+    return BLE_TRACE_COMMAND(ACI_GATT_DISC_PRIMARY_SERVICE_BY_UUID_OPCODE,
+                             BLE_TRACE_PARAMS.u16(link->connHandle).u8(UUID_TYPE_16).u16(uuid.UUID_16),
+                             aci_gatt_disc_primary_service_by_uuid(link->connHandle, UUID_TYPE_16, &uuid));
+}
+
+uint8_t BlueNRG1_GattClient::writeCccd(BlueNRG1_HrmLink_t *link, uint16_t handle, uint16_t value, HrmState_t state)
+{
+    uint8_t cccd[2] = { (uint8_t)(value & 0xFF), (uint8_t)(value >> 8) };
+
+    link->state = state;
+    return BLE_TRACE_COMMAND(ACI_GATT_WRITE_CHAR_DESC_OPCODE,
+                             BLE_TRACE_PARAMS.u16(link->connHandle).u16(handle).u8(sizeof(cccd)).bytes(cccd, sizeof(cccd)),
+                             aci_gatt_write_char_desc(link->connHandle, handle, sizeof(cccd), cccd));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Take the handles of a known peer from BlueNRG1_GattCache and
+            write its CCCDs, or discover an unknown one
+*/
+/**************************************************************************/
+uint8_t BlueNRG1_GattClient::startSubscription(BlueNRG1_HrmLink_t *link)
+{
+    BlueNRG1_Link_t *peer = BlueNRG1_Links::getInstance().find(link->connHandle);
+    const BlueNRG1_GattCacheEntry_t *entry = NULL;
+
+    if (peer != NULL) {
+        entry = BlueNRG1_GattCache::getInstance().find(peer->peerAddrType, peer->peerAddr);
+    }
+    if (entry == NULL) {
+        return startDiscovery(link);
+    }
+
+    link->serviceStart  = entry->serviceStart;
+    link->serviceEnd    = entry->serviceEnd;
+    link->valueHandle   = entry->valueHandle;
+    link->cccdHandle    = entry->cccdHandle;
+    link->scValueHandle = entry->scValueHandle;
+    link->scCccdHandle  = entry->scCccdHandle;
+    link->cached        = true;
+    link->stale         = false;
+    if (link->scCccdHandle != 0) {
+        return writeCccd(link, link->scCccdHandle, CCCD_INDICATION, HRM_ENABLE_SC);
+    }
+    return writeCccd(link, link->cccdHandle, CCCD_NOTIFICATION, HRM_SUBSCRIBE);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start collecting the heart rate of a connected peripheral
+
+    The procedure exchanges the MTU first. A peer found in
+    BlueNRG1_GattCache then only gets its CCCDs written, otherwise the
+    discovery starts. It runs from the GATT events; a peer without Heart
+    Rate Measurement characteristic is disconnected.
+
+    @returns    BLE_ERROR_NO_MEM when MAX_ACTIVE_CONNECTIONS links are
+                already collected
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattClient::subscribeHeartRate(Gap::Handle_t connectionHandle)
+{
+    BlueNRG1_HrmLink_t *link = findLink(connectionHandle);
+    tBleStatus ret;
+
+    if (link != NULL) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    for (uint8_t i = 0; i < MAX_ACTIVE_CONNECTIONS; i++) {
+        if (hrmLinks[i].state == HRM_IDLE) {
+            link = &hrmLinks[i];
+            break;
+        }
+    }
+    if (link == NULL) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    /* The ring may still hold samples of the previous peer */
+    link->connHandle = connectionHandle;
+    link->cached     = false;
+    link->stale      = false;
+
+    if ((BLE_MAX_ATT_MTU > BLE_LINK_DEFAULT_ATT_MTU) &&
+        (BlueNRG1_Links::getInstance().getAttMtu(connectionHandle) == BLE_LINK_DEFAULT_ATT_MTU)) {
+        link->state = HRM_EXCHANGE_MTU;
+        ret = BLE_TRACE_COMMAND(ACI_GATT_EXCHANGE_CONFIG_OPCODE, BLE_TRACE_PARAMS.u16(connectionHandle),
+                                aci_gatt_exchange_config(connectionHandle));
+    } else {
+        ret = startSubscription(link);
+    }
+
+    if (ret != BLE_STATUS_SUCCESS) {
+        link->state = HRM_IDLE;
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_GattClient::saveHandles(const BlueNRG1_HrmLink_t *link)
+{
+    BlueNRG1_Link_t *peer = BlueNRG1_Links::getInstance().find(link->connHandle);
+    BlueNRG1_GattCacheEntry_t entry;
+
+    if (peer == NULL) {
+        return;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.addrType      = (uint8_t)peer->peerAddrType;
+    memcpy(entry.addr, peer->peerAddr, sizeof(entry.addr));
+    entry.serviceStart  = link->serviceStart;
+    entry.serviceEnd    = link->serviceEnd;
+    entry.valueHandle   = link->valueHandle;
+    entry.cccdHandle    = link->cccdHandle;
+    entry.scValueHandle = link->scValueHandle;
+    entry.scCccdHandle  = link->scCccdHandle;
+
+    BlueNRG1_GattCache::getInstance().store(entry);
+}
+
+/**************************************************************************/
+/*!
+    @brief  The GATT procedure of the link completed: start the next one,
+            drop the peer if a Heart Rate handle is missing
+*/
+/**************************************************************************/
+void BlueNRG1_GattClient::nextStep(BlueNRG1_HrmLink_t *link)
+{
+    tBleStatus ret = BLE_STATUS_FAILED;
+    UUID_t uuid;
+
+    switch (link->state) {
+        case HRM_EXCHANGE_MTU:
+            ret = startSubscription(link);
+            break;
+        case HRM_DISCOVER_SERVICE:
+            if (link->serviceEnd != 0) {
+                uuid.UUID_16 = HRM_MEASUREMENT_UUID;
+                ret = BLE_TRACE_COMMAND(ACI_GATT_DISC_CHAR_BY_UUID_OPCODE,
+                                        BLE_TRACE_PARAMS.u16(link->connHandle).u16(link->serviceStart)
+                                                        .u16(link->serviceEnd).u8(UUID_TYPE_16).u16(uuid.UUID_16),
+                                        aci_gatt_disc_char_by_uuid(link->connHandle, link->serviceStart,
+                                                                   link->serviceEnd, UUID_TYPE_16, &uuid));
+                link->state = HRM_DISCOVER_CHAR;
+            }
+            break;
+        case HRM_DISCOVER_CHAR:
+            if (link->valueHandle != 0) {
+                ret = BLE_TRACE_COMMAND(ACI_GATT_DISC_ALL_CHAR_DESC_OPCODE,
+                                        BLE_TRACE_PARAMS.u16(link->connHandle).u16(link->valueHandle)
+                                                        .u16(link->serviceEnd),
+                                        aci_gatt_disc_all_char_desc(link->connHandle, link->valueHandle,
+                                                                    link->serviceEnd));
+                link->state = HRM_DISCOVER_CCCD;
+            }
+            break;
+        case HRM_DISCOVER_CCCD:
+            if (link->cccdHandle != 0) {
+                uuid.UUID_16 = SERVICE_CHANGED_UUID;
+                ret = BLE_TRACE_COMMAND(ACI_GATT_DISC_CHAR_BY_UUID_OPCODE,
+                                        BLE_TRACE_PARAMS.u16(link->connHandle).u16(0x0001).u16(0xFFFF)
+                                                        .u8(UUID_TYPE_16).u16(uuid.UUID_16),
+                                        aci_gatt_disc_char_by_uuid(link->connHandle, 0x0001, 0xFFFF,
+                                                                   UUID_TYPE_16, &uuid));
+                link->state = HRM_DISCOVER_SC_CHAR;
+            }
+            break;
+        case HRM_DISCOVER_SC_CHAR:
+            if (link->scValueHandle != 0) {
+                /* The CCCD of Service Changed follows its value */
+                ret = BLE_TRACE_COMMAND(ACI_GATT_DISC_ALL_CHAR_DESC_OPCODE,
+                                        BLE_TRACE_PARAMS.u16(link->connHandle).u16(link->scValueHandle)
+                                                        .u16(link->scValueHandle + 1),
+                                        aci_gatt_disc_all_char_desc(link->connHandle, link->scValueHandle,
+                                                                    link->scValueHandle + 1));
+                link->state = HRM_DISCOVER_SC_CCCD;
+            } else {
+                ret = writeCccd(link, link->cccdHandle, CCCD_NOTIFICATION, HRM_SUBSCRIBE);
+            }
+            break;
+        case HRM_DISCOVER_SC_CCCD:
+            if (link->scCccdHandle != 0) {
+                ret = writeCccd(link, link->scCccdHandle, CCCD_INDICATION, HRM_ENABLE_SC);
+            } else {
+                ret = writeCccd(link, link->cccdHandle, CCCD_NOTIFICATION, HRM_SUBSCRIBE);
+            }
+            break;
+        case HRM_ENABLE_SC:
+            ret = writeCccd(link, link->cccdHandle, CCCD_NOTIFICATION, HRM_SUBSCRIBE);
+            break;
+        case HRM_SUBSCRIBE:
+            if (link->stale) {
+                ret = startDiscovery(link);
+                break;
+            }
+            if (!link->cached) {
+                saveHandles(link);
+            }
+            link->state = HRM_STREAMING;
+            return;
+        default:
+            return;
+    }
+
+    if (ret != BLE_STATUS_SUCCESS) {
+        link->state = HRM_IDLE;
+        BlueNRG1_Gap::getInstance().disconnect(link->connHandle, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+        return;
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+void BlueNRG1_GattClient::onServiceFound(uint16_t connectionHandle, uint16_t startHandle, uint16_t endHandle)
+{
+    BlueNRG1_HrmLink_t *link = findLink(connectionHandle);
+
+    /* Keep the first instance of the service */
+    if ((link != NULL) && (link->state == HRM_DISCOVER_SERVICE) && (link->serviceEnd == 0)) {
+        link->serviceStart = startHandle;
+        link->serviceEnd   = endHandle;
+    }
+}
+
+void BlueNRG1_GattClient::onCharacteristicFound(uint16_t connectionHandle, uint16_t declHandle,
+                                                uint8_t length, const uint8_t *value)
+{
+    BlueNRG1_HrmLink_t *link = findLink(connectionHandle);
+    (void)declHandle;
+
+    /* Properties (1), value handle (2), UUID */
+    if ((link == NULL) || (length < 3)) {
+        return;
+    }
+    if ((link->state == HRM_DISCOVER_CHAR) && (link->valueHandle == 0)) {
+        link->valueHandle = value[1] | (value[2] << 8);
+    } else if ((link->state == HRM_DISCOVER_SC_CHAR) && (link->scValueHandle == 0)) {
+        link->scValueHandle = value[1] | (value[2] << 8);
+    }
+}
+
+void BlueNRG1_GattClient::onDescriptorsFound(uint16_t connectionHandle, uint8_t format, uint8_t length, const uint8_t *pairs)
+{
+    BlueNRG1_HrmLink_t *link = findLink(connectionHandle);
+    uint16_t *cccdHandle;
+    uint16_t  lastHandle;
+
+    if ((link == NULL) || (format != FIND_INFO_FORMAT_UUID_16)) {
+        return;
+    }
+    if (link->state == HRM_DISCOVER_CCCD) {
+        cccdHandle = &link->cccdHandle;
+        lastHandle = link->serviceEnd;
+    } else if (link->state == HRM_DISCOVER_SC_CCCD) {
+        cccdHandle = &link->scCccdHandle;
+        lastHandle = link->scValueHandle + 1;
+    } else {
+        return;
+    }
+
+    for (uint8_t pos = 0; (pos + 4) <= length; pos += 4) {
+        uint16_t handle = pairs[pos] | (pairs[pos + 1] << 8);
+        uint16_t uuid   = pairs[pos + 2] | (pairs[pos + 3] << 8);
+
+        if ((handle > lastHandle) || (uuid == CHAR_DECLARATION_UUID)) {
+            /* Descriptors of the next characteristic follow */
+            break;
+        }
+        if ((uuid == CCCD_UUID) && (*cccdHandle == 0)) {
+            *cccdHandle = handle;
+        }
+    }
+}
+
+void BlueNRG1_GattClient::onProcedureComplete(uint16_t connectionHandle, uint8_t errorCode)
+{
+    BlueNRG1_HrmLink_t *link = findLink(connectionHandle);
+
+    if ((link == NULL) || (link->state == HRM_STREAMING)) {
+        return;
+    }
+
+    if ((errorCode != BLE_STATUS_SUCCESS) && link->cached) {
+        /* Cached handles no longer valid: the database changed */
+        BlueNRG1_Link_t *peer = BlueNRG1_Links::getInstance().find(connectionHandle);
+        if (peer != NULL) {
+            BlueNRG1_GattCache::getInstance().invalidate(peer->peerAddrType, peer->peerAddr);
+        }
+        if (startDiscovery(link) != BLE_STATUS_SUCCESS) {
+            link->state = HRM_IDLE;
+            BlueNRG1_Gap::getInstance().disconnect(connectionHandle, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+        }
+        BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+        return;
+    }
+
+    if ((errorCode != BLE_STATUS_SUCCESS) && (link->state == HRM_SUBSCRIBE)) {
+        link->state = HRM_IDLE;
+        BlueNRG1_Gap::getInstance().disconnect(connectionHandle, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+        return;
+    }
+
+    /* A discovery that found nothing ends with an error: nextStep() checks the handles.
+     * Service Changed is optional, a peer refusing its indications is still collected,
+     * so is a peer refusing the MTU exchange. */
+    nextStep(link);
+}
+
+/**************************************************************************/
+/*!
+    @brief  The peer database changed: forget its handles and discover
+            again once the link is idle
+*/
+/**************************************************************************/
+void BlueNRG1_GattClient::onServiceChanged(BlueNRG1_HrmLink_t *link)
+{
+    BlueNRG1_Link_t *peer = BlueNRG1_Links::getInstance().find(link->connHandle);
+
+    if (peer != NULL) {
+        BlueNRG1_GattCache::getInstance().invalidate(peer->peerAddrType, peer->peerAddr);
+    }
+
+    if (link->state != HRM_STREAMING) {
+        /* A procedure is running, restart when it completes */
+        link->stale = true;
+        return;
+    }
+    if (startDiscovery(link) != BLE_STATUS_SUCCESS) {
+        link->state = HRM_IDLE;
+        BlueNRG1_Gap::getInstance().disconnect(link->connHandle, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decode a Heart Rate Measurement into the ring of the link,
+            the oldest samples are kept when it is full
+*/
+/**************************************************************************/
+void BlueNRG1_GattClient::pushSample(BlueNRG1_HrmLink_t *link, uint8_t length, const uint8_t *value)
+{
+    BlueNRG1_HrmRing_t *ring = &link->ring;
+    uint8_t head = ring->head;
+
+    if (length < 2) {
+        return;
+    }
+    if ((uint8_t)(head - ring->tail) >= BLE_HRM_RING_SIZE) {
+        ring->dropped++;
+        return;
+    }
+
+    BlueNRG1_HrmSample_t *sample = &ring->samples[head & (BLE_HRM_RING_SIZE - 1)];
+    sample->timestamp  = us_ticker_read();
+    sample->connHandle = link->connHandle;
+    sample->flags      = value[0];
+    if ((value[0] & HRM_FLAG_VALUE_UINT16) && (length >= 3)) {
+        sample->heartRate = value[1] | (value[2] << 8);
+    } else {
+        sample->heartRate = value[1];
+    }
+
+    /* Publish the sample before the index */
+    __DMB();
+    ring->head = head + 1;
+}
+
+void BlueNRG1_GattClient::onHandleValue(uint16_t connectionHandle, uint16_t attrHandle, uint8_t length,
+                                        const uint8_t *value, HVXType_t type)
+{
+    BlueNRG1_HrmLink_t *link = findLink(connectionHandle);
+    BlueNRG1_Link_t *peer = BlueNRG1_Links::getInstance().find(connectionHandle);
+
+    /* Traffic measured by BlueNRG1_ConnManager */
+    if (peer != NULL) {
+        peer->notifyCount++;
+    }
+
+    if ((link != NULL) && (link->state == HRM_STREAMING) && (attrHandle == link->valueHandle)) {
+        pushSample(link, length, value);
+    }
+    if ((link != NULL) && (link->scValueHandle != 0) && (attrHandle == link->scValueHandle)) {
+        onServiceChanged(link);
+    }
+
+    GattHVXCallbackParams params;
+    params.connHandle = connectionHandle;
+    params.handle     = attrHandle;
+    params.type       = type;
+    params.len        = length;
+    params.data       = value;
+
+    processHVXEvent(&params);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Pop the oldest sample of all the links
+
+    Safe against the stack event handler filling the rings meanwhile;
+    there must be a single reader.
+
+    @returns    false when every ring is empty
+*/
+/**************************************************************************/
+bool BlueNRG1_GattClient::readHeartRate(BlueNRG1_HrmSample_t *sample)
+{
+    BlueNRG1_HrmRing_t *oldest = NULL;
+
+    for (uint8_t i = 0; i < MAX_ACTIVE_CONNECTIONS; i++) {
+        BlueNRG1_HrmRing_t *ring = &hrmLinks[i].ring;
+
+        if (ring->head == ring->tail) {
+            continue;
+        }
+        if ((oldest == NULL) ||
+            ((int32_t)(ring->samples[ring->tail & (BLE_HRM_RING_SIZE - 1)].timestamp -
+                       oldest->samples[oldest->tail & (BLE_HRM_RING_SIZE - 1)].timestamp) < 0)) {
+            oldest = ring;
+        }
+    }
+
+    if (oldest == NULL) {
+        return false;
+    }
+
+    uint8_t tail = oldest->tail;
+    *sample = oldest->samples[tail & (BLE_HRM_RING_SIZE - 1)];
+    /* Release the slot only once it is copied */
+    __DMB();
+    oldest->tail = tail + 1;
+
+    return true;
+}
+
+uint8_t BlueNRG1_GattClient::getHeartRateLinkCount(void) const
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < MAX_ACTIVE_CONNECTIONS; i++) {
+        if (hrmLinks[i].state == HRM_STREAMING) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+uint32_t BlueNRG1_GattClient::getHeartRateDropped(void) const
+{
+    uint32_t dropped = 0;
+
+    for (uint8_t i = 0; i < MAX_ACTIVE_CONNECTIONS; i++) {
+        dropped += hrmLinks[i].ring.dropped;
+    }
+
+    return dropped;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Free the slot of the link, the samples already received stay
+            readable
+*/
+/**************************************************************************/
+void BlueNRG1_GattClient::onDisconnection(Gap::Handle_t connectionHandle)
+{
+    BlueNRG1_HrmLink_t *link = findLink(connectionHandle);
+
+    if (link != NULL) {
+        link->state = HRM_IDLE;
+    }
+}
+
+
+extern "C" void aci_att_find_by_type_value_resp_event(uint16_t Connection_Handle,
+                                                      uint8_t Num_of_Handle_Pair,
+                                                      Attribute_Group_Handle_Pair_t Attribute_Group_Handle_Pair[])
+{
+    BLE_EVENT_SCOPE(FIND_BY_TYPE_VALUE_RESP);
+
+#if BLE_TRACE
+    BlueNRG1_TraceParams params;
+    params.u16(Connection_Handle).u8(Num_of_Handle_Pair);
+    for (uint8_t i = 0; i < Num_of_Handle_Pair; i++) {
+        params.u16(Attribute_Group_Handle_Pair[i].Found_Attribute_Handle)
+              .u16(Attribute_Group_Handle_Pair[i].Group_End_Handle);
+    }
+    BLE_TRACE_VS_EVENT(ACI_ATT_FIND_BY_TYPE_VALUE_RESP_VSEVT_CODE, params);
+#endif
+
+    for (uint8_t i = 0; i < Num_of_Handle_Pair; i++) {
+        BlueNRG1_GattClient::getInstance().onServiceFound(Connection_Handle,
+                                                          Attribute_Group_Handle_Pair[i].Found_Attribute_Handle,
+                                                          Attribute_Group_Handle_Pair[i].Group_End_Handle);
+    }
+}
+
+extern "C" void aci_gatt_disc_read_char_by_uuid_resp_event(uint16_t Connection_Handle,
+                                                           uint16_t Attribute_Handle,
+                                                           uint8_t Attribute_Value_Length,
+                                                           uint8_t Attribute_Value[])
+{
+    BLE_EVENT_SCOPE(DISC_READ_CHAR_BY_UUID_RESP);
+    BLE_TRACE_VS_EVENT(ACI_GATT_DISC_READ_CHAR_BY_UUID_RESP_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u16(Attribute_Handle).u8(Attribute_Value_Length)
+                                       .bytes(Attribute_Value, Attribute_Value_Length));
+
+    BlueNRG1_GattClient::getInstance().onCharacteristicFound(Connection_Handle, Attribute_Handle,
+                                                             Attribute_Value_Length, Attribute_Value);
+}
+
+extern "C" void aci_att_find_info_resp_event(uint16_t Connection_Handle,
+                                             uint8_t Format,
+                                             uint8_t Event_Data_Length,
+                                             uint8_t Handle_UUID_Pair[])
+{
+    BLE_EVENT_SCOPE(FIND_INFO_RESP);
+    BLE_TRACE_VS_EVENT(ACI_ATT_FIND_INFO_RESP_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u8(Format).u8(Event_Data_Length)
+                                       .bytes(Handle_UUID_Pair, Event_Data_Length));
+
+    BlueNRG1_GattClient::getInstance().onDescriptorsFound(Connection_Handle, Format, Event_Data_Length, Handle_UUID_Pair);
+}
+
+extern "C" void aci_gatt_proc_complete_event(uint16_t Connection_Handle,
+                                             uint8_t Error_Code)
+{
+    BLE_EVENT_SCOPE(GATT_PROC_COMPLETE);
+    BLE_TRACE_VS_EVENT(ACI_GATT_PROC_COMPLETE_VSEVT_CODE, BLE_TRACE_PARAMS.u16(Connection_Handle).u8(Error_Code));
+
+    BlueNRG1_GattClient::getInstance().onProcedureComplete(Connection_Handle, Error_Code);
+}
+
+extern "C" void aci_gatt_notification_event(uint16_t Connection_Handle,
+                                            uint16_t Attribute_Handle,
+                                            uint8_t Attribute_Value_Length,
+                                            uint8_t Attribute_Value[])
+{
+    BLE_EVENT_SCOPE(NOTIFICATION);
+    BLE_TRACE_VS_EVENT(ACI_GATT_NOTIFICATION_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u16(Attribute_Handle).u8(Attribute_Value_Length)
+                                       .bytes(Attribute_Value, Attribute_Value_Length));
+
+    BlueNRG1_GattClient::getInstance().onHandleValue(Connection_Handle, Attribute_Handle, Attribute_Value_Length,
+                                                     Attribute_Value, BLE_HVX_NOTIFICATION);
+}
+
+extern "C" void aci_gatt_indication_event(uint16_t Connection_Handle,
+                                          uint16_t Attribute_Handle,
+                                          uint8_t Attribute_Value_Length,
+                                          uint8_t Attribute_Value[])
+{
+    BLE_EVENT_SCOPE(INDICATION);
+    BLE_TRACE_VS_EVENT(ACI_GATT_INDICATION_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u16(Attribute_Handle).u8(Attribute_Value_Length)
+                                       .bytes(Attribute_Value, Attribute_Value_Length));
+
+    BlueNRG1_GattClient::getInstance().onHandleValue(Connection_Handle, Attribute_Handle, Attribute_Value_Length,
+                                                     Attribute_Value, BLE_HVX_INDICATION);
+    BLE_TRACE_COMMAND(ACI_GATT_CONFIRM_INDICATION_OPCODE, BLE_TRACE_PARAMS.u16(Connection_Handle),
+                      aci_gatt_confirm_indication(Connection_Handle));
+}
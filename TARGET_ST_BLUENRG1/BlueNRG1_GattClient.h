@@ -5,7 +5,7 @@
     #include "mbed-drivers/mbed.h"
 #else
     #include "mbed.h"
-#endif 
+#endif
 #include "ble/blecommon.h"
 //#include "btle.h"
 #include "ble/GattClient.h"
@@ -18,14 +18,127 @@ using namespace std;
 
 #define MAX_ACTIVE_CONNECTIONS 7
 
+/* Heart rate samples buffered per link, power of 2 up to 128 */
+#define BLE_HRM_RING_SIZE      16
+
+/**************************************************************************/
+/*!
+    \brief
+    One Heart Rate Measurement received from a peripheral.
+*/
+/**************************************************************************/
+typedef struct {
+    uint32_t      timestamp;   /**< us_ticker_read() when the notification arrived. */
+    Gap::Handle_t connHandle;
+    uint16_t      heartRate;   /**< Beats per minute. */
+    uint8_t       flags;       /**< Flags field of the measurement. */
+} BlueNRG1_HrmSample_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    Single producer, single consumer ring of samples: the stack event
+    handler only moves head, the reader only moves tail.
+*/
+/**************************************************************************/
+typedef struct {
+    BlueNRG1_HrmSample_t samples[BLE_HRM_RING_SIZE];
+    volatile uint8_t     head;
+    volatile uint8_t     tail;
+    uint32_t             dropped;     /**< Samples lost on a full ring. */
+} BlueNRG1_HrmRing_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    Heart rate collector state of a link to a peripheral.
+*/
+/**************************************************************************/
+typedef struct {
+    Gap::Handle_t      connHandle;
+    uint8_t            state;         /**< BlueNRG1_GattClient::HrmState_t. */
+    uint16_t           serviceStart;  /**< Heart Rate service declaration. */
+    uint16_t           serviceEnd;    /**< Last handle of the Heart Rate service. */
+    uint16_t           valueHandle;   /**< Heart Rate Measurement value. */
+    uint16_t           cccdHandle;
+    uint16_t           scValueHandle; /**< Service Changed value, 0 if absent. */
+    uint16_t           scCccdHandle;
+    bool               cached;        /**< Handles taken from BlueNRG1_GattCache. */
+    bool               stale;         /**< Service Changed received during the procedure. */
+    BlueNRG1_HrmRing_t ring;
+} BlueNRG1_HrmLink_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    GATT client of the central role.
+
+    subscribeHeartRate() runs, on a link, the exchange MTU procedure, the
+    discovery of the Heart Rate service, of its measurement characteristic
+    and CCCD and of the Service Changed characteristic, then enables the
+    indications and notifications.
+    The handles are saved in BlueNRG1_GattCache: reconnecting to the same
+    peer only writes the CCCDs, a Service Changed indication or a failed
+    write triggers a new discovery. Each link buffers its measurements in
+    its own ring and readHeartRate() merges them in timestamp order, so
+    that up to MAX_ACTIVE_CONNECTIONS sensors feed a single stream.
+*/
+/**************************************************************************/
 class BlueNRG1_GattClient : public GattClient
 {
 public:
+    typedef enum {
+        HRM_IDLE,
+        HRM_EXCHANGE_MTU,
+        HRM_DISCOVER_SERVICE,
+        HRM_DISCOVER_CHAR,
+        HRM_DISCOVER_CCCD,
+        HRM_DISCOVER_SC_CHAR,
+        HRM_DISCOVER_SC_CCCD,
+        HRM_ENABLE_SC,
+        HRM_SUBSCRIBE,
+        HRM_STREAMING
+    } HrmState_t;
+
     static BlueNRG1_GattClient &getInstance() {
         static BlueNRG1_GattClient m_instance;
         return m_instance;
     }
-  
+
+    ble_error_t subscribeHeartRate(Gap::Handle_t connectionHandle);
+    bool        readHeartRate(BlueNRG1_HrmSample_t *sample);
+    uint8_t     getHeartRateLinkCount(void) const;
+    uint32_t    getHeartRateDropped(void) const;
+
+    /* Entry point for aci_att_find_by_type_value_resp_event */
+    void onServiceFound(uint16_t connectionHandle, uint16_t startHandle, uint16_t endHandle);
+    /* Entry point for aci_gatt_disc_read_char_by_uuid_resp_event */
+    void onCharacteristicFound(uint16_t connectionHandle, uint16_t declHandle, uint8_t length, const uint8_t *value);
+    /* Entry point for aci_att_find_info_resp_event */
+    void onDescriptorsFound(uint16_t connectionHandle, uint8_t format, uint8_t length, const uint8_t *pairs);
+    /* Entry point for aci_gatt_proc_complete_event */
+    void onProcedureComplete(uint16_t connectionHandle, uint8_t errorCode);
+    /* Entry point for aci_gatt_notification_event and aci_gatt_indication_event */
+    void onHandleValue(uint16_t connectionHandle, uint16_t attrHandle, uint8_t length, const uint8_t *value,
+                       HVXType_t type);
+    void onDisconnection(Gap::Handle_t connectionHandle);
+
+private:
+    BlueNRG1_GattClient();
+
+    BlueNRG1_HrmLink_t *findLink(Gap::Handle_t connectionHandle);
+    uint8_t             startSubscription(BlueNRG1_HrmLink_t *link);
+    uint8_t             startDiscovery(BlueNRG1_HrmLink_t *link);
+    uint8_t             writeCccd(BlueNRG1_HrmLink_t *link, uint16_t handle, uint16_t value, HrmState_t state);
+    void                nextStep(BlueNRG1_HrmLink_t *link);
+    void                saveHandles(const BlueNRG1_HrmLink_t *link);
+    void                onServiceChanged(BlueNRG1_HrmLink_t *link);
+    void                pushSample(BlueNRG1_HrmLink_t *link, uint8_t length, const uint8_t *value);
+
+    BlueNRG1_HrmLink_t hrmLinks[MAX_ACTIVE_CONNECTIONS];
+
+    MBED_STATIC_ASSERT((BLE_HRM_RING_SIZE & (BLE_HRM_RING_SIZE - 1)) == 0, "BLE_HRM_RING_SIZE must be a power of 2");
+    MBED_STATIC_ASSERT(BLE_HRM_RING_SIZE <= 128, "BLE_HRM_RING_SIZE too large for the uint8_t indexes");
 };
 
-#endif  //__BLUENRG1_GATTCLIENT_H__
\ No newline at end of file
+#endif  //__BLUENRG1_GATTCLIENT_H__
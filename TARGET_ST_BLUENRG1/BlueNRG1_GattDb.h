@@ -0,0 +1,136 @@
+#ifndef __BLUENRG1_GATTDB_H__
+#define __BLUENRG1_GATTDB_H__
+
+#include <stdint.h>
+#include "platform/mbed_assert.h"
+
+/* This file describes, at compile time, the GATT database the application
+ * registers, so that btle.h can reserve exactly the RAM the BlueNRG-1 stack
+ * needs for it.
+ *
+ * Each characteristic contributes to ATT_VALUE_ARRAY_SIZE:
+ *  - its declaration: properties (1) + value handle (2) + UUID (2 or 16)
+ *  - its value: max length, + 2 when the length is variable
+ *  - its CCCD: 2, when it can notify or indicate
+ *  - the value of each of its descriptors (+ 2 when variable)
+ * e.g. ST's acceleration characteristic: 19 + 6 + 2 = 27 bytes.
+ *
+ * NUM_GATT_ATTRIBUTES counts declarations, values, CCCDs and descriptors,
+ * not the service declarations.
+ */
+
+/* Maximum number of attribute records aci_gatt_add_service() accepts */
+#define BLUENRG1_MAX_SERVICE_RECORDS    255
+
+/* Maximum attribute value length supported by the stack (DEFAULT_MAX_ATT_SIZE) */
+#define BLUENRG1_MAX_ATT_VALUE_LEN      512
+
+/* UUID lengths, in bytes */
+#define BLUENRG1_UUID_16                2
+#define BLUENRG1_UUID_128               16
+
+/* Properties that make the stack add a CCCD */
+#define BLUENRG1_CHAR_PROP_NOTIFY       0x10
+#define BLUENRG1_CHAR_PROP_INDICATE     0x20
+
+template <unsigned A, unsigned B>
+struct BlueNRG1_GattDbMax {
+    enum { VALUE = (A > B) ? A : B };
+};
+
+/**
+ * Placeholder for the unused slots of the templates below.
+ */
+struct BlueNRG1_GattDbNone {
+    enum {
+        SERVICES        = 0,
+        CHARACTERISTICS = 0,
+        ATTRIBUTES      = 0,
+        VALUE_BYTES     = 0,
+        MAX_VALUE_LEN   = 0,
+        MAX_RECORDS     = 0
+    };
+};
+
+/**
+ * Characteristic descriptor other than the CCCD.
+ */
+template <unsigned UUID_LEN, unsigned VALUE_LEN, bool VARIABLE = false>
+struct BlueNRG1_GattDbDesc {
+    MBED_STATIC_ASSERT(VALUE_LEN <= 255, "BlueNRG-1 descriptors are limited to 255 bytes");
+
+    enum {
+        ATTRIBUTES    = 1,
+        VALUE_BYTES   = VALUE_LEN + (VARIABLE ? 2 : 0),
+        MAX_VALUE_LEN = VALUE_LEN
+    };
+};
+
+/**
+ * Characteristic with up to three descriptors besides the CCCD.
+ */
+template <unsigned UUID_LEN, unsigned VALUE_LEN, uint8_t PROPERTIES, bool VARIABLE = false,
+          class D1 = BlueNRG1_GattDbNone, class D2 = BlueNRG1_GattDbNone, class D3 = BlueNRG1_GattDbNone>
+struct BlueNRG1_GattDbChar {
+    MBED_STATIC_ASSERT(VALUE_LEN <= BLUENRG1_MAX_ATT_VALUE_LEN, "Characteristic value longer than the stack supports");
+
+    enum {
+        HAS_CCCD        = (PROPERTIES & (BLUENRG1_CHAR_PROP_NOTIFY | BLUENRG1_CHAR_PROP_INDICATE)) ? 1 : 0,
+        CHARACTERISTICS = 1,
+        ATTRIBUTES      = 2 + HAS_CCCD + D1::ATTRIBUTES + D2::ATTRIBUTES + D3::ATTRIBUTES,
+        VALUE_BYTES     = (3 + UUID_LEN) + VALUE_LEN + (VARIABLE ? 2 : 0) + (2 * HAS_CCCD)
+                          + D1::VALUE_BYTES + D2::VALUE_BYTES + D3::VALUE_BYTES,
+        MAX_VALUE_LEN   = BlueNRG1_GattDbMax<VALUE_LEN,
+                          BlueNRG1_GattDbMax<D1::MAX_VALUE_LEN,
+                          BlueNRG1_GattDbMax<D2::MAX_VALUE_LEN, D3::MAX_VALUE_LEN>::VALUE>::VALUE>::VALUE
+    };
+};
+
+/**
+ * Primary service with up to six characteristics.
+ */
+template <unsigned UUID_LEN, class C1,
+          class C2 = BlueNRG1_GattDbNone, class C3 = BlueNRG1_GattDbNone,
+          class C4 = BlueNRG1_GattDbNone, class C5 = BlueNRG1_GattDbNone, class C6 = BlueNRG1_GattDbNone>
+struct BlueNRG1_GattDbService {
+    enum {
+        SERVICES        = 1,
+        CHARACTERISTICS = C1::CHARACTERISTICS + C2::CHARACTERISTICS + C3::CHARACTERISTICS
+                          + C4::CHARACTERISTICS + C5::CHARACTERISTICS + C6::CHARACTERISTICS,
+        ATTRIBUTES      = C1::ATTRIBUTES + C2::ATTRIBUTES + C3::ATTRIBUTES
+                          + C4::ATTRIBUTES + C5::ATTRIBUTES + C6::ATTRIBUTES,
+        VALUE_BYTES     = C1::VALUE_BYTES + C2::VALUE_BYTES + C3::VALUE_BYTES
+                          + C4::VALUE_BYTES + C5::VALUE_BYTES + C6::VALUE_BYTES,
+        MAX_VALUE_LEN   = BlueNRG1_GattDbMax<C1::MAX_VALUE_LEN,
+                          BlueNRG1_GattDbMax<C2::MAX_VALUE_LEN,
+                          BlueNRG1_GattDbMax<C3::MAX_VALUE_LEN,
+                          BlueNRG1_GattDbMax<C4::MAX_VALUE_LEN,
+                          BlueNRG1_GattDbMax<C5::MAX_VALUE_LEN, C6::MAX_VALUE_LEN>::VALUE>::VALUE>::VALUE>::VALUE>::VALUE,
+        /* Max_Attribute_Records of aci_gatt_add_service(), service declaration included */
+        MAX_RECORDS     = 1 + ATTRIBUTES
+    };
+
+    MBED_STATIC_ASSERT(MAX_RECORDS <= BLUENRG1_MAX_SERVICE_RECORDS, "GATT service does not fit in a BlueNRG-1 service");
+};
+
+/**
+ * Whole application database, up to four services on top of GAP and GATT.
+ */
+template <class S1,
+          class S2 = BlueNRG1_GattDbNone, class S3 = BlueNRG1_GattDbNone, class S4 = BlueNRG1_GattDbNone>
+struct BlueNRG1_GattDb {
+    enum {
+        SERVICES        = S1::SERVICES + S2::SERVICES + S3::SERVICES + S4::SERVICES,
+        CHARACTERISTICS = S1::CHARACTERISTICS + S2::CHARACTERISTICS + S3::CHARACTERISTICS + S4::CHARACTERISTICS,
+        ATTRIBUTES      = S1::ATTRIBUTES + S2::ATTRIBUTES + S3::ATTRIBUTES + S4::ATTRIBUTES,
+        VALUE_BYTES     = S1::VALUE_BYTES + S2::VALUE_BYTES + S3::VALUE_BYTES + S4::VALUE_BYTES,
+        MAX_VALUE_LEN   = BlueNRG1_GattDbMax<S1::MAX_VALUE_LEN,
+                          BlueNRG1_GattDbMax<S2::MAX_VALUE_LEN,
+                          BlueNRG1_GattDbMax<S3::MAX_VALUE_LEN, S4::MAX_VALUE_LEN>::VALUE>::VALUE>::VALUE,
+        MAX_RECORDS     = BlueNRG1_GattDbMax<S1::MAX_RECORDS,
+                          BlueNRG1_GattDbMax<S2::MAX_RECORDS,
+                          BlueNRG1_GattDbMax<S3::MAX_RECORDS, S4::MAX_RECORDS>::VALUE>::VALUE>::VALUE
+    };
+};
+
+#endif //__BLUENRG1_GATTDB_H__
@@ -0,0 +1,998 @@
+#include "BlueNRG1_GattServer.h"
+#include "BlueNRG1_Events.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_Trace.h"
+#include "platform/mbed_debug.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_const.h"
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_events.h"
+#include "bluenrg1_gatt_server.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* Minimum encryption key size accepted for protected characteristics */
+#define BLUENRG1_ENC_KEY_SIZE   MAX_ENCRY_KEY_SIZE
+
+/* CCCD bits */
+#define CCCD_NOTIFICATION       0x0001
+#define CCCD_INDICATION         0x0002
+
+/* Update_Type of aci_gatt_update_char_value_ext */
+#define UPDATE_LOCAL_ONLY       0x00
+#define UPDATE_NOTIFICATION     0x01
+#define UPDATE_INDICATION       0x02
+
+/* Conn_Handle_To_Notify meaning every subscribed client */
+#define NOTIFY_ALL_CLIENTS      0x0000
+
+/* Opcode and handle in front of a notified or indicated value */
+#define ATT_UPDATE_HEADER_LEN   3
+/* An L2CAP header, then the PDU in link layer packets of one pool block */
+#define L2CAP_HEADER_LEN        4
+#define TX_BLOCK_LEN            27
+
+/* Value bytes of a prepare write list entry, see PREP_WRITE_X_ATT() */
+#define PREPARE_WRITE_LEN       (BLE_LINK_DEFAULT_ATT_MTU - 5)
+
+/* Fill a BlueNRG UUID union from an mbed UUID, return the BlueNRG UUID type */
+static uint8_t convertUUID(const UUID &uuid, uint8_t uuid128[16], uint16_t *uuid16)
+{
+    if (uuid.shortOrLong() == UUID::UUID_TYPE_SHORT) {
+        *uuid16 = uuid.getShortUUID();
+        return UUID_TYPE_16;
+    }
+    /* mbed and BlueNRG both keep long UUIDs in little endian order */
+    memcpy(uuid128, uuid.getBaseUUID(), UUID::LENGTH_OF_LONG_UUID);
+    return UUID_TYPE_128;
+}
+
+static uint8_t securityPermissions(SecurityManager::SecurityMode_t mode)
+{
+    switch (mode) {
+        case SecurityManager::SECURITY_MODE_ENCRYPTION_NO_MITM:
+        case SecurityManager::SECURITY_MODE_SIGNED_NO_MITM:
+            return ATTR_PERMISSION_ENCRY_READ | ATTR_PERMISSION_ENCRY_WRITE;
+        case SecurityManager::SECURITY_MODE_ENCRYPTION_WITH_MITM:
+        case SecurityManager::SECURITY_MODE_SIGNED_WITH_MITM:
+            return ATTR_PERMISSION_AUTHEN_READ | ATTR_PERMISSION_AUTHEN_WRITE;
+        default:
+            return ATTR_PERMISSION_NONE;
+    }
+}
+
+static bool hasCCCD(const GattCharacteristic *p_char)
+{
+    return (p_char->getProperties() & (GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY |
+                                       GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE)) != 0;
+}
+
+BlueNRG1_GattServer::BlueNRG1_GattServer() :
+    GattServer(),
+    attrCount(0),
+    cccdSlotCount(0),
+    pendingHead(0),
+    pendingCount(0),
+    attMtuChangedCallback(NULL),
+    reservedServices(0),
+    reservedAttributes(0),
+    reservedAttValueBytes(0)
+{
+    memset(&memoryUse, 0, sizeof(memoryUse));
+}
+
+void BlueNRG1_GattServer::setReservation(uint16_t services, uint16_t attributes, uint16_t attValueBytes)
+{
+    reservedServices      = services;
+    reservedAttributes    = attributes;
+    reservedAttValueBytes = attValueBytes;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Keep attrTable sorted by handle while registering a new entry
+
+    @returns    BLE_ERROR_NO_MEM when the fixed table is full
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::insertAttribute(GattAttribute::Handle_t handle, uint16_t serviceHandle, uint16_t charHandle,
+                                                 BlueNRG1_AttrType_t type, uint8_t cccdSlot, GattCharacteristic *characteristic)
+{
+    if (attrCount >= BLE_TOTAL_ATTRIBUTES) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    /* BlueNRG allocates increasing handles, so this loop is usually empty */
+    uint8_t pos = attrCount;
+    while ((pos > 0) && (attrTable[pos - 1].handle > handle)) {
+        attrTable[pos] = attrTable[pos - 1];
+        pos--;
+    }
+
+    attrTable[pos].handle         = handle;
+    attrTable[pos].serviceHandle  = serviceHandle;
+    attrTable[pos].charHandle     = charHandle;
+    attrTable[pos].type           = type;
+    attrTable[pos].cccdSlot       = cccdSlot;
+    attrTable[pos].characteristic = characteristic;
+    attrCount++;
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Binary search of an mbed handle in attrTable
+
+    @returns    The entry, NULL if the handle does not belong to the port
+*/
+/**************************************************************************/
+const BlueNRG1_AttrEntry_t *BlueNRG1_GattServer::findAttribute(GattAttribute::Handle_t handle) const
+{
+    int low  = 0;
+    int high = (int)attrCount - 1;
+
+    while (low <= high) {
+        int mid = (low + high) >> 1;
+        if (attrTable[mid].handle == handle) {
+            return &attrTable[mid];
+        }
+        if (attrTable[mid].handle < handle) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Adds a new service to the GATT table on the peripheral
+
+    @returns    ble_error_t
+
+    @retval     BLE_ERROR_NONE
+                Everything executed properly
+    @retval     BLE_ERROR_NO_MEM
+                The service goes beyond the database btle.h reserved from
+                app_gatt_db.h, or beyond the port tables
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::addService(GattService &service)
+{
+    tBleStatus ret;
+    uint16_t serviceHandle;
+    Service_UUID_t serviceUUID;
+    uint8_t uuidType;
+    uint8_t maxAttrRecords = 1;
+    uint32_t valueBytes = 0;
+
+    /* Characteristic declaration + value, the CCCD and the user descriptors,
+       with their ATT_VALUE_ARRAY_SIZE bytes as BlueNRG1_GattDb.h counts them */
+    for (uint8_t i = 0; i < service.getCharacteristicCount(); i++) {
+        GattCharacteristic *p_char = service.getCharacteristic(i);
+        GattAttribute &valueAttr = p_char->getValueAttribute();
+        maxAttrRecords += 2;
+        valueBytes += 3 + ((valueAttr.getUUID().shortOrLong() == UUID::UUID_TYPE_SHORT) ? 2 : 16)
+                      + valueAttr.getMaxLength() + (valueAttr.hasVariableLength() ? 2 : 0);
+        if (hasCCCD(p_char)) {
+            maxAttrRecords++;
+            valueBytes += 2;
+        }
+        for (uint8_t j = 0; j < p_char->getDescriptorCount(); j++) {
+            GattAttribute *p_desc = p_char->getDescriptor(j);
+            if (p_desc->getUUID() != UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)) {
+                maxAttrRecords++;
+                valueBytes += p_desc->getMaxLength() + (p_desc->hasVariableLength() ? 2 : 0);
+            }
+        }
+    }
+
+    /* The stack would run out of its database RAM: app_gatt_db.h is out of date */
+    if ((memoryUse.services + 1u > reservedServices) ||
+        (memoryUse.attributes + (maxAttrRecords - 1u) > reservedAttributes) ||
+        (memoryUse.attValueBytes + valueBytes > reservedAttValueBytes)) {
+        debug("BlueNRG1: service needs %u attributes and %lu value bytes, app_gatt_db.h leaves %u and %u\r\n",
+              (unsigned)(maxAttrRecords - 1), (unsigned long)valueBytes,
+              (unsigned)(reservedAttributes - memoryUse.attributes),
+              (unsigned)(reservedAttValueBytes - memoryUse.attValueBytes));
+        return BLE_ERROR_NO_MEM;
+    }
+
+    uuidType = convertUUID(service.getUUID(), serviceUUID.Service_UUID_128, &serviceUUID.Service_UUID_16);
+    ret = BLE_TRACE_COMMAND(ACI_GATT_ADD_SERVICE_OPCODE,
+                            BLE_TRACE_PARAMS.u8(uuidType)
+                                            .bytes(serviceUUID.Service_UUID_128, (uuidType == UUID_TYPE_16) ? 2 : 16)
+                                            .u8(PRIMARY_SERVICE).u8(maxAttrRecords),
+                            aci_gatt_add_service(uuidType, &serviceUUID, PRIMARY_SERVICE, maxAttrRecords,
+                                                 &serviceHandle));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+    service.setHandle(serviceHandle);
+    serviceCount++;
+    memoryUse.services++;
+
+    for (uint8_t i = 0; i < service.getCharacteristicCount(); i++) {
+        GattCharacteristic *p_char = service.getCharacteristic(i);
+        GattAttribute &valueAttr = p_char->getValueAttribute();
+        Char_UUID_t charUUID;
+        uint16_t charHandle;
+        uint8_t evtMask = GATT_DONT_NOTIFY_EVENTS;
+
+        if (p_char->getProperties() & (GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE |
+                                       GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE)) {
+            evtMask |= GATT_NOTIFY_ATTRIBUTE_WRITE;
+        }
+
+        uuidType = convertUUID(valueAttr.getUUID(), charUUID.Char_UUID_128, &charUUID.Char_UUID_16);
+        uint8_t isVariable = valueAttr.hasVariableLength() ? CHAR_VALUE_LEN_VARIABLE : CHAR_VALUE_LEN_CONSTANT;
+        ret = BLE_TRACE_COMMAND(ACI_GATT_ADD_CHAR_OPCODE,
+                                BLE_TRACE_PARAMS.u16(serviceHandle).u8(uuidType)
+                                                .bytes(charUUID.Char_UUID_128, (uuidType == UUID_TYPE_16) ? 2 : 16)
+                                                .u16(valueAttr.getMaxLength()).u8(p_char->getProperties())
+                                                .u8(securityPermissions(p_char->getRequiredSecurity()))
+                                                .u8(evtMask).u8(BLUENRG1_ENC_KEY_SIZE).u8(isVariable),
+                                aci_gatt_add_char(serviceHandle,
+                                                  uuidType,
+                                                  &charUUID,
+                                                  valueAttr.getMaxLength(),
+                                                  p_char->getProperties(),
+                                                  securityPermissions(p_char->getRequiredSecurity()),
+                                                  evtMask,
+                                                  BLUENRG1_ENC_KEY_SIZE,
+                                                  isVariable,
+                                                  &charHandle));
+        if (ret != BLE_STATUS_SUCCESS) {
+            return BlueNRG1_ble::bleStatusToError(ret);
+        }
+
+        /* One subscription bit per link for every characteristic with a CCCD */
+        uint8_t cccdSlot = BLUENRG1_NO_CCCD_SLOT;
+        if (hasCCCD(p_char)) {
+            if (cccdSlotCount >= BLE_LINK_CCCD_SLOTS) {
+                return BLE_ERROR_NO_MEM;
+            }
+            cccdSlot = cccdSlotCount++;
+        }
+
+        /* The value attribute follows the declaration, then the CCCD if any */
+        valueAttr.setHandle(charHandle + 1);
+        if (insertAttribute(charHandle + 1, serviceHandle, charHandle, BLUENRG1_ATTR_VALUE, cccdSlot, p_char) != BLE_ERROR_NONE) {
+            return BLE_ERROR_NO_MEM;
+        }
+        if (cccdSlot != BLUENRG1_NO_CCCD_SLOT) {
+            if (insertAttribute(charHandle + 2, serviceHandle, charHandle, BLUENRG1_ATTR_CCCD, cccdSlot, p_char) != BLE_ERROR_NONE) {
+                return BLE_ERROR_NO_MEM;
+            }
+        }
+        characteristicCount++;
+        memoryUse.attributes    += (cccdSlot != BLUENRG1_NO_CCCD_SLOT) ? 3 : 2;
+        memoryUse.attValueBytes += 3 + ((uuidType == UUID_TYPE_16) ? 2 : 16) + valueAttr.getMaxLength()
+                                   + ((isVariable == CHAR_VALUE_LEN_VARIABLE) ? 2 : 0)
+                                   + ((cccdSlot != BLUENRG1_NO_CCCD_SLOT) ? 2 : 0);
+
+        if ((valueAttr.getValuePtr() != NULL) && (valueAttr.getLength() > 0)) {
+            BLE_TRACE_COMMAND(ACI_GATT_UPDATE_CHAR_VALUE_OPCODE,
+                              BLE_TRACE_PARAMS.u16(serviceHandle).u16(charHandle).u8(0).u8(valueAttr.getLength())
+                                              .bytes(valueAttr.getValuePtr(), valueAttr.getLength()),
+                              aci_gatt_update_char_value(serviceHandle, charHandle, 0, valueAttr.getLength(),
+                                                         valueAttr.getValuePtr()));
+        }
+
+        for (uint8_t j = 0; j < p_char->getDescriptorCount(); j++) {
+            GattAttribute *p_desc = p_char->getDescriptor(j);
+            Char_Desc_Uuid_t descUUID;
+            uint16_t descHandle;
+
+            if (p_desc->getUUID() == UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)) {
+                /* Added by the stack together with the characteristic */
+                p_desc->setHandle(charHandle + 2);
+                continue;
+            }
+
+            uuidType = convertUUID(p_desc->getUUID(), descUUID.Char_UUID_128, &descUUID.Char_UUID_16);
+            uint8_t descVariable = p_desc->hasVariableLength() ? CHAR_VALUE_LEN_VARIABLE : CHAR_VALUE_LEN_CONSTANT;
+            ret = BLE_TRACE_COMMAND(ACI_GATT_ADD_CHAR_DESC_OPCODE,
+                                    BLE_TRACE_PARAMS.u16(serviceHandle).u16(charHandle).u8(uuidType)
+                                                    .bytes(descUUID.Char_UUID_128, (uuidType == UUID_TYPE_16) ? 2 : 16)
+                                                    .u8(p_desc->getMaxLength()).u8(p_desc->getLength())
+                                                    .bytes(p_desc->getValuePtr(), p_desc->getLength())
+                                                    .u8(ATTR_PERMISSION_NONE).u8(ATTR_ACCESS_READ_ONLY)
+                                                    .u8(GATT_DONT_NOTIFY_EVENTS).u8(BLUENRG1_ENC_KEY_SIZE).u8(descVariable),
+                                    aci_gatt_add_char_desc(serviceHandle,
+                                                           charHandle,
+                                                           uuidType,
+                                                           &descUUID,
+                                                           p_desc->getMaxLength(),
+                                                           p_desc->getLength(),
+                                                           p_desc->getValuePtr(),
+                                                           ATTR_PERMISSION_NONE,
+                                                           ATTR_ACCESS_READ_ONLY,
+                                                           GATT_DONT_NOTIFY_EVENTS,
+                                                           BLUENRG1_ENC_KEY_SIZE,
+                                                           descVariable,
+                                                           &descHandle));
+            if (ret != BLE_STATUS_SUCCESS) {
+                return BlueNRG1_ble::bleStatusToError(ret);
+            }
+
+            p_desc->setHandle(descHandle);
+            memoryUse.attributes++;
+            memoryUse.attValueBytes += p_desc->getMaxLength() + ((descVariable == CHAR_VALUE_LEN_VARIABLE) ? 2 : 0);
+            if (insertAttribute(descHandle, serviceHandle, charHandle, BLUENRG1_ATTR_DESCRIPTOR, BLUENRG1_NO_CCCD_SLOT, p_char) != BLE_ERROR_NONE) {
+                return BLE_ERROR_NO_MEM;
+            }
+        }
+    }
+
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the value of a characteristic or descriptor from the
+            local GATT database
+
+    @param[in]      attributeHandle
+    @param[out]     buffer
+    @param[in,out]  lengthP     buffer size on input, value length on output
+
+    @returns    ble_error_t
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::read(GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP)
+{
+    uint16_t length;
+    uint16_t valueLength;
+
+    if (findAttribute(attributeHandle) == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GATT_READ_HANDLE_VALUE_OPCODE,
+                                       BLE_TRACE_PARAMS.u16(attributeHandle).u16(0).u16(*lengthP),
+                                       aci_gatt_read_handle_value(attributeHandle, 0, *lengthP, &length,
+                                                                  &valueLength, buffer));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    *lengthP = (length > valueLength) ? length : valueLength;
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t BlueNRG1_GattServer::read(Gap::Handle_t connectionHandle, GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP)
+{
+    /* The stack answers with the value of the current link */
+    (void)connectionHandle;
+
+    return read(attributeHandle, buffer, lengthP);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Push a characteristic value to the stack, notifying or indicating
+            the subscribed clients unless localOnly is set
+
+    @returns    the BlueNRG status, BLE_STATUS_INSUFFICIENT_RESOURCES when
+                the TX packet pool is exhausted
+*/
+/**************************************************************************/
+uint8_t BlueNRG1_GattServer::sendUpdate(const BlueNRG1_AttrEntry_t *entry, uint16_t connHandle,
+                                        const uint8_t value[], uint16_t size, bool localOnly)
+{
+    uint8_t updateType = UPDATE_LOCAL_ONLY;
+
+    if (!localOnly) {
+        uint8_t properties = entry->characteristic->getProperties();
+        if (properties & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY) {
+            updateType = UPDATE_NOTIFICATION;
+        } else if (properties & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE) {
+            updateType = UPDATE_INDICATION;
+        }
+    }
+
+    tBleStatus ret = BLE_TRACE_COMMAND(ACI_GATT_UPDATE_CHAR_VALUE_EXT_OPCODE,
+                                       BLE_TRACE_PARAMS.u16(connHandle).u16(entry->serviceHandle).u16(entry->charHandle)
+                                                       .u8(updateType).u16(size).u16(0).u8(size).bytes(value, size),
+                                       aci_gatt_update_char_value_ext(connHandle, entry->serviceHandle, entry->charHandle,
+                                                                      updateType, size, 0, size, (uint8_t *)value));
+    if (ret == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+        memoryUse.txPoolExhausted++;
+    } else if ((ret == BLE_STATUS_SUCCESS) && (updateType != UPDATE_LOCAL_ONLY)) {
+        countTxBlocks(connHandle, size);
+    }
+
+    return ret;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Account the packet blocks of an update the stack accepted,
+            until their link layer packets complete
+*/
+/**************************************************************************/
+void BlueNRG1_GattServer::countTxBlocks(uint16_t connHandle, uint16_t size)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connHandle);
+    uint16_t blocks = (ATT_UPDATE_HEADER_LEN + size + L2CAP_HEADER_LEN + TX_BLOCK_LEN - 1) / TX_BLOCK_LEN;
+
+    if (link == NULL) {
+        return;
+    }
+
+    link->txBlocks      += blocks;
+    memoryUse.txBlocks  += blocks;
+    if (memoryUse.txBlocks > memoryUse.txBlocksMax) {
+        memoryUse.txBlocksMax = memoryUse.txBlocks;
+    }
+
+    if (link->txUpdateCount < BLE_LINK_TX_UPDATES) {
+        link->txUpdates[(link->txUpdateHead + link->txUpdateCount) % BLE_LINK_TX_UPDATES] = (uint8_t)blocks;
+        link->txUpdateCount++;
+    } else {
+        /* More updates in flight than tracked: the newest completes with the previous one */
+        link->txUpdates[(link->txUpdateHead + BLE_LINK_TX_UPDATES - 1) % BLE_LINK_TX_UPDATES] += (uint8_t)blocks;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Park an update until the stack has TX buffers again
+
+    @returns    BLE_ERROR_NO_MEM if the queue is full or the value too long
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::queueUpdate(GattAttribute::Handle_t handle, uint16_t connHandle,
+                                             const uint8_t value[], uint16_t size)
+{
+    if ((pendingCount >= BLE_NOTIFY_QUEUE_SIZE) || (size > BLE_NOTIFY_QUEUE_VALUE_LEN)) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    BlueNRG1_PendingUpdate_t *update = &pendingUpdates[(pendingHead + pendingCount) % BLE_NOTIFY_QUEUE_SIZE];
+    update->handle     = handle;
+    update->connHandle = connHandle;
+    update->length     = size;
+    memcpy(update->value, value, size);
+    pendingCount++;
+
+    return BLE_ERROR_NONE;
+}
+
+bool BlueNRG1_GattServer::hasPendingUpdate(uint16_t connHandle) const
+{
+    return getPendingCount(connHandle) > 0;
+}
+
+uint8_t BlueNRG1_GattServer::getPendingCount(Gap::Handle_t connectionHandle) const
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < pendingCount; i++) {
+        if (pendingUpdates[(pendingHead + i) % BLE_NOTIFY_QUEUE_SIZE].connHandle == connectionHandle) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue the update of a link and count it in the telemetry,
+            queued or dropped when the queue is full
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::queueLinkUpdate(const BlueNRG1_AttrEntry_t *entry, uint16_t connHandle,
+                                                 const uint8_t value[], uint16_t size)
+{
+    BlueNRG1_Telemetry &telemetry = BlueNRG1_Gap::getInstance().getTelemetry();
+    ble_error_t error = queueUpdate(entry->handle, connHandle, value, size);
+
+    if (error == BLE_ERROR_NONE) {
+        telemetry.onNotificationQueued(connHandle);
+    } else {
+        telemetry.onNotificationDropped(connHandle, 1);
+    }
+
+    return error;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Notify or indicate one link, queueing the update when the
+            stack is out of buffers or older ones are still waiting for
+            that link
+
+    @returns    ble_error_t
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::updateLink(const BlueNRG1_AttrEntry_t *entry, uint16_t connHandle,
+                                            const uint8_t value[], uint16_t size)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connHandle);
+
+    /* Traffic measured by BlueNRG1_ConnManager */
+    if (link != NULL) {
+        link->notifyCount++;
+    }
+
+    if (hasPendingUpdate(connHandle)) {
+        return queueLinkUpdate(entry, connHandle, value, size);
+    }
+
+    tBleStatus ret = sendUpdate(entry, connHandle, value, size, false);
+    if (ret == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+        return queueLinkUpdate(entry, connHandle, value, size);
+    }
+    if (ret == BLE_STATUS_SUCCESS) {
+        BlueNRG1_Gap::getInstance().getTelemetry().onNotificationSent(connHandle);
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BlueNRG1_ble::bleStatusToError(ret);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Update the local value, then send it to every link that
+            enabled the CCCD of the characteristic
+
+    @returns    The first error met, the other links are still served
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::notifySubscribers(const BlueNRG1_AttrEntry_t *entry, const uint8_t value[], uint16_t size)
+{
+    BlueNRG1_Links &links = BlueNRG1_Links::getInstance();
+    ble_error_t error;
+
+    tBleStatus ret = sendUpdate(entry, NOTIFY_ALL_CLIENTS, value, size, true);
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    error = BLE_ERROR_NONE;
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        BlueNRG1_Link_t *link = links.at(i);
+
+        if (links.isSubscribed(link, entry->cccdSlot)) {
+            ble_error_t linkError = updateLink(entry, link->handle, value, size);
+            if (error == BLE_ERROR_NONE) {
+                error = linkError;
+            }
+        }
+    }
+
+    return error;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Send the parked updates in order, stop at the first one the
+            stack rejects for lack of buffers
+
+    Updates the stack refuses for another reason, or whose attribute is
+    gone, are counted as dropped; the refused command is in the trace
+    with its status.
+*/
+/**************************************************************************/
+void BlueNRG1_GattServer::flushPendingUpdates(void)
+{
+    BlueNRG1_Telemetry &telemetry = BlueNRG1_Gap::getInstance().getTelemetry();
+
+    while (pendingCount > 0) {
+        BlueNRG1_PendingUpdate_t *update = &pendingUpdates[pendingHead];
+        const BlueNRG1_AttrEntry_t *entry = findAttribute(update->handle);
+        tBleStatus ret = BLE_STATUS_INVALID_HANDLE;
+
+        if (entry != NULL) {
+            ret = sendUpdate(entry, update->connHandle, update->value, update->length, false);
+            if (ret == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+                /* Wait for the next aci_gatt_tx_pool_available_event */
+                break;
+            }
+        }
+        if (ret == BLE_STATUS_SUCCESS) {
+            telemetry.onNotificationSent(update->connHandle);
+        } else {
+            telemetry.onNotificationDropped(update->connHandle, 1);
+        }
+
+        pendingHead = (pendingHead + 1) % BLE_NOTIFY_QUEUE_SIZE;
+        pendingCount--;
+    }
+
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Updates the value of a characteristic or descriptor, based on
+            the handle translation table built by addService()
+
+    Without a connection handle the update goes to every subscribed link.
+    Notifications the stack cannot take for lack of packet buffers are
+    queued and sent from aci_gatt_tx_pool_available_event; the order of
+    the updates is preserved on each link.
+
+    @param[in]  attributeHandle
+    @param[in]  value
+    @param[in]  size
+    @param[in]  localOnly
+
+    @returns    ble_error_t
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_GattServer::write(GattAttribute::Handle_t attributeHandle, const uint8_t value[], uint16_t size, bool localOnly)
+{
+    return write(NOTIFY_ALL_CLIENTS, attributeHandle, value, size, localOnly);
+}
+
+ble_error_t BlueNRG1_GattServer::write(Gap::Handle_t connectionHandle, GattAttribute::Handle_t attributeHandle, const uint8_t value[], uint16_t size, bool localOnly)
+{
+    tBleStatus ret;
+    const BlueNRG1_AttrEntry_t *entry = findAttribute(attributeHandle);
+
+    if (entry == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    switch (entry->type) {
+        case BLUENRG1_ATTR_VALUE:
+            if (localOnly) {
+                ret = sendUpdate(entry, NOTIFY_ALL_CLIENTS, value, size, true);
+                break;
+            }
+            if (connectionHandle == NOTIFY_ALL_CLIENTS) {
+                return notifySubscribers(entry, value, size);
+            }
+            if (BlueNRG1_Links::getInstance().find(connectionHandle) == NULL) {
+                return BLE_ERROR_INVALID_PARAM;
+            }
+            return updateLink(entry, connectionHandle, value, size);
+        case BLUENRG1_ATTR_DESCRIPTOR:
+            ret = BLE_TRACE_COMMAND(ACI_GATT_SET_DESC_VALUE_OPCODE,
+                                    BLE_TRACE_PARAMS.u16(entry->serviceHandle).u16(entry->charHandle)
+                                                    .u16(attributeHandle).u16(0).u8(size).bytes(value, size),
+                                    aci_gatt_set_desc_value(entry->serviceHandle, entry->charHandle, attributeHandle,
+                                                            0, size, (uint8_t *)value));
+            break;
+        default:
+            /* CCCDs belong to the peer */
+            return BLE_ERROR_OPERATION_NOT_PERMITTED;
+    }
+
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_GattServer::onTxPoolAvailable(uint16_t connectionHandle, uint16_t availableBuffers)
+{
+    (void)connectionHandle;
+    (void)availableBuffers;
+
+    flushPendingUpdates();
+}
+
+/**************************************************************************/
+/*!
+    @brief  The exchange MTU procedure completed, whichever side started it
+*/
+/**************************************************************************/
+void BlueNRG1_GattServer::onMtuExchanged(uint16_t connectionHandle, uint16_t mtu)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connectionHandle);
+
+    if (link == NULL) {
+        return;
+    }
+
+    BlueNRG1_Links::getInstance().setAttMtu(connectionHandle, mtu);
+    if (attMtuChangedCallback) {
+        attMtuChangedCallback(link);
+    }
+}
+
+uint16_t BlueNRG1_GattServer::getAttMtu(Gap::Handle_t connectionHandle) const
+{
+    return BlueNRG1_Links::getInstance().getAttMtu(connectionHandle);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Longest value a notification or indication carries on a link,
+            ATT_MTU minus the opcode and the handle
+*/
+/**************************************************************************/
+uint16_t BlueNRG1_GattServer::getMaxPayload(Gap::Handle_t connectionHandle) const
+{
+    return getAttMtu(connectionHandle) - 3;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Longest value every connected client receives whole, for the
+            updates sent to all the subscribed links
+*/
+/**************************************************************************/
+uint16_t BlueNRG1_GattServer::getMaxPayload(void) const
+{
+    BlueNRG1_Links &links = BlueNRG1_Links::getInstance();
+    uint16_t mtu = BLE_MAX_ATT_MTU;
+    bool     any = false;
+
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        const BlueNRG1_Link_t *link = links.at(i);
+        if (link->connected && (link->attMtu < mtu)) {
+            mtu = link->attMtu;
+        }
+        any = any || link->connected;
+    }
+
+    return (any ? mtu : BLE_LINK_DEFAULT_ATT_MTU) - 3;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Compact the queue without the updates of a closed link
+*/
+/**************************************************************************/
+void BlueNRG1_GattServer::onDisconnection(Gap::Handle_t connectionHandle)
+{
+    uint8_t kept = 0;
+
+    /* The blocks of the closed link are freed with it */
+    memoryUse.txBlocks = 0;
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        const BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().at(i);
+
+        if (link->connected) {
+            memoryUse.txBlocks += link->txBlocks;
+        }
+    }
+
+    for (uint8_t i = 0; i < pendingCount; i++) {
+        BlueNRG1_PendingUpdate_t *update = &pendingUpdates[(pendingHead + i) % BLE_NOTIFY_QUEUE_SIZE];
+
+        if (update->connHandle != connectionHandle) {
+            if (kept != i) {
+                pendingUpdates[(pendingHead + kept) % BLE_NOTIFY_QUEUE_SIZE] = *update;
+            }
+            kept++;
+        }
+    }
+    if (kept < pendingCount) {
+        BlueNRG1_Gap::getInstance().getTelemetry().onNotificationDropped(connectionHandle, pendingCount - kept);
+    }
+    pendingCount = kept;
+
+    if (pendingCount > 0) {
+        /* The remaining links may have been waiting behind this one */
+        flushPendingUpdates();
+    }
+}
+
+void BlueNRG1_GattServer::onUpdatesCompleted(unsigned count)
+{
+    if (count > 0) {
+        handleDataSentEvent(count);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Release the blocks of the packets completed on a link
+
+    An update of a large ATT_MTU leaves in several link layer packets,
+    it only completes with the last of its blocks.
+
+    @returns    The updates of the link completed by these packets
+*/
+/**************************************************************************/
+uint16_t BlueNRG1_GattServer::onPacketsCompleted(Gap::Handle_t connectionHandle, uint16_t count)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connectionHandle);
+    uint16_t updates = 0;
+
+    if (link == NULL) {
+        return 0;
+    }
+
+    /* Packets the stack sent on its own were never counted */
+    if (count > link->txBlocks) {
+        count = link->txBlocks;
+    }
+    link->txBlocks     -= count;
+    memoryUse.txBlocks -= count;
+
+    while ((count > 0) && (link->txUpdateCount > 0)) {
+        uint8_t left = link->txUpdates[link->txUpdateHead] - link->txUpdateDone;
+
+        if (count < left) {
+            link->txUpdateDone += (uint8_t)count;
+            break;
+        }
+        count -= left;
+        link->txUpdateDone  = 0;
+        link->txUpdateHead  = (link->txUpdateHead + 1) % BLE_LINK_TX_UPDATES;
+        link->txUpdateCount--;
+        updates++;
+    }
+
+    return updates;
+}
+
+void BlueNRG1_GattServer::resetMemoryPeaks(void)
+{
+    memoryUse.txBlocksMax      = memoryUse.txBlocks;
+    memoryUse.txPoolExhausted  = 0;
+    memoryUse.prepareWritesMax = 0;
+}
+
+ble_error_t BlueNRG1_GattServer::areUpdatesEnabled(const GattCharacteristic &characteristic, bool *enabledP)
+{
+    const BlueNRG1_AttrEntry_t *entry = findAttribute(characteristic.getValueHandle());
+
+    if ((entry == NULL) || (entry->cccdSlot == BLUENRG1_NO_CCCD_SLOT)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    *enabledP = BlueNRG1_Links::getInstance().anySubscribed(entry->cccdSlot);
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t BlueNRG1_GattServer::areUpdatesEnabled(Gap::Handle_t connectionHandle, const GattCharacteristic &characteristic, bool *enabledP)
+{
+    const BlueNRG1_AttrEntry_t *entry = findAttribute(characteristic.getValueHandle());
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connectionHandle);
+
+    if ((entry == NULL) || (entry->cccdSlot == BLUENRG1_NO_CCCD_SLOT) || (link == NULL)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    *enabledP = BlueNRG1_Links::getInstance().isSubscribed(link, entry->cccdSlot);
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t BlueNRG1_GattServer::reset(void)
+{
+    GattServer::reset();
+
+    attrCount     = 0;
+    cccdSlotCount = 0;
+    pendingHead   = 0;
+    pendingCount  = 0;
+    attMtuChangedCallback = NULL;
+    memoryUse.services      = 0;
+    memoryUse.attributes    = 0;
+    memoryUse.attValueBytes = 0;
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  A client wrote an attribute: CCCD writes become updates
+            enabled/disabled events, everything else a data written event
+*/
+/**************************************************************************/
+void BlueNRG1_GattServer::onAttributeModified(uint16_t connectionHandle, uint16_t attrHandle, uint16_t offset, uint16_t length, const uint8_t *data)
+{
+    const BlueNRG1_AttrEntry_t *entry = findAttribute(attrHandle);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    if (entry->type == BLUENRG1_ATTR_CCCD) {
+        uint16_t cccd = (length > 1) ? (data[0] | (data[1] << 8)) : ((length > 0) ? data[0] : 0);
+        GattAttribute::Handle_t valueHandle = entry->characteristic->getValueHandle();
+
+        BlueNRG1_Links::getInstance().setSubscription(connectionHandle, entry->cccdSlot, cccd);
+
+        if (cccd & (CCCD_NOTIFICATION | CCCD_INDICATION)) {
+            handleEvent(GattServerEvents::GATT_EVENT_UPDATES_ENABLED, valueHandle);
+        } else {
+            handleEvent(GattServerEvents::GATT_EVENT_UPDATES_DISABLED, valueHandle);
+        }
+        return;
+    }
+
+    /* Longer than a write request: the value came in prepare writes, the
+       list counting them as packets of the default ATT_MTU */
+    if (offset + length > getAttMtu(connectionHandle) - 3) {
+        uint16_t prepareWrites = (offset + length + PREPARE_WRITE_LEN - 1) / PREPARE_WRITE_LEN;
+        if (prepareWrites > memoryUse.prepareWritesMax) {
+            memoryUse.prepareWritesMax = prepareWrites;
+        }
+    }
+
+    GattWriteCallbackParams writeParams;
+    writeParams.connHandle = connectionHandle;
+    writeParams.handle     = attrHandle;
+    writeParams.writeOp    = GattWriteCallbackParams::OP_WRITE_REQ;
+    writeParams.offset     = offset;
+    writeParams.len        = length;
+    writeParams.data       = data;
+
+    handleDataWrittenEvent(&writeParams);
+}
+
+
+extern "C" void aci_gatt_attribute_modified_event(uint16_t Connection_Handle,
+                                                  uint16_t Attr_Handle,
+                                                  uint16_t Offset,
+                                                  uint16_t Attr_Data_Length,
+                                                  uint8_t Attr_Data[])
+{
+    BLE_EVENT_SCOPE(ATTRIBUTE_MODIFIED);
+    BLE_TRACE_VS_EVENT(ACI_GATT_ATTRIBUTE_MODIFIED_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u16(Attr_Handle).u16(Offset).u16(Attr_Data_Length)
+                                       .bytes(Attr_Data, Attr_Data_Length));
+
+    BlueNRG1_GattServer::getInstance().onAttributeModified(Connection_Handle, Attr_Handle, Offset, Attr_Data_Length, Attr_Data);
+}
+
+extern "C" void aci_gatt_tx_pool_available_event(uint16_t Connection_Handle,
+                                                 uint16_t Available_Buffers)
+{
+    BLE_EVENT_SCOPE(TX_POOL_AVAILABLE);
+    BLE_TRACE_VS_EVENT(ACI_GATT_TX_POOL_AVAILABLE_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u16(Available_Buffers));
+
+    BlueNRG1_GattServer::getInstance().onTxPoolAvailable(Connection_Handle, Available_Buffers);
+}
+
+extern "C" void aci_att_exchange_mtu_resp_event(uint16_t Connection_Handle,
+                                                uint16_t Server_RX_MTU)
+{
+    BLE_EVENT_SCOPE(EXCHANGE_MTU_RESP);
+    BLE_TRACE_VS_EVENT(ACI_ATT_EXCHANGE_MTU_RESP_VSEVT_CODE, BLE_TRACE_PARAMS.u16(Connection_Handle).u16(Server_RX_MTU));
+
+    BlueNRG1_GattServer::getInstance().onMtuExchanged(Connection_Handle, Server_RX_MTU);
+}
+
+extern "C" void hci_number_of_completed_packets_event(uint8_t Number_of_Handles,
+                                                      Handle_Packets_Pair_Entry_t Handle_Packets_Pair_Entry[])
+{
+    BLE_EVENT_SCOPE(NUMBER_OF_COMPLETED_PACKETS);
+
+    unsigned count = 0;
+#if BLE_TRACE
+    BlueNRG1_TraceParams params;
+    params.u8(Number_of_Handles);
+#endif
+
+    for (uint8_t i = 0; i < Number_of_Handles; i++) {
+        BlueNRG1_Gap::getInstance().getTelemetry().onPacketsCompleted(Handle_Packets_Pair_Entry[i].Connection_Handle,
+                                                                      Handle_Packets_Pair_Entry[i].HC_Num_Of_Completed_Packets);
+        count += BlueNRG1_GattServer::getInstance().onPacketsCompleted(Handle_Packets_Pair_Entry[i].Connection_Handle,
+                                                                       Handle_Packets_Pair_Entry[i].HC_Num_Of_Completed_Packets);
+#if BLE_TRACE
+        params.u16(Handle_Packets_Pair_Entry[i].Connection_Handle)
+              .u16(Handle_Packets_Pair_Entry[i].HC_Num_Of_Completed_Packets);
+#endif
+    }
+    BLE_TRACE_EVENT(HCI_EVT_NUM_COMP_PKTS, params);
+
+    BlueNRG1_GattServer::getInstance().onUpdatesCompleted(count);
+}
@@ -5,26 +5,186 @@
     #include "mbed-drivers/mbed.h"
 #else
     #include "mbed.h"
-#endif 
+#endif
 #include "ble/blecommon.h"
 //#include "btle.h"
 #include "ble/GattService.h"
 #include "ble/GattServer.h"
-#include <vector>
-#include <map>
+
+#include "BlueNRG1_Links.h"
 
 #define BLE_TOTAL_CHARACTERISTICS 10
+#define BLE_TOTAL_DESCRIPTORS     10
+
+/* Characteristic values, CCCDs and user descriptors known to the port */
+#define BLE_TOTAL_ATTRIBUTES      (2*BLE_TOTAL_CHARACTERISTICS + BLE_TOTAL_DESCRIPTORS)
+
+/* cccdSlot of the attributes without CCCD */
+#define BLUENRG1_NO_CCCD_SLOT     0xFF
+
+/* Notifications parked while the stack is out of TX packet buffers */
+#define BLE_NOTIFY_QUEUE_SIZE       8
+#ifndef BLE_NOTIFY_QUEUE_VALUE_LEN
+#define BLE_NOTIFY_QUEUE_VALUE_LEN  (BLE_MAX_ATT_MTU - 3)
+#endif
+
+/**************************************************************************/
+/*!
+    \brief
+    Translation between mbed attribute handles and the handles the BlueNRG-1
+    ATT server needs to update them.
+
+    The table is filled in addService() and kept sorted by handle, so that
+    the lookup done by every write() is a binary search over a fixed array.
+*/
+/**************************************************************************/
+typedef enum {
+    BLUENRG1_ATTR_VALUE,       /**< Characteristic value. */
+    BLUENRG1_ATTR_CCCD,        /**< Client Characteristic Configuration Descriptor. */
+    BLUENRG1_ATTR_DESCRIPTOR   /**< Any other characteristic descriptor. */
+} BlueNRG1_AttrType_t;
+
+typedef struct {
+    GattAttribute::Handle_t handle;         /**< mbed handle, same as the ATT handle. */
+    uint16_t                serviceHandle;  /**< BlueNRG service handle. */
+    uint16_t                charHandle;     /**< BlueNRG characteristic declaration handle. */
+    uint8_t                 type;           /**< BlueNRG1_AttrType_t. */
+    uint8_t                 cccdSlot;       /**< Bit of the characteristic in the BlueNRG1_Link_t masks. */
+    GattCharacteristic     *characteristic; /**< Owning characteristic. */
+} BlueNRG1_AttrEntry_t;
 
-using namespace std;
+/**************************************************************************/
+/*!
+    \brief
+    Characteristic update rejected with BLE_STATUS_INSUFFICIENT_RESOURCES,
+    sent again on the next aci_gatt_tx_pool_available_event.
+*/
+/**************************************************************************/
+typedef struct {
+    GattAttribute::Handle_t handle;
+    uint16_t                connHandle;
+    uint8_t                 length;
+    uint8_t                 value[BLE_NOTIFY_QUEUE_VALUE_LEN];
+} BlueNRG1_PendingUpdate_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    Use of the stack memory btle.h reserves, see bluenrg1_stats_ble_get().
+
+    The stack does not tell how many packet blocks are in use: an update
+    is counted as the blocks its ATT PDU takes from the pool, held until
+    hci_number_of_completed_packets_event reports the link layer packets
+    sent, or the link closes. A long write is counted as the prepare
+    write list entries its length needs.
+*/
+/**************************************************************************/
+typedef struct {
+    uint16_t txBlocks;          /**< Blocks held by the updates sent. */
+    uint16_t txBlocksMax;
+    uint32_t txPoolExhausted;   /**< Updates refused with BLE_STATUS_INSUFFICIENT_RESOURCES. */
+    uint16_t prepareWritesMax;  /**< Prepare write list entries of the longest write received. */
+    uint16_t services;          /**< Services added. */
+    uint16_t attributes;        /**< Attribute records of the services added, declarations excluded. */
+    uint16_t attValueBytes;     /**< ATT_VALUE_ARRAY_SIZE bytes of the services added. */
+} BlueNRG1_MemoryUse_t;
 
 class BlueNRG1_GattServer : public GattServer
 {
 public:
+    /* Called with the link once its ATT_MTU has been negotiated */
+    typedef FunctionPointerWithContext<const BlueNRG1_Link_t *> AttMtuChangedCallback_t;
+
     static BlueNRG1_GattServer &getInstance() {
         static BlueNRG1_GattServer m_instance;
         return m_instance;
     }
-    
+
+    /* Functions that must be implemented from GattServer */
+    virtual ble_error_t addService(GattService &);
+    virtual ble_error_t read(GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP);
+    virtual ble_error_t read(Gap::Handle_t connectionHandle, GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP);
+    virtual ble_error_t write(GattAttribute::Handle_t, const uint8_t[], uint16_t, bool localOnly = false);
+    virtual ble_error_t write(Gap::Handle_t connectionHandle, GattAttribute::Handle_t, const uint8_t[], uint16_t, bool localOnly = false);
+    virtual ble_error_t areUpdatesEnabled(const GattCharacteristic &characteristic, bool *enabledP);
+    virtual ble_error_t areUpdatesEnabled(Gap::Handle_t connectionHandle, const GattCharacteristic &characteristic, bool *enabledP);
+    virtual ble_error_t reset(void);
+
+    /* Entry point for aci_gatt_attribute_modified_event */
+    void onAttributeModified(uint16_t connectionHandle, uint16_t attrHandle, uint16_t offset, uint16_t length, const uint8_t *data);
+
+    /* Entry point for aci_gatt_tx_pool_available_event */
+    void onTxPoolAvailable(uint16_t connectionHandle, uint16_t availableBuffers);
+    /* Entry point for hci_number_of_completed_packets_event, for each link of the event */
+    uint16_t onPacketsCompleted(Gap::Handle_t connectionHandle, uint16_t count);
+    /* Then with the updates they completed on all the links, for onDataSent */
+    void onUpdatesCompleted(unsigned count);
+    /* Entry point for aci_att_exchange_mtu_resp_event */
+    void onMtuExchanged(uint16_t connectionHandle, uint16_t mtu);
+    /* Drop what is still queued for a link that went away */
+    void onDisconnection(Gap::Handle_t connectionHandle);
+
+    const BlueNRG1_AttrEntry_t *findAttribute(GattAttribute::Handle_t handle) const;
+
+    /* Updates of a link waiting for TX buffers */
+    uint8_t  getPendingCount(Gap::Handle_t connectionHandle) const;
+
+    uint16_t getAttMtu(Gap::Handle_t connectionHandle) const;
+    uint16_t getMaxPayload(Gap::Handle_t connectionHandle) const;
+    uint16_t getMaxPayload(void) const;
+
+    const BlueNRG1_MemoryUse_t &getMemoryUse(void) const {
+        return memoryUse;
+    }
+    /* Share of the stack GATT database btle.h reserves for the services
+       added here, checked by addService() */
+    void setReservation(uint16_t services, uint16_t attributes, uint16_t attValueBytes);
+    /* Restart the high-water marks from the current use */
+    void resetMemoryPeaks(void);
+
+    void onAttMtuChanged(AttMtuChangedCallback_t callback) {
+        attMtuChangedCallback = callback;
+    }
+    template <typename T>
+    void onAttMtuChanged(T *objPtr, void (T::*memberPtr)(const BlueNRG1_Link_t *)) {
+        attMtuChangedCallback.attach(objPtr, memberPtr);
+    }
+
+private:
+    BlueNRG1_GattServer();
+
+    ble_error_t insertAttribute(GattAttribute::Handle_t handle, uint16_t serviceHandle, uint16_t charHandle,
+                                BlueNRG1_AttrType_t type, uint8_t cccdSlot, GattCharacteristic *characteristic);
+    uint8_t sendUpdate(const BlueNRG1_AttrEntry_t *entry, uint16_t connHandle,
+                       const uint8_t value[], uint16_t size, bool localOnly);
+    ble_error_t queueLinkUpdate(const BlueNRG1_AttrEntry_t *entry, uint16_t connHandle,
+                                const uint8_t value[], uint16_t size);
+    ble_error_t queueUpdate(GattAttribute::Handle_t handle, uint16_t connHandle,
+                            const uint8_t value[], uint16_t size);
+    bool        hasPendingUpdate(uint16_t connHandle) const;
+    ble_error_t updateLink(const BlueNRG1_AttrEntry_t *entry, uint16_t connHandle,
+                           const uint8_t value[], uint16_t size);
+    ble_error_t notifySubscribers(const BlueNRG1_AttrEntry_t *entry, const uint8_t value[], uint16_t size);
+    void flushPendingUpdates(void);
+    void countTxBlocks(uint16_t connHandle, uint16_t size);
+
+    BlueNRG1_AttrEntry_t attrTable[BLE_TOTAL_ATTRIBUTES];
+    uint8_t              attrCount;
+    uint8_t              cccdSlotCount;
+
+    BlueNRG1_PendingUpdate_t pendingUpdates[BLE_NOTIFY_QUEUE_SIZE];
+    uint8_t                  pendingHead;
+    uint8_t                  pendingCount;
+
+    AttMtuChangedCallback_t  attMtuChangedCallback;
+
+    BlueNRG1_MemoryUse_t     memoryUse;
+    uint16_t                 reservedServices;
+    uint16_t                 reservedAttributes;
+    uint16_t                 reservedAttValueBytes;
+
+    MBED_STATIC_ASSERT(BLE_TOTAL_CHARACTERISTICS <= BLE_LINK_CCCD_SLOTS, "Not enough CCCD slots per link");
+    MBED_STATIC_ASSERT(BLE_NOTIFY_QUEUE_VALUE_LEN <= 255, "BLE_NOTIFY_QUEUE_VALUE_LEN too large for the uint8_t length");
 };
 
-#endif //__BLUENRG1_GATTSERVER_H__
\ No newline at end of file
+#endif //__BLUENRG1_GATTSERVER_H__
@@ -0,0 +1,142 @@
+#include "BlueNRG1_Links.h"
+
+/* CCCD bits */
+#define CCCD_NOTIFICATION       0x0001
+#define CCCD_INDICATION         0x0002
+
+BlueNRG1_Links::BlueNRG1_Links()
+{
+    reset();
+}
+
+void BlueNRG1_Links::reset(void)
+{
+    memset(links, 0, sizeof(links));
+    count = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Take a free slot for a new connection
+
+    @returns    The link, NULL when all the BLE_MAX_LINKS slots are in use
+*/
+/**************************************************************************/
+BlueNRG1_Link_t *BlueNRG1_Links::add(Gap::Handle_t handle, Gap::Role_t role, BLEProtocol::AddressType_t peerAddrType,
+                                     const BLEProtocol::AddressBytes_t peerAddr, const Gap::ConnectionParams_t *params)
+{
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        if (!links[i].connected) {
+            memset(&links[i], 0, sizeof(links[i]));
+            links[i].handle       = handle;
+            links[i].connected    = true;
+            links[i].role         = role;
+            links[i].peerAddrType = peerAddrType;
+            memcpy(links[i].peerAddr, peerAddr, sizeof(links[i].peerAddr));
+            links[i].attMtu       = BLE_LINK_DEFAULT_ATT_MTU;
+            links[i].params       = *params;
+            count++;
+            return &links[i];
+        }
+    }
+
+    return NULL;
+}
+
+void BlueNRG1_Links::remove(Gap::Handle_t handle)
+{
+    BlueNRG1_Link_t *link = find(handle);
+
+    if (link != NULL) {
+        link->connected = false;
+        count--;
+    }
+}
+
+BlueNRG1_Link_t *BlueNRG1_Links::find(Gap::Handle_t handle)
+{
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        if (links[i].connected && (links[i].handle == handle)) {
+            return &links[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  ATT_MTU of a link, BLE_LINK_DEFAULT_ATT_MTU for an unknown one
+*/
+/**************************************************************************/
+uint16_t BlueNRG1_Links::getAttMtu(Gap::Handle_t handle)
+{
+    BlueNRG1_Link_t *link = find(handle);
+
+    return (link != NULL) ? link->attMtu : BLE_LINK_DEFAULT_ATT_MTU;
+}
+
+void BlueNRG1_Links::setAttMtu(Gap::Handle_t handle, uint16_t mtu)
+{
+    BlueNRG1_Link_t *link = find(handle);
+
+    if (link == NULL) {
+        return;
+    }
+
+    /* Both sides use the smaller of their receive MTUs */
+    if (mtu > BLE_MAX_ATT_MTU) {
+        mtu = BLE_MAX_ATT_MTU;
+    }
+    if (mtu < BLE_LINK_DEFAULT_ATT_MTU) {
+        mtu = BLE_LINK_DEFAULT_ATT_MTU;
+    }
+    link->attMtu = mtu;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Record the CCCD value a client wrote for the given slot
+*/
+/**************************************************************************/
+void BlueNRG1_Links::setSubscription(Gap::Handle_t handle, uint8_t slot, uint16_t cccd)
+{
+    BlueNRG1_Link_t *link = find(handle);
+
+    if ((link == NULL) || (slot >= BLE_LINK_CCCD_SLOTS)) {
+        return;
+    }
+
+    uint32_t bit = (uint32_t)1 << slot;
+
+    if (cccd & CCCD_NOTIFICATION) {
+        link->notifyMask |= bit;
+    } else {
+        link->notifyMask &= ~bit;
+    }
+    if (cccd & CCCD_INDICATION) {
+        link->indicateMask |= bit;
+    } else {
+        link->indicateMask &= ~bit;
+    }
+}
+
+bool BlueNRG1_Links::isSubscribed(const BlueNRG1_Link_t *link, uint8_t slot) const
+{
+    if (!link->connected || (slot >= BLE_LINK_CCCD_SLOTS)) {
+        return false;
+    }
+
+    return ((link->notifyMask | link->indicateMask) & ((uint32_t)1 << slot)) != 0;
+}
+
+bool BlueNRG1_Links::anySubscribed(uint8_t slot) const
+{
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        if (isSubscribed(&links[i], slot)) {
+            return true;
+        }
+    }
+
+    return false;
+}
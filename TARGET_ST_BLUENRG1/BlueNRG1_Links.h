@@ -0,0 +1,155 @@
+#ifndef __BLUENRG1_LINKS_H__
+#define __BLUENRG1_LINKS_H__
+
+#ifdef YOTTA_CFG_MBED_OS
+    #include "mbed-drivers/mbed.h"
+#else
+    #include "mbed.h"
+#endif
+#include "ble/blecommon.h"
+#include "ble/Gap.h"
+
+/* Simultaneous connections, also used as NUM_LINKS by btle.h [1:8] */
+#ifndef BLE_MAX_LINKS
+#define BLE_MAX_LINKS             2
+#endif
+
+/* CCCD slots tracked per link, one bit each */
+#define BLE_LINK_CCCD_SLOTS       32
+
+/* Updates per link whose packets are tracked until they complete, for onDataSent */
+#ifndef BLE_LINK_TX_UPDATES
+#define BLE_LINK_TX_UPDATES       32
+#endif
+
+/* ATT_MTU until an exchange MTU procedure completes */
+#define BLE_LINK_DEFAULT_ATT_MTU  23
+
+/* ATT_MTU offered in the exchange MTU procedure, also MAX_ATT_MTU of btle.h [23:158] */
+#ifndef BLE_MAX_ATT_MTU
+#define BLE_MAX_ATT_MTU           158
+#endif
+
+/* RSSI samples kept per link by BlueNRG1_Telemetry */
+#ifndef BLE_LINK_RSSI_SAMPLES
+#define BLE_LINK_RSSI_SAMPLES     8
+#endif
+
+/**************************************************************************/
+/*!
+    \brief
+    Connection parameter requests of BlueNRG1_ConnManager on one link.
+*/
+/**************************************************************************/
+typedef struct {
+    uint8_t                 profile;       /**< BlueNRG1_ConnManager::Profile_t in use. */
+    uint8_t                 requested;     /**< Profile last requested. */
+    uint8_t                 reason;        /**< BlueNRG1_ConnManager::Reason_t of the last request. */
+    uint8_t                 steadyWindows; /**< Windows in a row at the steady rate. */
+    bool                    pending;       /**< Waiting for the peer or the link layer. */
+    uint8_t                 retries;       /**< Requests refused in a row. */
+    uint8_t                 retryWindows;  /**< Windows to wait before requesting again. */
+    uint8_t                 peerTraffic;   /**< Profile the traffic called for under CONN_PROFILE_PEER,
+                                                CONN_PROFILE_INITIAL until the first window. */
+    uint16_t                rate;          /**< Notifications per second over the last window. */
+    uint32_t                notifyMark;    /**< notifyCount at the start of the window. */
+    uint32_t                rejected;
+} BlueNRG1_ConnUpdate_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    Link quality samples and notification counters of BlueNRG1_Telemetry
+    on one link.
+*/
+/**************************************************************************/
+typedef struct {
+    int8_t                  rssi[BLE_LINK_RSSI_SAMPLES];  /**< Ring of the last samples, dBm. */
+    uint8_t                 rssiHead;      /**< Next sample slot. */
+    uint8_t                 rssiCount;
+    uint8_t                 status;        /**< BlueNRG1_Telemetry::LinkStatus_t. */
+    uint8_t                 channelMap[5];
+    uint32_t                samples;
+    uint32_t                queued;
+    uint32_t                sent;
+    uint32_t                dropped;
+    uint32_t                packetsCompleted;
+    uint32_t                congestionMark; /**< queued + dropped seen by BlueNRG1_TxPowerControl. */
+} BlueNRG1_LinkQuality_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    State the port keeps for one connection.
+*/
+/**************************************************************************/
+typedef struct {
+    Gap::Handle_t           handle;
+    bool                    connected;
+    Gap::Role_t             role;
+    BLEProtocol::AddressType_t  peerAddrType;
+    BLEProtocol::AddressBytes_t peerAddr;
+    uint16_t                attMtu;        /**< Negotiated ATT_MTU, notification payload is attMtu - 3. */
+    Gap::ConnectionParams_t params;        /**< Interval, latency and timeout in use. */
+    uint32_t                notifyMask;    /**< Bit n: notifications enabled on CCCD slot n. */
+    uint32_t                indicateMask;  /**< Bit n: indications enabled on CCCD slot n. */
+    uint32_t                notifyCount;   /**< Notifications and indications sent or received. */
+    uint8_t                 security;      /**< SecurityManager::LinkSecurityStatus_t. */
+    uint8_t                 securityMode;  /**< SecurityManager::SecurityMode_t once encrypted. */
+    bool                    comparePending; /**< Numeric Comparison waiting for confirmNumericComparison(). */
+    uint16_t                txBlocks;      /**< Packet blocks of the updates not completed yet, estimated. */
+    uint8_t                 txUpdates[BLE_LINK_TX_UPDATES]; /**< Blocks of each of these updates, oldest first. */
+    uint8_t                 txUpdateHead;
+    uint8_t                 txUpdateCount;
+    uint8_t                 txUpdateDone;  /**< Blocks of the oldest update already completed. */
+    BlueNRG1_ConnUpdate_t   connUpdate;
+    BlueNRG1_LinkQuality_t  quality;
+} BlueNRG1_Link_t;
+
+/**************************************************************************/
+/*!
+    \brief
+    Fixed table of the active connections.
+
+    Filled by BlueNRG1_Gap on connection and disconnection, the GATT server
+    records there which CCCDs every client enabled, so that characteristic
+    updates are only sent to the links that subscribed.
+*/
+/**************************************************************************/
+class BlueNRG1_Links
+{
+public:
+    static BlueNRG1_Links &getInstance() {
+        static BlueNRG1_Links m_instance;
+        return m_instance;
+    }
+
+    BlueNRG1_Link_t *add(Gap::Handle_t handle, Gap::Role_t role, BLEProtocol::AddressType_t peerAddrType,
+                         const BLEProtocol::AddressBytes_t peerAddr, const Gap::ConnectionParams_t *params);
+    void             remove(Gap::Handle_t handle);
+    BlueNRG1_Link_t *find(Gap::Handle_t handle);
+
+    /* Iterate with index in [0:BLE_MAX_LINKS), unused slots are not connected */
+    BlueNRG1_Link_t *at(uint8_t index) {
+        return &links[index];
+    }
+    uint8_t          getCount(void) const {
+        return count;
+    }
+
+    uint16_t         getAttMtu(Gap::Handle_t handle);
+    void             setAttMtu(Gap::Handle_t handle, uint16_t mtu);
+
+    void             setSubscription(Gap::Handle_t handle, uint8_t slot, uint16_t cccd);
+    bool             isSubscribed(const BlueNRG1_Link_t *link, uint8_t slot) const;
+    bool             anySubscribed(uint8_t slot) const;
+    void             reset(void);
+
+private:
+    BlueNRG1_Links();
+
+    BlueNRG1_Link_t links[BLE_MAX_LINKS];
+    uint8_t         count;
+};
+
+#endif //__BLUENRG1_LINKS_H__
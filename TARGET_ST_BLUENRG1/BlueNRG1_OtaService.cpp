@@ -0,0 +1,357 @@
+#include "BlueNRG1_OtaService.h"
+
+#if BLE_OTA
+
+#include "ble/BLE.h"
+#include "ble/GattService.h"
+
+#include "BlueNRG1_Gap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "compiler.h"
+#include "BlueNRG1_flash.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* Application banks of the reset manager, see BLUENRG1.icf */
+#define OTA_RESET_MANAGER_SIZE  0x800
+#define OTA_NVM_SIZE            (4 * 1024)
+#define OTA_APP_SIZE            ((_MEMORY_FLASH_SIZE_ - OTA_RESET_MANAGER_SIZE - OTA_NVM_SIZE - N_BYTES_PAGE) / 2)
+#define OTA_LOWER_APP_BASE      (FLASH_START + OTA_RESET_MANAGER_SIZE)
+#define OTA_HIGHER_APP_BASE     (OTA_LOWER_APP_BASE + OTA_APP_SIZE)
+
+#if defined (ST_OTA_LOWER_APPLICATION)
+#define OTA_RUNNING_APP_BASE    OTA_LOWER_APP_BASE
+#define OTA_TARGET_APP_BASE     OTA_HIGHER_APP_BASE
+#else
+#define OTA_RUNNING_APP_BASE    OTA_HIGHER_APP_BASE
+#define OTA_TARGET_APP_BASE     OTA_LOWER_APP_BASE
+#endif
+
+/* The last page of a bank holds its GATT cache (BLOCK_GATT_CACHE) */
+#define OTA_MAX_IMAGE_SIZE      (OTA_APP_SIZE - N_BYTES_PAGE)
+#define OTA_GATT_CACHE_ADDRESS  (OTA_TARGET_APP_BASE + OTA_MAX_IMAGE_SIZE)
+
+/* Vector table word the reset manager checks, OTA_xxx_TAG of system_bluenrg1.c */
+#define OTA_TAG_OFFSET          0x10
+#define OTA_VALID_APP_TAG       0xAA5555AA
+#define OTA_INVALID_OLD_APP_TAG 0x00000000
+/* Reset vector */
+#define OTA_RESET_OFFSET        0x04
+
+#define OTA_BURST_SIZE          16
+
+#define OTA_PAGE_OF(address)    ((uint16_t)(((address) - FLASH_START) / N_BYTES_PAGE))
+
+static const char OTA_SERVICE_UUID[] = "4f544100-6e3b-4c8e-9d3a-1b8b52f0a5c7";
+static const char OTA_CONTROL_UUID[] = "4f544101-6e3b-4c8e-9d3a-1b8b52f0a5c7";
+static const char OTA_DATA_UUID[]    = "4f544102-6e3b-4c8e-9d3a-1b8b52f0a5c7";
+
+/* CRC-32 (IEEE 802.3), reflected, four bits at a time */
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+static void resetSystem(void)
+{
+    NVIC_SystemReset();
+}
+
+BlueNRG1_OtaService::BlueNRG1_OtaService() :
+    controlChar(UUID(OTA_CONTROL_UUID), controlValue, 0, BLE_OTA_CONTROL_LEN,
+                GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE | GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY),
+    dataChar(UUID(OTA_DATA_UUID), dataValue, 0, BLE_OTA_DATA_LEN,
+             GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE),
+    initialized(false),
+    active(false),
+    connHandle(0),
+    imageSize(0),
+    imageCrc(0),
+    crc(0),
+    received(0),
+    programmed(0),
+    fillLength(0),
+    fillIndex(0),
+    programIndex(0)
+{
+    full[0] = false;
+    full[1] = false;
+}
+
+ble_error_t BlueNRG1_OtaService::init(void)
+{
+    if (initialized) {
+        return BLE_ERROR_NONE;
+    }
+
+    BLE &ble = BLE::Instance(BLE::DEFAULT_INSTANCE);
+    GattCharacteristic *chars[] = {&controlChar, &dataChar};
+    GattService service(UUID(OTA_SERVICE_UUID), chars, sizeof(chars) / sizeof(chars[0]));
+
+    controlChar.requireSecurity(SecurityManager::SECURITY_MODE_ENCRYPTION_NO_MITM);
+    dataChar.requireSecurity(SecurityManager::SECURITY_MODE_ENCRYPTION_NO_MITM);
+
+    ble_error_t error = ble.gattServer().addService(service);
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+
+    ble.gattServer().onDataWritten(this, &BlueNRG1_OtaService::onDataWritten);
+    initialized = true;
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_OtaService::onDataWritten(const GattWriteCallbackParams *params)
+{
+    if (params->handle == dataChar.getValueHandle()) {
+        if (active && (params->connHandle == connHandle)) {
+            onData(params->data, params->len);
+        }
+    } else if (params->handle == controlChar.getValueHandle()) {
+        onControl(params->connHandle, params->data, params->len);
+    }
+}
+
+void BlueNRG1_OtaService::onControl(Gap::Handle_t handle, const uint8_t *data, uint16_t length)
+{
+    if ((length == BLE_OTA_CONTROL_LEN) && (data[0] == BLE_OTA_CMD_START)) {
+        if (active) {
+            stop(BLE_OTA_STATUS_ABORTED);
+        }
+        start(handle,
+              data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24),
+              data[5] | (data[6] << 8) | (data[7] << 16) | ((uint32_t)data[8] << 24));
+    } else if ((length == 1) && (data[0] == BLE_OTA_CMD_ABORT)) {
+        if (active && (handle == connHandle)) {
+            stop(BLE_OTA_STATUS_ABORTED);
+        }
+    } else if (!active) {
+        connHandle = handle;
+        notify(BLE_OTA_STATUS_INVALID_CMD);
+    }
+}
+
+void BlueNRG1_OtaService::start(Gap::Handle_t handle, uint32_t size, uint32_t expectedCrc)
+{
+    connHandle   = handle;
+    imageSize    = size;
+    imageCrc     = expectedCrc;
+    crc          = 0;
+    received     = 0;
+    programmed   = 0;
+    fillLength   = 0;
+    fillIndex    = 0;
+    programIndex = 0;
+    full[0]      = false;
+    full[1]      = false;
+
+    if ((size == 0) || (size > OTA_MAX_IMAGE_SIZE)) {
+        notify(BLE_OTA_STATUS_INVALID_SIZE);
+        return;
+    }
+
+    active = true;
+    notify(BLE_OTA_STATUS_PROGRESS);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Copy a data packet into the buffers, swapping them as they fill
+*/
+/**************************************************************************/
+void BlueNRG1_OtaService::onData(const uint8_t *data, uint16_t length)
+{
+    if (length > (imageSize - received)) {
+        stop(BLE_OTA_STATUS_OVERFLOW);
+        return;
+    }
+
+    while (active && (length > 0)) {
+        if (full[fillIndex]) {
+            /* The client ran more than two buffers ahead */
+            stop(BLE_OTA_STATUS_OVERFLOW);
+            return;
+        }
+
+        uint16_t chunk = BLE_OTA_BUFFER_SIZE - fillLength;
+        if (chunk > length) {
+            chunk = length;
+        }
+        memcpy(&buffers[fillIndex][fillLength], data, chunk);
+        fillLength += chunk;
+        received   += chunk;
+        data       += chunk;
+        length     -= chunk;
+
+        if ((fillLength == BLE_OTA_BUFFER_SIZE) || (received == imageSize)) {
+            bufferFull();
+        }
+    }
+}
+
+void BlueNRG1_OtaService::bufferFull(void)
+{
+    uint16_t durationUs = (fillLength + OTA_BURST_SIZE - 1) / OTA_BURST_SIZE * BLE_OTA_BURST_PROGRAM_US;
+
+    if (((OTA_TARGET_APP_BASE + received - fillLength) % N_BYTES_PAGE) == 0) {
+        durationUs += BLE_OTA_PAGE_ERASE_US;
+    }
+
+    /* The last burst is padded with erased bytes */
+    memset(&buffers[fillIndex][fillLength], 0xFF, BLE_OTA_BUFFER_SIZE - fillLength);
+    full[fillIndex] = true;
+    fillIndex ^= 1;
+    fillLength = 0;
+
+    callWhenRadioIdle(&BlueNRG1_OtaService::programBuffer, durationUs);
+}
+
+/* Flash work in an idle radio window, never from the event: the update stops with BUSY when none is queued */
+void BlueNRG1_OtaService::callWhenRadioIdle(void (BlueNRG1_OtaService::*work)(void), uint16_t durationUs)
+{
+    BlueNRG1_RadioScheduler &scheduler = BlueNRG1_Gap::getInstance().getRadioScheduler();
+
+    if (scheduler.callWhenRadioIdle(callback(this, work), durationUs) != BLE_ERROR_NONE) {
+        stop(BLE_OTA_STATUS_BUSY);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Program the oldest full buffer, read it back and notify it
+
+    Runs in an idle radio window: the core stalls for about 21 ms on a
+    page erase and BLE_OTA_BURST_PROGRAM_US on every burst.
+*/
+/**************************************************************************/
+void BlueNRG1_OtaService::programBuffer(void)
+{
+    if (!active || !full[programIndex]) {
+        /* Stopped, or programmed by the work of the other buffer */
+        return;
+    }
+
+    uint8_t  *buffer  = buffers[programIndex];
+    uint32_t  address = OTA_TARGET_APP_BASE + programmed;
+    uint32_t  length  = imageSize - programmed;
+    if (length > BLE_OTA_BUFFER_SIZE) {
+        length = BLE_OTA_BUFFER_SIZE;
+    }
+
+    crc = crc32Update(crc, buffer, length);
+
+    if (programmed == 0) {
+        uint32_t *vectors = (uint32_t *)buffer;
+        uint32_t  reset   = vectors[OTA_RESET_OFFSET >> 2];
+
+        if ((length < (OTA_TAG_OFFSET + 4)) ||
+            (reset < OTA_TARGET_APP_BASE) || (reset >= (OTA_TARGET_APP_BASE + OTA_MAX_IMAGE_SIZE))) {
+            stop(BLE_OTA_STATUS_WRONG_BANK);
+            return;
+        }
+        /* Left erased, not a valid application until finish() */
+        vectors[OTA_TAG_OFFSET >> 2] = 0xFFFFFFFF;
+    }
+
+    if ((address % N_BYTES_PAGE) == 0) {
+        FLASH_ErasePage(OTA_PAGE_OF(address));
+    }
+    for (uint32_t offset = 0; offset < length; offset += OTA_BURST_SIZE) {
+        FLASH_ProgramWordBurst(address + offset, (uint32_t *)&buffer[offset]);
+    }
+    if (memcmp((const void *)address, buffer, length) != 0) {
+        stop(BLE_OTA_STATUS_FLASH_ERROR);
+        return;
+    }
+
+    full[programIndex] = false;
+    programIndex ^= 1;
+    programmed += length;
+
+    if (programmed == imageSize) {
+        /* The window of this buffer only covers its own bursts */
+        callWhenRadioIdle(&BlueNRG1_OtaService::finish, BLE_OTA_PAGE_ERASE_US + (2 * BLE_OTA_WORD_PROGRAM_US));
+    } else {
+        notify(BLE_OTA_STATUS_PROGRESS);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Verify the image and swap the banks
+
+    Runs in an idle radio window of its own: a page erase and two words.
+*/
+/**************************************************************************/
+void BlueNRG1_OtaService::finish(void)
+{
+    if (!active) {
+        /* Stopped while waiting for the window */
+        return;
+    }
+    if (crc != imageCrc) {
+        stop(BLE_OTA_STATUS_CRC_ERROR);
+        return;
+    }
+
+    /* Stale discovery cache of the image that ran from this bank before */
+    FLASH_ErasePage(OTA_PAGE_OF(OTA_GATT_CACHE_ADDRESS));
+
+    /* Bits only go from 1 to 0: no erase needed for either tag */
+    FLASH_ProgramWord(OTA_TARGET_APP_BASE + OTA_TAG_OFFSET, OTA_VALID_APP_TAG);
+    FLASH_ProgramWord(OTA_RUNNING_APP_BASE + OTA_TAG_OFFSET, OTA_INVALID_OLD_APP_TAG);
+
+    active = false;
+    notify(BLE_OTA_STATUS_COMPLETE);
+    resetTimer.attach_us(callback(resetSystem), BLE_OTA_RESET_DELAY_MS * 1000);
+}
+
+void BlueNRG1_OtaService::stop(uint8_t status)
+{
+    active  = false;
+    full[0] = false;
+    full[1] = false;
+    notify(status);
+}
+
+/* Status and bytes programmed, to the client of the update */
+void BlueNRG1_OtaService::notify(uint8_t status)
+{
+    uint8_t value[5];
+
+    value[0] = status;
+    value[1] = (uint8_t)programmed;
+    value[2] = (uint8_t)(programmed >> 8);
+    value[3] = (uint8_t)(programmed >> 16);
+    value[4] = (uint8_t)(programmed >> 24);
+
+    BLE::Instance(BLE::DEFAULT_INSTANCE).gattServer().write(connHandle, controlChar.getValueHandle(), value, sizeof(value));
+}
+
+void BlueNRG1_OtaService::onDisconnection(Gap::Handle_t handle)
+{
+    if (active && (handle == connHandle)) {
+        active  = false;
+        full[0] = false;
+        full[1] = false;
+    }
+}
+
+#endif /* BLE_OTA */
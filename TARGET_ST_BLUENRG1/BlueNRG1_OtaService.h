@@ -0,0 +1,154 @@
+#ifndef __BLUENRG1_OTASERVICE_H__
+#define __BLUENRG1_OTASERVICE_H__
+
+#ifdef YOTTA_CFG_MBED_OS
+    #include "mbed-drivers/mbed.h"
+#else
+    #include "mbed.h"
+#endif
+#include "ble/blecommon.h"
+#include "ble/GattCharacteristic.h"
+#include "ble/GattCallbackParamTypes.h"
+
+#include "BlueNRG1_GattDb.h"
+#include "BlueNRG1_Links.h"
+
+/* Firmware update over the air, for the images linked in one of the two
+   application banks of the reset manager (see BLUENRG1.icf) */
+#if defined (ST_OTA_LOWER_APPLICATION) || defined (ST_OTA_HIGHER_APPLICATION)
+#define BLE_OTA                     1
+#else
+#define BLE_OTA                     0
+#endif
+
+/* RAM staging buffers, programmed while the other one fills: a multiple
+   of the 16 bytes flash burst dividing the 2 KB flash page */
+#ifndef BLE_OTA_BUFFER_SIZE
+#define BLE_OTA_BUFFER_SIZE         512
+#endif
+
+/* Flash timings the idle radio windows are asked for, us */
+#define BLE_OTA_PAGE_ERASE_US       21500
+#define BLE_OTA_BURST_PROGRAM_US    180
+#define BLE_OTA_WORD_PROGRAM_US     50
+
+/* Delay between the last notification and the reset into the new image */
+#ifndef BLE_OTA_RESET_DELAY_MS
+#define BLE_OTA_RESET_DELAY_MS      500
+#endif
+
+/* Control point: command written, status notified */
+#define BLE_OTA_CONTROL_LEN         9
+/* Image data: write without response, one ATT payload at the largest MTU */
+#define BLE_OTA_DATA_LEN            (BLE_MAX_ATT_MTU - 3)
+
+/* Commands written to the control point */
+#define BLE_OTA_CMD_START           0x01    /**< Image size (u32), CRC-32 of the image (u32). */
+#define BLE_OTA_CMD_ABORT           0x02
+
+/* First byte of the control point notifications, then the bytes programmed (u32) */
+#define BLE_OTA_STATUS_PROGRESS     0x00    /**< Another BLE_OTA_BUFFER_SIZE bytes may be sent. */
+#define BLE_OTA_STATUS_COMPLETE     0x01    /**< Image verified, the device resets into it. */
+#define BLE_OTA_STATUS_INVALID_CMD  0x80
+#define BLE_OTA_STATUS_INVALID_SIZE 0x81    /**< Empty image, or larger than the bank. */
+#define BLE_OTA_STATUS_OVERFLOW     0x82    /**< Data beyond the image or the two buffers. */
+#define BLE_OTA_STATUS_WRONG_BANK   0x83    /**< Reset vector outside of the bank written. */
+#define BLE_OTA_STATUS_FLASH_ERROR  0x84    /**< Flash read back differs from the data. */
+#define BLE_OTA_STATUS_CRC_ERROR    0x85
+#define BLE_OTA_STATUS_ABORTED      0x86
+#define BLE_OTA_STATUS_BUSY         0x87    /**< No idle radio window could be queued for the flash. */
+
+/* OTA service, see btle.h */
+typedef BlueNRG1_GattDbService<BLUENRG1_UUID_128,
+            BlueNRG1_GattDbChar<BLUENRG1_UUID_128, BLE_OTA_CONTROL_LEN,
+                                GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE |
+                                GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY, true>,
+            BlueNRG1_GattDbChar<BLUENRG1_UUID_128, BLE_OTA_DATA_LEN,
+                                GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE, true> > OtaGattDb;
+
+/**************************************************************************/
+/*!
+    \brief
+    Streaming firmware update into the application bank not running.
+
+    The client writes START with the size and CRC-32 of the image to the
+    control point, then the image in order to the data characteristic,
+    as writes without response of up to ATT_MTU - 3 bytes.
+
+    The packets are copied into one of two RAM buffers of
+    BLE_OTA_BUFFER_SIZE bytes. A full buffer is programmed with
+    FLASH_ProgramWordBurst(), its page erased first when it starts one,
+    in an idle window of BlueNRG1_RadioScheduler so the flash stalls miss
+    no connection event; the other buffer keeps filling meanwhile. Each
+    buffer programmed is read back and notified as PROGRESS: the client
+    keeps at most two buffers ahead of the bytes notified, anything more
+    aborts the update with OVERFLOW.
+
+    The vector table tag of the new image stays erased until the last
+    buffer is programmed and the CRC-32 of the image matches. The new
+    bank is then tagged valid, the running one invalid, and the device
+    resets: the reset manager boots the bank with the valid tag. The
+    GATT cache page erase and the tags get an idle window of their own.
+
+    Both characteristics require an encrypted link.
+*/
+/**************************************************************************/
+class BlueNRG1_OtaService
+{
+public:
+    static BlueNRG1_OtaService &getInstance() {
+        static BlueNRG1_OtaService m_instance;
+        return m_instance;
+    }
+
+    /* Add the service to the GATT server */
+    ble_error_t init(void);
+
+    bool        isActive(void) const {
+        return active;
+    }
+
+    /* Called by BlueNRG1_Gap once the link is removed */
+    void        onDisconnection(Gap::Handle_t handle);
+
+private:
+    BlueNRG1_OtaService();
+
+    void        onDataWritten(const GattWriteCallbackParams *params);
+    void        onControl(Gap::Handle_t handle, const uint8_t *data, uint16_t length);
+    void        onData(const uint8_t *data, uint16_t length);
+    void        start(Gap::Handle_t handle, uint32_t size, uint32_t crc);
+    void        bufferFull(void);
+    void        callWhenRadioIdle(void (BlueNRG1_OtaService::*work)(void), uint16_t durationUs);
+    void        programBuffer(void);
+    void        finish(void);
+    void        stop(uint8_t status);
+    void        notify(uint8_t status);
+
+    uint8_t            controlValue[BLE_OTA_CONTROL_LEN];
+    uint8_t            dataValue[BLE_OTA_DATA_LEN];
+    GattCharacteristic controlChar;
+    GattCharacteristic dataChar;
+    bool               initialized;
+
+    bool               active;
+    Gap::Handle_t      connHandle;      /**< Link the update came from. */
+    uint32_t           imageSize;
+    uint32_t           imageCrc;        /**< Expected CRC-32. */
+    uint32_t           crc;             /**< CRC-32 of the bytes programmed. */
+    uint32_t           received;
+    uint32_t           programmed;
+
+    uint8_t            buffers[2][BLE_OTA_BUFFER_SIZE];
+    uint16_t           fillLength;      /**< Bytes in buffers[fillIndex]. */
+    uint8_t            fillIndex;
+    uint8_t            programIndex;    /**< Next buffer to program. */
+    bool               full[2];
+
+    Timeout            resetTimer;
+
+    MBED_STATIC_ASSERT((BLE_OTA_BUFFER_SIZE % 16) == 0, "BLE_OTA_BUFFER_SIZE must be made of flash bursts");
+    MBED_STATIC_ASSERT((2048 % BLE_OTA_BUFFER_SIZE) == 0, "BLE_OTA_BUFFER_SIZE must divide the flash page");
+};
+
+#endif //__BLUENRG1_OTASERVICE_H__
@@ -0,0 +1,302 @@
+#include "BlueNRG1_RadioScheduler.h"
+#include "BlueNRG1_Events.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_Links.h"
+#include "BlueNRG1_Trace.h"
+
+#include "hal/us_ticker_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_events.h"
+#include "bluenrg1_stack.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* States of aci_hal_end_of_radio_activity_event and aci_hal_get_link_status() */
+#define RADIO_STATE_IDLE        0x00
+#define RADIO_STATE_SLAVE       0x02
+#define RADIO_STATE_MASTER      0x05
+
+/* Links reported by aci_hal_get_link_status() */
+#define RADIO_HAL_LINKS         8
+
+/* Activities reported while work is waiting */
+#define RADIO_ACTIVITY_MASK     (BLE_RADIO_ACTIVITY_ADVERTISING | BLE_RADIO_ACTIVITY_SLAVE |          \
+                                 BLE_RADIO_ACTIVITY_SCANNING | BLE_RADIO_ACTIVITY_CONN_REQUEST |     \
+                                 BLE_RADIO_ACTIVITY_MASTER)
+
+/* sysT32 ticks are 2.4414 us: 4096 ticks every 10 ms */
+#define SYST_TO_US(t)           ((int32_t)(((int64_t)(t) * 10000) / 4096))
+
+BlueNRG1_RadioScheduler::BlueNRG1_RadioScheduler() :
+    idleCount(0),
+    jitCount(0),
+    mask(0),
+    windowOpen(false),
+    windowUnbounded(false),
+    windowEnd(0),
+    leadArmed(false),
+    leadExpired(false),
+    leadDeadline(0)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/* Nothing scheduled on the radio: no advertising, scanning or link */
+bool BlueNRG1_RadioScheduler::radioIdle(void)
+{
+    uint8_t  status[RADIO_HAL_LINKS];
+    uint16_t handles[RADIO_HAL_LINKS];
+
+    if (BLE_TRACE_COMMAND(ACI_HAL_GET_LINK_STATUS_OPCODE, BLE_TRACE_PARAMS,
+                          aci_hal_get_link_status(status, handles)) != BLE_STATUS_SUCCESS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < RADIO_HAL_LINKS; i++) {
+        if (status[i] != RADIO_STATE_IDLE) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Radio events only while work is waiting, they come after every connection event */
+void BlueNRG1_RadioScheduler::updateMask(void)
+{
+    uint16_t wanted = ((idleCount > 0) || (jitCount > 0)) ? RADIO_ACTIVITY_MASK : 0;
+
+    if (wanted == mask) {
+        return;
+    }
+    if (BLE_TRACE_COMMAND(ACI_HAL_SET_RADIO_ACTIVITY_MASK_OPCODE, BLE_TRACE_PARAMS.u16(wanted),
+                          aci_hal_set_radio_activity_mask(wanted)) == BLE_STATUS_SUCCESS) {
+        mask = wanted;
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run a work in the next radio idle window long enough for it,
+            at once when nothing is scheduled on the radio
+
+    @param[in]  work
+    @param[in]  durationUs  Time the work needs
+
+    @returns    BLE_ERROR_NO_MEM when the queue is full
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_RadioScheduler::callWhenRadioIdle(Work_t work, uint16_t durationUs)
+{
+    if (idleCount >= BLE_RADIO_IDLE_QUEUE_SIZE) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    if ((idleCount == 0) && radioIdle()) {
+        work();
+        return BLE_ERROR_NONE;
+    }
+
+    idleQueue[idleCount].work       = work;
+    idleQueue[idleCount].durationUs = durationUs;
+    idleQueue[idleCount].skips      = 0;
+    idleCount++;
+    updateMask();
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run a work once, leadUs before the next connection event; with
+            several works waiting, the timer follows the largest lead
+
+    @returns    BLE_ERROR_INVALID_STATE without link, BLE_ERROR_NO_MEM when
+                BLE_RADIO_JIT_CALLBACKS works are waiting
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_RadioScheduler::callBeforeConnectionEvent(Work_t work, uint16_t leadUs)
+{
+    if (BlueNRG1_Links::getInstance().getCount() == 0) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    if (jitCount >= BLE_RADIO_JIT_CALLBACKS) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    jitWork[jitCount].work   = work;
+    jitWork[jitCount].leadUs = leadUs;
+    jitCount++;
+    updateMask();
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_RadioScheduler::cancel(void)
+{
+    leadTimer.detach();
+    leadArmed   = false;
+    leadExpired = false;
+    idleCount   = 0;
+    jitCount    = 0;
+    updateMask();
+}
+
+/* The works waiting for a connection event go with the last link */
+void BlueNRG1_RadioScheduler::onLinksChanged(void)
+{
+    if ((BlueNRG1_Links::getInstance().getCount() > 0) || (jitCount == 0)) {
+        return;
+    }
+
+    leadTimer.detach();
+    leadArmed   = false;
+    leadExpired = false;
+    jitCount    = 0;
+    updateMask();
+}
+
+/**************************************************************************/
+/*!
+    @brief  A radio activity ended: note the idle window up to the next
+            one, and arm the lead timer when it is a connection event
+*/
+/**************************************************************************/
+void BlueNRG1_RadioScheduler::onRadioActivityEnd(uint8_t lastState, uint8_t nextState, uint32_t nextStateSysTime)
+{
+    (void)lastState;
+
+    windowOpen      = (idleCount > 0);
+    windowUnbounded = (nextState == RADIO_STATE_IDLE);
+    windowEnd       = nextStateSysTime;
+
+    if ((jitCount == 0) || leadArmed ||
+        ((nextState != RADIO_STATE_SLAVE) && (nextState != RADIO_STATE_MASTER))) {
+        return;
+    }
+
+    uint16_t lead = 0;
+    for (uint8_t i = 0; i < jitCount; i++) {
+        if (jitWork[i].leadUs > lead) {
+            lead = jitWork[i].leadUs;
+        }
+    }
+
+    int32_t delay = SYST_TO_US((int32_t)(nextStateSysTime - HAL_VTimerGetCurrentTime_sysT32())) - lead;
+    if (delay < BLE_RADIO_JIT_MIN_DELAY_US) {
+        /* Reported too late, wait for the next one */
+        stats.jitMissed++;
+        return;
+    }
+
+    leadDeadline = us_ticker_read() + delay;
+    leadArmed    = true;
+    leadTimer.attach_us(callback(this, &BlueNRG1_RadioScheduler::onLeadTimeout), delay);
+}
+
+/* Timeout interrupt: the works run from processEvents() */
+void BlueNRG1_RadioScheduler::onLeadTimeout(void)
+{
+    leadExpired = true;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+void BlueNRG1_RadioScheduler::runJitWork(void)
+{
+    Work_t  works[BLE_RADIO_JIT_CALLBACKS];
+    uint8_t count = jitCount;
+    int32_t late  = (int32_t)(us_ticker_read() - leadDeadline);
+
+    if ((late > 0) && ((uint32_t)late > stats.jitLateUs)) {
+        stats.jitLateUs = late;
+    }
+
+    /* The works may ask for the next event again */
+    for (uint8_t i = 0; i < count; i++) {
+        works[i] = jitWork[i].work;
+    }
+    jitCount  = 0;
+    leadArmed = false;
+
+    for (uint8_t i = 0; i < count; i++) {
+        works[i]();
+        stats.jitRun++;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run the waiting works that fit before the next radio activity,
+            or that waited BLE_RADIO_IDLE_MAX_SKIPS windows
+*/
+/**************************************************************************/
+void BlueNRG1_RadioScheduler::runIdleWork(void)
+{
+    uint8_t examined = idleCount;   /* Works queued by the ones run wait for the next window */
+    uint8_t i = 0;
+    bool    used = false;
+
+    windowOpen = false;
+
+    while ((examined > 0) && (i < idleCount)) {
+        IdleWork_t *entry = &idleQueue[i];
+        int32_t left = SYST_TO_US((int32_t)(windowEnd - HAL_VTimerGetCurrentTime_sysT32()));
+        bool fits = windowUnbounded || (left >= (int32_t)(entry->durationUs + BLE_RADIO_IDLE_GUARD_US));
+
+        examined--;
+        if (!fits && (++entry->skips <= BLE_RADIO_IDLE_MAX_SKIPS)) {
+            i++;
+            continue;
+        }
+
+        Work_t work = entry->work;
+        idleCount--;
+        for (uint8_t j = i; j < idleCount; j++) {
+            idleQueue[j] = idleQueue[j + 1];
+        }
+
+        work();
+        used = true;
+        if (fits) {
+            stats.idleRun++;
+        } else {
+            stats.idleForced++;
+        }
+    }
+
+    if (used) {
+        stats.idleWindows++;
+    }
+}
+
+void BlueNRG1_RadioScheduler::process(void)
+{
+    if (leadExpired) {
+        leadExpired = false;
+        runJitWork();
+    }
+    if (windowOpen) {
+        runIdleWork();
+    }
+
+    updateMask();
+}
+
+
+extern "C" void aci_hal_end_of_radio_activity_event(uint8_t Last_State,
+                                                    uint8_t Next_State,
+                                                    uint32_t Next_State_SysTime)
+{
+    BLE_EVENT_SCOPE(END_OF_RADIO_ACTIVITY);
+    BLE_TRACE_VS_EVENT(ACI_HAL_END_OF_RADIO_ACTIVITY_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u8(Last_State).u8(Next_State).u16((uint16_t)Next_State_SysTime)
+                                       .u16((uint16_t)(Next_State_SysTime >> 16)));
+
+    BlueNRG1_Gap::getInstance().getRadioScheduler().onRadioActivityEnd(Last_State, Next_State, Next_State_SysTime);
+}
@@ -0,0 +1,133 @@
+#ifndef __BLUENRG1_RADIOSCHEDULER_H__
+#define __BLUENRG1_RADIOSCHEDULER_H__
+
+#ifdef YOTTA_CFG_MBED_OS
+    #include "mbed-drivers/mbed.h"
+#else
+    #include "mbed.h"
+#endif
+#include "ble/blecommon.h"
+
+/* Work waiting for a radio idle window */
+#ifndef BLE_RADIO_IDLE_QUEUE_SIZE
+#define BLE_RADIO_IDLE_QUEUE_SIZE       4
+#endif
+
+/* Margin kept between the end of the work and the next radio activity */
+#ifndef BLE_RADIO_IDLE_GUARD_US
+#define BLE_RADIO_IDLE_GUARD_US         1000
+#endif
+
+/* Windows too short for a work before it runs anyway */
+#ifndef BLE_RADIO_IDLE_MAX_SKIPS
+#define BLE_RADIO_IDLE_MAX_SKIPS        8
+#endif
+
+/* Callbacks waiting for the next connection event */
+#ifndef BLE_RADIO_JIT_CALLBACKS
+#define BLE_RADIO_JIT_CALLBACKS         2
+#endif
+
+/* Shortest delay the lead timer is armed with, below it the event is missed */
+#define BLE_RADIO_JIT_MIN_DELAY_US      100
+
+/* aci_hal_set_radio_activity_mask() bits */
+#define BLE_RADIO_ACTIVITY_ADVERTISING  0x0002
+#define BLE_RADIO_ACTIVITY_SLAVE        0x0004
+#define BLE_RADIO_ACTIVITY_SCANNING     0x0008
+#define BLE_RADIO_ACTIVITY_CONN_REQUEST 0x0010
+#define BLE_RADIO_ACTIVITY_MASTER       0x0020
+
+/**************************************************************************/
+/*!
+    \brief
+    Application work placed around the radio activity.
+
+    aci_hal_end_of_radio_activity_event reports the end of every radio
+    activity with the sysT32 time of the next one; it is only enabled,
+    with aci_hal_set_radio_activity_mask(), while work is waiting.
+
+    callWhenRadioIdle() parks EventQueue work until a window leaves its
+    duration plus BLE_RADIO_IDLE_GUARD_US before the next activity, so it
+    does not overlap a connection event. With nothing scheduled on the
+    radio it runs at once; skipped by BLE_RADIO_IDLE_MAX_SKIPS windows, it
+    runs in the next one anyway.
+
+    callBeforeConnectionEvent() runs a work once, lead microseconds before
+    the next connection event of any link, for a sample taken just before
+    it goes on air. All the stack virtual timers are in use, the lead is
+    timed with a Timeout on the us ticker, which runs in every sleep state
+    of this target. The works run from processEvents(), the lead must
+    cover the EventQueue latency and the work itself.
+*/
+/**************************************************************************/
+class BlueNRG1_RadioScheduler
+{
+public:
+    typedef mbed::Callback<void()> Work_t;
+
+    typedef struct {
+        uint32_t idleWindows;     /**< Radio events that ran idle work. */
+        uint32_t idleRun;         /**< Works run in a window. */
+        uint32_t idleForced;      /**< Works run after BLE_RADIO_IDLE_MAX_SKIPS windows. */
+        uint32_t jitRun;          /**< Works run before a connection event. */
+        uint32_t jitMissed;       /**< Connection events reported too late for the lead. */
+        uint32_t jitLateUs;       /**< Worst delay of a work after its lead timer. */
+    } Stats_t;
+
+    BlueNRG1_RadioScheduler();
+
+    /* BLE_ERROR_NO_MEM when BLE_RADIO_IDLE_QUEUE_SIZE works are waiting */
+    ble_error_t callWhenRadioIdle(Work_t work, uint16_t durationUs);
+    /* BLE_ERROR_NO_MEM when BLE_RADIO_JIT_CALLBACKS works are waiting */
+    ble_error_t callBeforeConnectionEvent(Work_t work, uint16_t leadUs);
+    void        cancel(void);
+
+    const Stats_t &getStats(void) const {
+        return stats;
+    }
+
+    /* A link connected or disconnected: drop the connection event works with the last link */
+    void        onLinksChanged(void);
+    /* Entry point for aci_hal_end_of_radio_activity_event */
+    void        onRadioActivityEnd(uint8_t lastState, uint8_t nextState, uint32_t nextStateSysTime);
+    /* Called by processEvents() after BTLE_StackTick() */
+    void        process(void);
+
+private:
+    typedef struct {
+        Work_t   work;
+        uint16_t durationUs;
+        uint8_t  skips;
+    } IdleWork_t;
+
+    typedef struct {
+        Work_t   work;
+        uint16_t leadUs;
+    } JitWork_t;
+
+    bool        radioIdle(void);
+    void        updateMask(void);
+    void        runIdleWork(void);
+    void        runJitWork(void);
+    void        onLeadTimeout(void);
+
+    IdleWork_t  idleQueue[BLE_RADIO_IDLE_QUEUE_SIZE];
+    uint8_t     idleCount;
+    JitWork_t   jitWork[BLE_RADIO_JIT_CALLBACKS];
+    uint8_t     jitCount;
+
+    uint16_t    mask;                /**< Mask given to the stack. */
+    bool        windowOpen;          /**< A radio event waits for process(). */
+    bool        windowUnbounded;     /**< Nothing scheduled after it. */
+    uint32_t    windowEnd;           /**< sysT32 start of the next radio activity. */
+
+    Timeout     leadTimer;
+    bool        leadArmed;
+    volatile bool leadExpired;
+    uint32_t    leadDeadline;        /**< us_ticker_read() time the lead timer expires. */
+
+    Stats_t     stats;
+};
+
+#endif //__BLUENRG1_RADIOSCHEDULER_H__
@@ -0,0 +1,613 @@
+#include "BlueNRG1_SecurityManager.h"
+#include "BlueNRG1_Events.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_Links.h"
+#include "BlueNRG1_Trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_const.h"
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_events.h"
+#include "link_layer.h"
+#include "sm.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* Identity address given to the peers: the public address, which the device also
+   advertises with unless BLE_PRIVACY makes the controller use resolvable private ones */
+#define SM_IDENTITY_PUBLIC      0x00
+
+/* Security levels of aci_gap_get_security_level() in mode 1 */
+#define SM_LEVEL_AUTHENTICATED  3
+
+/* Highest SMP pairing failed reason with a SecurityCompletionStatus_t */
+#define SM_REASON_INVALID_PARAMS    0x0A
+
+static uint8_t toStackAddrType(BLEProtocol::AddressType_t type)
+{
+    return (type == BLEProtocol::AddressType::PUBLIC) ? PUBLIC_ADDR : RANDOM_ADDR;
+}
+
+BlueNRG1_SecurityManager::BlueNRG1_SecurityManager() :
+    SecurityManager(),
+    initialized(false),
+    bonding(false),
+    mitm(false),
+    ioCaps(IO_CAPS_NONE),
+    fixedPin(false),
+    resolvingListStale(true),
+    lastPeerValid(false),
+    lastPeerAddrType(BLEProtocol::AddressType::PUBLIC)
+{
+    memset(lastPeerAddr, 0, sizeof(lastPeerAddr));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Give the IO capabilities and the authentication requirements
+            to the stack
+
+    @param[in]  passkey  Six ASCII digits used for every pairing, NULL to
+                         draw one for each pairing
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_SecurityManager::init(bool enableBonding, bool requireMITM,
+                                           SecurityIOCapabilities_t iocaps, const Passkey_t passkey)
+{
+    uint32_t pin = 0;
+    tBleStatus ret;
+
+    if (passkey != NULL) {
+        for (uint8_t i = 0; i < PASSKEY_LEN; i++) {
+            if ((passkey[i] < '0') || (passkey[i] > '9')) {
+                return BLE_ERROR_INVALID_PARAM;
+            }
+            pin = (pin * 10) + (passkey[i] - '0');
+        }
+    }
+
+    /* SecurityIOCapabilities_t follows the SMP IO capabilities */
+    ret = BLE_TRACE_COMMAND(ACI_GAP_SET_IO_CAPABILITY_OPCODE, BLE_TRACE_PARAMS.u8((uint8_t)iocaps),
+                            aci_gap_set_io_capability((uint8_t)iocaps));
+    if (ret == BLE_STATUS_SUCCESS) {
+        uint8_t bondingMode = enableBonding ? BONDING : NO_BONDING;
+        uint8_t mitmMode    = requireMITM ? MITM_PROTECTION_REQUIRED : MITM_PROTECTION_NOT_REQUIRED;
+        uint8_t pinMode     = (passkey != NULL) ? USE_FIXED_PIN_FOR_PAIRING : DONOT_USE_FIXED_PIN_FOR_PAIRING;
+
+        ret = BLE_TRACE_COMMAND(ACI_GAP_SET_AUTHENTICATION_REQUIREMENT_OPCODE,
+                                BLE_TRACE_PARAMS.u8(bondingMode).u8(mitmMode).u8(BLE_SM_SECURE_CONNECTIONS)
+                                                .u8(KEYPRESS_IS_NOT_SUPPORTED).u8(BLE_SM_MIN_KEY_SIZE)
+                                                .u8(BLE_SM_MAX_KEY_SIZE).u8(pinMode).u32(pin)
+                                                .u8(SM_IDENTITY_PUBLIC),
+                                aci_gap_set_authentication_requirement(bondingMode, mitmMode, BLE_SM_SECURE_CONNECTIONS,
+                                                                       KEYPRESS_IS_NOT_SUPPORTED,
+                                                                       BLE_SM_MIN_KEY_SIZE, BLE_SM_MAX_KEY_SIZE,
+                                                                       pinMode, pin, SM_IDENTITY_PUBLIC));
+    }
+#if BLE_PRIVACY
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = BLE_TRACE_COMMAND(HCI_LE_SET_RESOLVABLE_PRIVATE_ADDRESS_TIMEOUT_OPCODE,
+                                BLE_TRACE_PARAMS.u16(BLE_RPA_TIMEOUT_S),
+                                hci_le_set_resolvable_private_address_timeout(BLE_RPA_TIMEOUT_S));
+    }
+#endif
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    initialized = true;
+    bonding     = enableBonding;
+    mitm        = requireMITM;
+    ioCaps      = iocaps;
+    fixedPin    = (passkey != NULL);
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t BlueNRG1_SecurityManager::getLinkSecurity(Gap::Handle_t connectionHandle,
+                                                      LinkSecurityStatus_t *securityStatusP)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connectionHandle);
+
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    *securityStatusP = (LinkSecurityStatus_t)link->security;
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start the pairing, or the encryption with a bonded peer, when
+            the link is below securityMode
+
+    As peripheral a slave security request is sent, as central the
+    pairing request. Signing is not supported: the SIGNED modes ask for
+    the encryption with or without MITM protection instead.
+
+    @returns    BLE_ERROR_OPERATION_NOT_PERMITTED when MITM protection is
+                asked for and init() did not require it
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_SecurityManager::setLinkSecurity(Gap::Handle_t connectionHandle, SecurityMode_t securityMode)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connectionHandle);
+    bool withMitm = (securityMode == SECURITY_MODE_ENCRYPTION_WITH_MITM) ||
+                    (securityMode == SECURITY_MODE_SIGNED_WITH_MITM);
+    tBleStatus ret;
+
+    if (!initialized) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (withMitm && !mitm) {
+        return BLE_ERROR_OPERATION_NOT_PERMITTED;
+    }
+    if ((securityMode == SECURITY_MODE_NO_ACCESS) || (securityMode == SECURITY_MODE_ENCRYPTION_OPEN_LINK) ||
+        (link->security == ENCRYPTION_IN_PROGRESS)) {
+        return BLE_ERROR_NONE;
+    }
+    if ((link->security == ENCRYPTED) && (!withMitm || (link->securityMode == SECURITY_MODE_ENCRYPTION_WITH_MITM))) {
+        return BLE_ERROR_NONE;
+    }
+
+    if (link->role == Gap::PERIPHERAL) {
+        ret = BLE_TRACE_COMMAND(ACI_GAP_SLAVE_SECURITY_REQ_OPCODE, BLE_TRACE_PARAMS.u16(connectionHandle),
+                                aci_gap_slave_security_req(connectionHandle));
+    } else {
+        ret = BLE_TRACE_COMMAND(ACI_GAP_SEND_PAIRING_REQ_OPCODE, BLE_TRACE_PARAMS.u16(connectionHandle).u8(0),
+                                aci_gap_send_pairing_req(connectionHandle, 0));
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    link->security = ENCRYPTION_IN_PROGRESS;
+    processSecuritySetupInitiatedEvent(connectionHandle, bonding, mitm, ioCaps);
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Answer the Numeric Comparison of a pairing, once the user
+            compared the value given to onPasskeyDisplay with the one of
+            the peer
+
+    @returns    BLE_ERROR_INVALID_STATE when the link waits for no answer,
+                after the SMP timeout too
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_SecurityManager::confirmNumericComparison(Gap::Handle_t connectionHandle, bool match)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(connectionHandle);
+    uint8_t confirm = match ? 1 : 0;
+    tBleStatus ret;
+
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (!link->comparePending) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    ret = BLE_TRACE_COMMAND(ACI_GAP_NUMERIC_COMPARISON_VALUE_CONFIRM_YESNO_OPCODE,
+                            BLE_TRACE_PARAMS.u16(connectionHandle).u8(confirm),
+                            aci_gap_numeric_comparison_value_confirm_yesno(connectionHandle, confirm));
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    link->comparePending = false;
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Erase the security database of the stack, and the bonded peers
+            from the controller whitelist; the resolving list follows on the
+            next whitelistBondedPeers()
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_SecurityManager::purgeAllBondingState(void)
+{
+    tBleStatus ret;
+
+    ret = BLE_TRACE_COMMAND(ACI_GAP_CLEAR_SECURITY_DB_OPCODE, BLE_TRACE_PARAMS, aci_gap_clear_security_db());
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = BLE_TRACE_COMMAND(HCI_LE_CLEAR_WHITE_LIST_OPCODE, BLE_TRACE_PARAMS, hci_le_clear_white_list());
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    lastPeerValid      = false;
+    resolvingListStale = true;
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Identity addresses of the bonded peers, at most
+            addresses.capacity of them
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_SecurityManager::getAddressesFromBondTable(Gap::Whitelist_t &addresses) const
+{
+    Bonded_Device_Entry_t entries[BLE_SM_MAX_BONDED_DEVICES];
+    uint8_t count = 0;
+    tBleStatus ret;
+
+    ret = BLE_TRACE_COMMAND(ACI_GAP_GET_BONDED_DEVICES_OPCODE, BLE_TRACE_PARAMS,
+                            aci_gap_get_bonded_devices(&count, entries));
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    addresses.size = 0;
+    for (uint8_t i = 0; (i < count) && (i < BLE_SM_MAX_BONDED_DEVICES) && (addresses.size < addresses.capacity); i++) {
+        BLEProtocol::Address_t *address = &addresses.addresses[addresses.size++];
+        address->type = (entries[i].Address_Type == PUBLIC_ADDR) ? BLEProtocol::AddressType::PUBLIC
+                                                                 : BLEProtocol::AddressType::RANDOM_STATIC;
+        memcpy(address->address, entries[i].Address, sizeof(address->address));
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Give the identities of the bonded peers to the resolving list
+            of the controller and enable the address resolution
+
+    The stack takes the IRKs from its security database: the host never
+    sees them, hci_le_add_device_to_resolving_list() is not usable here.
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_SecurityManager::loadResolvingList(void)
+{
+#if BLE_PRIVACY
+    Bonded_Device_Entry_t      bonded[BLE_SM_MAX_BONDED_DEVICES];
+    Whitelist_Identity_Entry_t identities[BLE_SM_MAX_BONDED_DEVICES];
+    uint8_t count = 0;
+    tBleStatus ret;
+
+    /* The list only changes with the address resolution disabled */
+    ret = BLE_TRACE_COMMAND(HCI_LE_SET_ADDRESS_RESOLUTION_ENABLE_OPCODE, BLE_TRACE_PARAMS.u8(0),
+                            hci_le_set_address_resolution_enable(0));
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = BLE_TRACE_COMMAND(ACI_GAP_GET_BONDED_DEVICES_OPCODE, BLE_TRACE_PARAMS,
+                                aci_gap_get_bonded_devices(&count, bonded));
+    }
+    if (ret == BLE_STATUS_SUCCESS) {
+        if (count > BLE_SM_MAX_BONDED_DEVICES) {
+            count = BLE_SM_MAX_BONDED_DEVICES;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            identities[i].Peer_Identity_Address_Type = bonded[i].Address_Type;
+            memcpy(identities[i].Peer_Identity_Address, bonded[i].Address, BDADDR_SIZE);
+        }
+
+        if (count == 0) {
+            ret = BLE_TRACE_COMMAND(HCI_LE_CLEAR_RESOLVING_LIST_OPCODE, BLE_TRACE_PARAMS,
+                                    hci_le_clear_resolving_list());
+        } else {
+            ret = BLE_TRACE_COMMAND(ACI_GAP_ADD_DEVICES_TO_RESOLVING_LIST_OPCODE,
+                                    BLE_TRACE_PARAMS.u8(count)
+                                                    .bytes((const uint8_t *)identities, count * sizeof(identities[0]))
+                                                    .u8(1),
+                                    aci_gap_add_devices_to_resolving_list(count, identities, 1));
+        }
+    }
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = BLE_TRACE_COMMAND(HCI_LE_SET_ADDRESS_RESOLUTION_ENABLE_OPCODE, BLE_TRACE_PARAMS.u8(1),
+                                hci_le_set_address_resolution_enable(1));
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+#endif
+
+    resolvingListStale = false;
+
+    return BLE_ERROR_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Replace the controller whitelist by the bonded peers, for
+            Gap::ADV_POLICY_FILTER_CONN_REQS advertising, after reloading
+            the resolving list when the bonds changed
+
+    @returns    BLE_ERROR_INVALID_STATE when no peer is bonded
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_SecurityManager::whitelistBondedPeers(void)
+{
+    BLEProtocol::Address_t first;
+    Gap::Whitelist_t       bonded = { &first, 0, 1 };
+    tBleStatus ret;
+
+    if (resolvingListStale) {
+        ble_error_t error = loadResolvingList();
+        if (error != BLE_ERROR_NONE) {
+            return error;
+        }
+    }
+
+    ble_error_t error = getAddressesFromBondTable(bonded);
+    if (error != BLE_ERROR_NONE) {
+        return error;
+    }
+    if (bonded.size == 0) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    ret = BLE_TRACE_COMMAND(HCI_LE_CLEAR_WHITE_LIST_OPCODE, BLE_TRACE_PARAMS, hci_le_clear_white_list());
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = BLE_TRACE_COMMAND(ACI_GAP_CONFIGURE_WHITELIST_OPCODE, BLE_TRACE_PARAMS, aci_gap_configure_whitelist());
+    }
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BlueNRG1_ble::bleStatusToError(ret);
+}
+
+/* Peers using resolvable private addresses are recognised once in the resolving list, by their identity */
+bool BlueNRG1_SecurityManager::isBonded(BLEProtocol::AddressType_t peerAddrType,
+                                        const BLEProtocol::AddressBytes_t peerAddr) const
+{
+    uint8_t addr[BLEProtocol::ADDR_LEN];
+
+    if ((peerAddrType != BLEProtocol::AddressType::PUBLIC) &&
+        (peerAddrType != BLEProtocol::AddressType::RANDOM_STATIC)) {
+        return false;
+    }
+
+    memcpy(addr, peerAddr, sizeof(addr));
+    return (BLE_TRACE_COMMAND(ACI_GAP_IS_DEVICE_BONDED_OPCODE,
+                              BLE_TRACE_PARAMS.u8(toStackAddrType(peerAddrType)).bytes(addr, sizeof(addr)),
+                              aci_gap_is_device_bonded(toStackAddrType(peerAddrType), addr)) == BLE_STATUS_SUCCESS);
+}
+
+bool BlueNRG1_SecurityManager::getLastBondedPeer(BLEProtocol::AddressType_t *peerAddrType,
+                                                 BLEProtocol::AddressBytes_t peerAddr) const
+{
+    if (!lastPeerValid) {
+        return false;
+    }
+
+    *peerAddrType = lastPeerAddrType;
+    memcpy(peerAddr, lastPeerAddr, sizeof(lastPeerAddr));
+
+    return true;
+}
+
+void BlueNRG1_SecurityManager::onDisconnection(Gap::Handle_t handle)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if ((link == NULL) || (link->role != Gap::PERIPHERAL)) {
+        return;
+    }
+
+    lastPeerValid = isBonded(link->peerAddrType, link->peerAddr);
+    if (lastPeerValid) {
+        lastPeerAddrType = link->peerAddrType;
+        memcpy(lastPeerAddr, link->peerAddr, sizeof(lastPeerAddr));
+    }
+}
+
+/* Encryption enabled, with or without MITM protection depending on the keys used */
+void BlueNRG1_SecurityManager::linkSecured(Gap::Handle_t handle)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+    uint8_t mode  = 0;
+    uint8_t level = 0;
+
+    if (link == NULL) {
+        return;
+    }
+
+    BLE_TRACE_COMMAND(ACI_GAP_GET_SECURITY_LEVEL_OPCODE, BLE_TRACE_PARAMS.u16(handle),
+                      aci_gap_get_security_level(handle, &mode, &level));
+    link->security     = ENCRYPTED;
+    link->securityMode = (level >= SM_LEVEL_AUTHENTICATED) ? SECURITY_MODE_ENCRYPTION_WITH_MITM
+                                                           : SECURITY_MODE_ENCRYPTION_NO_MITM;
+
+    processLinkSecuredEvent(handle, (SecurityMode_t)link->securityMode);
+}
+
+void BlueNRG1_SecurityManager::onEncryptionChange(uint8_t status, Gap::Handle_t handle, uint8_t enabled)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link == NULL) {
+        return;
+    }
+
+    if ((status == BLE_STATUS_SUCCESS) && enabled) {
+        linkSecured(handle);
+    } else {
+        link->security     = NOT_ENCRYPTED;
+        link->securityMode = SECURITY_MODE_ENCRYPTION_OPEN_LINK;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  End of a pairing: the link was encrypted by then, the keys of
+            a bonded peer are in the security database
+*/
+/**************************************************************************/
+void BlueNRG1_SecurityManager::onPairingComplete(Gap::Handle_t handle, uint8_t status, uint8_t reason)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+    SecurityCompletionStatus_t result;
+
+    if (status == SM_PAIRING_SUCCESS) {
+        result = SEC_STATUS_SUCCESS;
+    } else if (status == SM_PAIRING_TIMEOUT) {
+        result = SEC_STATUS_TIMEOUT;
+    } else if ((reason > 0) && (reason <= SM_REASON_INVALID_PARAMS)) {
+        /* SecurityCompletionStatus_t is the SMP reason with bit 7 set */
+        result = (SecurityCompletionStatus_t)(0x80 | reason);
+    } else {
+        result = SEC_STATUS_UNSPECIFIED;
+    }
+
+    if (link != NULL) {
+        link->comparePending = false;
+        if (result == SEC_STATUS_SUCCESS) {
+            if (link->security != ENCRYPTED) {
+                linkSecured(handle);
+            }
+        } else {
+            link->security = NOT_ENCRYPTED;
+        }
+    }
+
+    processSecuritySetupCompletedEvent(handle, result);
+    if ((result == SEC_STATUS_SUCCESS) && bonding) {
+        resolvingListStale = true;
+        processSecurityContextStoredEvent(handle);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  The pairing needs a passkey and none was given to init(): draw
+            one and show it through onPasskeyDisplay
+
+    Without a random number the link is closed rather than paired with a
+    passkey anybody could guess.
+*/
+/**************************************************************************/
+void BlueNRG1_SecurityManager::onPasskeyRequest(Gap::Handle_t handle)
+{
+    uint8_t   random[8];
+    uint32_t  pin;
+    Passkey_t passkey;
+
+    if (BLE_TRACE_COMMAND(HCI_LE_RAND_OPCODE, BLE_TRACE_PARAMS, hci_le_rand(random)) != BLE_STATUS_SUCCESS) {
+        BLE_TRACE_COMMAND(ACI_GAP_TERMINATE_OPCODE, BLE_TRACE_PARAMS.u16(handle).u8(HCI_AUTHENTICATION_FAILURE),
+                          aci_gap_terminate(handle, HCI_AUTHENTICATION_FAILURE));
+        BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+        return;
+    }
+    pin = ((uint32_t)random[0] | ((uint32_t)random[1] << 8) | ((uint32_t)random[2] << 16) |
+           ((uint32_t)random[3] << 24)) % 1000000;
+
+    BLE_TRACE_COMMAND(ACI_GAP_PASS_KEY_RESP_OPCODE, BLE_TRACE_PARAMS.u16(handle).u32(pin),
+                      aci_gap_pass_key_resp(handle, pin));
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    for (int8_t i = PASSKEY_LEN - 1; i >= 0; i--) {
+        passkey[i] = (uint8_t)('0' + (pin % 10));
+        pin /= 10;
+    }
+    processPasskeyDisplayEvent(handle, passkey);
+}
+
+/* Show the 6 digits of a Numeric Comparison, confirmNumericComparison() gives the answer */
+void BlueNRG1_SecurityManager::onNumericComparison(Gap::Handle_t handle, uint32_t value)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+    Passkey_t passkey;
+
+    if (link == NULL) {
+        return;
+    }
+    link->comparePending = true;
+
+    for (int8_t i = PASSKEY_LEN - 1; i >= 0; i--) {
+        passkey[i] = (uint8_t)('0' + (value % 10));
+        value /= 10;
+    }
+    processPasskeyDisplayEvent(handle, passkey);
+}
+
+/**************************************************************************/
+/*!
+    @brief  A central bonded before lost its keys and answered our slave
+            security request with a pairing request: pair again
+*/
+/**************************************************************************/
+void BlueNRG1_SecurityManager::onBondLost(void)
+{
+    BlueNRG1_Links &links = BlueNRG1_Links::getInstance();
+
+    /* The event does not tell the link, it is the one waiting for its security request */
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        BlueNRG1_Link_t *link = links.at(i);
+        if (link->connected && (link->role == Gap::PERIPHERAL) && (link->security == ENCRYPTION_IN_PROGRESS)) {
+            BLE_TRACE_COMMAND(ACI_GAP_ALLOW_REBOND_OPCODE, BLE_TRACE_PARAMS.u16(link->handle),
+                              aci_gap_allow_rebond(link->handle));
+            BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+            return;
+        }
+    }
+}
+
+
+extern "C" void aci_gap_pairing_complete_event(uint16_t Connection_Handle,
+                                               uint8_t Status,
+                                               uint8_t Reason)
+{
+    BLE_EVENT_SCOPE(PAIRING_COMPLETE);
+    BLE_TRACE_VS_EVENT(ACI_GAP_PAIRING_COMPLETE_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u8(Status).u8(Reason));
+
+    BlueNRG1_SecurityManager::getInstance().onPairingComplete(Connection_Handle, Status, Reason);
+}
+
+extern "C" void aci_gap_pass_key_req_event(uint16_t Connection_Handle)
+{
+    BLE_EVENT_SCOPE(PASS_KEY_REQ);
+    BLE_TRACE_VS_EVENT(ACI_GAP_PASS_KEY_REQ_VSEVT_CODE, BLE_TRACE_PARAMS.u16(Connection_Handle));
+
+    BlueNRG1_SecurityManager::getInstance().onPasskeyRequest(Connection_Handle);
+}
+
+extern "C" void aci_gap_numeric_comparison_value_event(uint16_t Connection_Handle,
+                                                       uint32_t Numeric_Value)
+{
+    BLE_EVENT_SCOPE(NUMERIC_COMPARISON_VALUE);
+    BLE_TRACE_VS_EVENT(ACI_GAP_NUMERIC_COMPARISON_VALUE_VSEVT_CODE,
+                       BLE_TRACE_PARAMS.u16(Connection_Handle).u32(Numeric_Value));
+
+    BlueNRG1_SecurityManager::getInstance().onNumericComparison(Connection_Handle, Numeric_Value);
+}
+
+extern "C" void aci_gap_bond_lost_event(void)
+{
+    BLE_EVENT_SCOPE(BOND_LOST);
+    BLE_TRACE_VS_EVENT(ACI_GAP_BOND_LOST_VSEVT_CODE, BLE_TRACE_PARAMS);
+
+    BlueNRG1_SecurityManager::getInstance().onBondLost();
+}
+
+extern "C" void hci_encryption_change_event(uint8_t Status,
+                                            uint16_t Connection_Handle,
+                                            uint8_t Encryption_Enabled)
+{
+    BLE_EVENT_SCOPE(ENCRYPTION_CHANGE);
+    BLE_TRACE_EVENT(HCI_EVT_ENCRYPTION_CHANGE, BLE_TRACE_PARAMS.u8(Status).u16(Connection_Handle).u8(Encryption_Enabled));
+
+    BlueNRG1_SecurityManager::getInstance().onEncryptionChange(Status, Connection_Handle, Encryption_Enabled);
+}
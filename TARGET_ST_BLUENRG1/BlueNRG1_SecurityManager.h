@@ -3,12 +3,129 @@
 
 #include <stddef.h>
 
-//#include "nRF5xGap.h"
 #include "ble/SecurityManager.h"
-//#include "btle_security.h"
 
+/* Entries aci_gap_get_bonded_devices() may return */
+#ifndef BLE_SM_MAX_BONDED_DEVICES
+#define BLE_SM_MAX_BONDED_DEVICES   8
+#endif
+
+/* Encryption key size negotiated during pairing, bytes [7:16] */
+#ifndef BLE_SM_MIN_KEY_SIZE
+#define BLE_SM_MIN_KEY_SIZE         7
+#endif
+#define BLE_SM_MAX_KEY_SIZE         16
+
+/* LE Secure Connections: 0 legacy pairing only, 1 when the peer supports
+   them, 2 mandatory (SC_IS_xxx of sm.h) */
+#ifndef BLE_SM_SECURE_CONNECTIONS
+#define BLE_SM_SECURE_CONNECTIONS   1
+#endif
+
+/* Controller privacy: the device advertises with a resolvable private
+   address and the controller resolves the addresses of the bonded peers */
+#ifndef BLE_PRIVACY
+#define BLE_PRIVACY                 1
+#endif
+
+/* Lifetime of our resolvable private address, s [1:41400] */
+#ifndef BLE_RPA_TIMEOUT_S
+#define BLE_RPA_TIMEOUT_S           900
+#endif
+
+/**************************************************************************/
+/*!
+    \brief
+    Pairing and bonding on the security manager of the stack.
+
+    The keys of the bonded peers are kept by the stack in its security
+    database, in the flash area given to BlueNRG_Stack_Initialization(),
+    so they survive a reset; this class keeps no copy of them.
+
+    As peripheral, setLinkSecurity() sends a slave security request, the
+    central starts the pairing, or encrypts the link at once when it is
+    already bonded. A central that lost its keys answers with a pairing
+    request: the stack reports aci_gap_bond_lost_event and the bond is
+    renewed. Without passkey given to init(), one is drawn for every
+    pairing and given to the onPasskeyDisplay callback.
+
+    LE Secure Connections compute the P-256 key pair and the DH key on
+    the PKA. The stack starts each computation and collects its result
+    from BTLE_StackTick(), scheduled by the PKA interrupt, so the
+    EventQueue keeps dispatching meanwhile. The Numeric Comparison value
+    goes to onPasskeyDisplay and the pairing waits for the application to
+    compare it with the peer and answer confirmNumericComparison(): the
+    link only gets MITM protection from a value somebody confirmed, the
+    stack fails the pairing when no answer comes within the SMP timeout.
+
+    For a fast reconnection the peer of the last link that went down is
+    remembered when it is bonded, to be called back with
+    BlueNRG1_Gap::startDirectedAdvertising(); whitelistBondedPeers() lets
+    all the bonded peers in with the advertising policy mode.
+
+    With BLE_PRIVACY the identities of the bonded peers also go to the
+    resolving list of the controller, which resolves the private addresses
+    of their advertising and connection requests: the links and the
+    whitelist only see identity addresses and the host resolves nothing.
+    The list cannot change while advertising or scanning, it is reloaded
+    by whitelistBondedPeers() after a new bond or a purge.
+*/
+/**************************************************************************/
 class BlueNRG1_SecurityManager : public SecurityManager
 {
+public:
+    static BlueNRG1_SecurityManager &getInstance() {
+        static BlueNRG1_SecurityManager m_instance;
+        return m_instance;
+    }
+
+    virtual ble_error_t init(bool                     enableBonding = true,
+                             bool                     requireMITM   = true,
+                             SecurityIOCapabilities_t iocaps        = IO_CAPS_NONE,
+                             const Passkey_t          passkey       = NULL);
+    virtual ble_error_t getLinkSecurity(Gap::Handle_t connectionHandle, LinkSecurityStatus_t *securityStatusP);
+    virtual ble_error_t setLinkSecurity(Gap::Handle_t connectionHandle, SecurityMode_t securityMode);
+    virtual ble_error_t purgeAllBondingState(void);
+    virtual ble_error_t getAddressesFromBondTable(Gap::Whitelist_t &addresses) const;
+
+    /* Answer to the Numeric Comparison value given to onPasskeyDisplay, within 30 s */
+    ble_error_t confirmNumericComparison(Gap::Handle_t connectionHandle, bool match);
+
+    /* BLE_ERROR_INVALID_STATE when no peer is bonded, to call while not advertising */
+    ble_error_t whitelistBondedPeers(void);
+    bool        isBonded(BLEProtocol::AddressType_t peerAddrType, const BLEProtocol::AddressBytes_t peerAddr) const;
+    /* Bonded peer of the last link that went down, false when it was not bonded */
+    bool        getLastBondedPeer(BLEProtocol::AddressType_t *peerAddrType, BLEProtocol::AddressBytes_t peerAddr) const;
+
+    /* Called by BlueNRG1_Gap before the link is removed */
+    void        onDisconnection(Gap::Handle_t handle);
+    /* Entry point for aci_gap_pairing_complete_event */
+    void        onPairingComplete(Gap::Handle_t handle, uint8_t status, uint8_t reason);
+    /* Entry point for aci_gap_pass_key_req_event */
+    void        onPasskeyRequest(Gap::Handle_t handle);
+    /* Entry point for aci_gap_numeric_comparison_value_event */
+    void        onNumericComparison(Gap::Handle_t handle, uint32_t value);
+    /* Entry point for aci_gap_bond_lost_event */
+    void        onBondLost(void);
+    /* Entry point for hci_encryption_change_event */
+    void        onEncryptionChange(uint8_t status, Gap::Handle_t handle, uint8_t enabled);
+
+private:
+    BlueNRG1_SecurityManager();
+
+    void        linkSecured(Gap::Handle_t handle);
+    ble_error_t loadResolvingList(void);
+
+    bool                     initialized;
+    bool                     bonding;
+    bool                     mitm;
+    SecurityIOCapabilities_t ioCaps;
+    bool                     fixedPin;      /**< The stack answers with the passkey of init(). */
+    bool                     resolvingListStale; /**< The bonds changed since the last loadResolvingList(). */
+
+    bool                        lastPeerValid;
+    BLEProtocol::AddressType_t  lastPeerAddrType;
+    BLEProtocol::AddressBytes_t lastPeerAddr;
 };
 
-#endif //__BLUENRG1_SECURITY_MANAGER_H__
\ No newline at end of file
+#endif //__BLUENRG1_SECURITY_MANAGER_H__
@@ -0,0 +1,53 @@
+#ifndef __BLUENRG1_STATS_H__
+#define __BLUENRG1_STATS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Use of the RAM btle.h reserves for the stack in dyn_alloc_a, next to
+ * mbed_stats_heap_get(): each *_size is what TOTAL_BUFFER_SIZE() was
+ * computed with, compare it with the use and the high-water mark.
+ *
+ * The stack does not report its packet pool: the blocks in use are
+ * estimated from the updates the GATT server sent, one block per link
+ * layer packet of the ATT PDU, until the controller reports them sent.
+ * Once an update was refused for lack of blocks, packet_max is the
+ * whole pool.
+ */
+typedef struct {
+    uint32_t reserved_size;       /**< Bytes of dyn_alloc_a. */
+    uint16_t packet_size;         /**< Packet blocks, PCKT_COUNT. */
+    uint16_t packet_used;         /**< Blocks held by the updates in flight. */
+    uint16_t packet_max;          /**< Most blocks held at once. */
+    uint32_t packet_fail_cnt;     /**< Updates refused with BLE_STATUS_INSUFFICIENT_RESOURCES. */
+    uint16_t prepare_write_size;  /**< Prepare write entries, PREPARE_WRITE_LIST_SIZE. */
+    uint16_t prepare_write_max;   /**< Entries the longest write received needed. */
+    uint16_t att_value_size;      /**< Bytes of ATT_VALUE_ARRAY_SIZE. */
+    uint16_t att_value_used;      /**< Bytes of the GAP, GATT and application services added. */
+    uint16_t attr_size;           /**< Attribute records, NUM_GATT_ATTRIBUTES. */
+    uint16_t attr_used;
+    uint16_t service_size;        /**< Services, NUM_GATT_SERVICES. */
+    uint16_t service_used;
+} bluenrg1_stats_ble_t;
+
+/**
+ *  Fill the passed in structure with the stack memory stats.
+ *
+ *  @param stats    A pointer to the bluenrg1_stats_ble_t structure to fill
+ */
+void bluenrg1_stats_ble_get(bluenrg1_stats_ble_t *stats);
+
+/**
+ *  Restart packet_max, packet_fail_cnt and prepare_write_max from now.
+ */
+void bluenrg1_stats_ble_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__BLUENRG1_STATS_H__
@@ -0,0 +1,309 @@
+#include "BlueNRG1_Telemetry.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_Trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_stack.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* Links reported by aci_hal_get_link_status() */
+#define TELEMETRY_HAL_LINKS     8
+
+#if BLE_TELEMETRY_SERVICE
+/* Vendor UUIDs of the telemetry service and of its characteristic */
+#define TELEMETRY_SERVICE_UUID  "7b9a0001-3c4e-4d2a-8f61-5e0b2c9d1a47"
+#define TELEMETRY_VALUE_UUID    "7b9a0002-3c4e-4d2a-8f61-5e0b2c9d1a47"
+#endif
+
+BlueNRG1_Telemetry::BlueNRG1_Telemetry() :
+    enabled(true),
+    running(false)
+{
+    memset(&radio, 0, sizeof(radio));
+#if BLE_TELEMETRY_SERVICE
+    serviceValueHandle = 0;
+#endif
+}
+
+void BlueNRG1_Telemetry::enable(bool enable)
+{
+    enabled = enable;
+    onLinksChanged();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Last samples and counters of a link, with min/avg/max of the
+            RSSI samples kept
+
+    @returns    BLE_ERROR_INVALID_PARAM for an unknown link
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Telemetry::getLinkQuality(Gap::Handle_t handle, LinkQuality_t *quality)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    const BlueNRG1_LinkQuality_t *state = &link->quality;
+    int16_t sum = 0;
+
+    quality->rssi    = BLE_TELEMETRY_RSSI_UNKNOWN;
+    quality->rssiMin = BLE_TELEMETRY_RSSI_UNKNOWN;
+    quality->rssiAvg = BLE_TELEMETRY_RSSI_UNKNOWN;
+    quality->rssiMax = BLE_TELEMETRY_RSSI_UNKNOWN;
+    if (state->rssiCount > 0) {
+        quality->rssi    = state->rssi[(state->rssiHead + BLE_LINK_RSSI_SAMPLES - 1) % BLE_LINK_RSSI_SAMPLES];
+        quality->rssiMax = -128;
+        for (uint8_t i = 0; i < state->rssiCount; i++) {
+            int8_t rssi = state->rssi[i];
+            if (rssi < quality->rssiMin) {
+                quality->rssiMin = rssi;
+            }
+            if (rssi > quality->rssiMax) {
+                quality->rssiMax = rssi;
+            }
+            sum += rssi;
+        }
+        quality->rssiAvg = (int8_t)(sum / state->rssiCount);
+    }
+    quality->rssiSamples = state->rssiCount;
+    quality->status      = state->status;
+    memcpy(quality->channelMap, state->channelMap, sizeof(quality->channelMap));
+
+    quality->usedChannels = 0;
+    for (uint8_t i = 0; i < sizeof(state->channelMap); i++) {
+        for (uint8_t bits = state->channelMap[i]; bits != 0; bits &= (uint8_t)(bits - 1)) {
+            quality->usedChannels++;
+        }
+    }
+
+    quality->samples          = state->samples;
+    quality->queued           = state->queued;
+    quality->sent             = state->sent;
+    quality->dropped          = state->dropped;
+    quality->packetsCompleted = state->packetsCompleted;
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_Telemetry::onLinksChanged(void)
+{
+    bool needed = enabled && (BlueNRG1_Links::getInstance().getCount() > 0);
+
+    if (needed && !running) {
+        running = (HAL_VTimerStart_ms(BLUENRG1_VTIMER_TELEMETRY, BLE_TELEMETRY_PERIOD_MS) == 0);
+    } else if (!needed && running) {
+        HAL_VTimer_Stop(BLUENRG1_VTIMER_TELEMETRY);
+        running = false;
+    }
+
+    if (BlueNRG1_Links::getInstance().getCount() == 0) {
+        radio.anchorPeriod = 0;
+        radio.maxFreeSlot  = 0;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the RSSI and the channel map of a link, and pick its
+            state among the ones aci_hal_get_link_status() returned
+*/
+/**************************************************************************/
+void BlueNRG1_Telemetry::sampleLink(BlueNRG1_Link_t *link, const uint8_t status[8], const uint16_t handles[8])
+{
+    BlueNRG1_LinkQuality_t *state = &link->quality;
+    uint8_t rssi;
+
+    if (BLE_TRACE_COMMAND(HCI_READ_RSSI_OPCODE, BLE_TRACE_PARAMS.u16(link->handle),
+                          hci_read_rssi(link->handle, &rssi)) == BLE_STATUS_SUCCESS) {
+        if ((int8_t)rssi != BLE_TELEMETRY_RSSI_UNKNOWN) {
+            state->rssi[state->rssiHead] = (int8_t)rssi;
+            state->rssiHead = (state->rssiHead + 1) % BLE_LINK_RSSI_SAMPLES;
+            if (state->rssiCount < BLE_LINK_RSSI_SAMPLES) {
+                state->rssiCount++;
+            }
+        }
+    }
+
+    BLE_TRACE_COMMAND(HCI_LE_READ_CHANNEL_MAP_OPCODE, BLE_TRACE_PARAMS.u16(link->handle),
+                      hci_le_read_channel_map(link->handle, state->channelMap));
+
+    state->status = LINK_STATUS_IDLE;
+    if (status != NULL) {
+        for (uint8_t i = 0; i < TELEMETRY_HAL_LINKS; i++) {
+            if ((status[i] != LINK_STATUS_IDLE) && (handles[i] == link->handle)) {
+                state->status = status[i];
+                break;
+            }
+        }
+    }
+
+    state->samples++;
+}
+
+void BlueNRG1_Telemetry::sample(void)
+{
+    BlueNRG1_Links &links = BlueNRG1_Links::getInstance();
+    uint8_t  status[TELEMETRY_HAL_LINKS];
+    uint16_t handles[TELEMETRY_HAL_LINKS];
+    bool     statusValid;
+
+    statusValid = (BLE_TRACE_COMMAND(ACI_HAL_GET_LINK_STATUS_OPCODE, BLE_TRACE_PARAMS,
+                                     aci_hal_get_link_status(status, handles)) == BLE_STATUS_SUCCESS);
+
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        BlueNRG1_Link_t *link = links.at(i);
+        if (link->connected) {
+            sampleLink(link, statusValid ? status : NULL, handles);
+        }
+    }
+
+    if (BLE_TRACE_COMMAND(ACI_HAL_GET_ANCHOR_PERIOD_OPCODE, BLE_TRACE_PARAMS,
+                          aci_hal_get_anchor_period(&radio.anchorPeriod, &radio.maxFreeSlot)) != BLE_STATUS_SUCCESS) {
+        radio.anchorPeriod = 0;
+        radio.maxFreeSlot  = 0;
+    }
+
+#if BLE_TELEMETRY_SERVICE
+    updateService();
+#endif
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+void BlueNRG1_Telemetry::onTimeout(void)
+{
+    running = false;
+
+    if (enabled) {
+        sample();
+    }
+
+    onLinksChanged();
+}
+
+void BlueNRG1_Telemetry::onNotificationQueued(Gap::Handle_t handle)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link != NULL) {
+        link->quality.queued++;
+    }
+    radio.queued++;
+}
+
+void BlueNRG1_Telemetry::onNotificationSent(Gap::Handle_t handle)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link != NULL) {
+        link->quality.sent++;
+    }
+    radio.sent++;
+}
+
+/* The link may already be gone when its queued updates are discarded */
+void BlueNRG1_Telemetry::onNotificationDropped(Gap::Handle_t handle, uint8_t count)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link != NULL) {
+        link->quality.dropped += count;
+    }
+    radio.dropped += count;
+}
+
+void BlueNRG1_Telemetry::onPacketsCompleted(Gap::Handle_t handle, uint16_t count)
+{
+    BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().find(handle);
+
+    if (link != NULL) {
+        link->quality.packetsCompleted += count;
+    }
+}
+
+#if BLE_TELEMETRY_SERVICE
+static void putUint32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add the read-only telemetry characteristic, see the class
+            description for its value
+
+    @returns    BLE_ERROR_INVALID_STATE when already added
+*/
+/**************************************************************************/
+ble_error_t BlueNRG1_Telemetry::addService(void)
+{
+    static uint8_t value[BLE_TELEMETRY_SERVICE_VALUE_LEN];
+    static GattCharacteristic valueChar(UUID(TELEMETRY_VALUE_UUID), value, sizeof(value), sizeof(value),
+                                        GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ);
+    static GattCharacteristic *characteristics[] = { &valueChar };
+    static GattService service(UUID(TELEMETRY_SERVICE_UUID), characteristics,
+                               sizeof(characteristics) / sizeof(characteristics[0]));
+    ble_error_t error;
+
+    if (serviceValueHandle != 0) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    error = BlueNRG1_GattServer::getInstance().addService(service);
+    if (error == BLE_ERROR_NONE) {
+        serviceValueHandle = valueChar.getValueHandle();
+        updateService();
+    }
+
+    return error;
+}
+
+void BlueNRG1_Telemetry::updateService(void)
+{
+    uint8_t value[BLE_TELEMETRY_SERVICE_VALUE_LEN];
+    uint8_t *p = value;
+
+    if (serviceValueHandle == 0) {
+        return;
+    }
+
+    memset(value, 0, sizeof(value));
+    putUint32(&p[0], radio.anchorPeriod);
+    putUint32(&p[4], radio.maxFreeSlot);
+    p += BLE_TELEMETRY_RADIO_RECORD_LEN;
+
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++, p += BLE_TELEMETRY_LINK_RECORD_LEN) {
+        const BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().at(i);
+        LinkQuality_t quality;
+
+        if (!link->connected || (getLinkQuality(link->handle, &quality) != BLE_ERROR_NONE)) {
+            continue;
+        }
+        p[0] = (uint8_t)link->handle;
+        p[1] = (uint8_t)(link->handle >> 8);
+        p[2] = quality.status;
+        p[3] = (uint8_t)quality.rssi;
+        p[4] = (uint8_t)quality.rssiMin;
+        p[5] = (uint8_t)quality.rssiAvg;
+        p[6] = (uint8_t)quality.rssiMax;
+        memcpy(&p[7], quality.channelMap, sizeof(quality.channelMap));
+        putUint32(&p[12], quality.queued);
+        putUint32(&p[16], quality.sent);
+        putUint32(&p[20], quality.dropped);
+    }
+
+    BlueNRG1_GattServer::getInstance().write(serviceValueHandle, value, sizeof(value), true);
+}
+#endif //BLE_TELEMETRY_SERVICE
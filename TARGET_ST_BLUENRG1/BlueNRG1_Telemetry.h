@@ -0,0 +1,141 @@
+#ifndef __BLUENRG1_TELEMETRY_H__
+#define __BLUENRG1_TELEMETRY_H__
+
+#include <stdint.h>
+
+#include "ble/GattAttribute.h"
+#include "ble/GattCharacteristic.h"
+
+#include "BlueNRG1_GattDb.h"
+#include "BlueNRG1_Links.h"
+
+/* Period of the link quality samples */
+#ifndef BLE_TELEMETRY_PERIOD_MS
+#define BLE_TELEMETRY_PERIOD_MS         1000
+#endif
+
+/* Vendor GATT service exposing the telemetry, 0 compiles it out */
+#ifndef BLE_TELEMETRY_SERVICE
+#define BLE_TELEMETRY_SERVICE           0
+#endif
+
+/* Returned by hci_read_rssi() when the controller has no RSSI */
+#define BLE_TELEMETRY_RSSI_UNKNOWN      127
+
+/* Bytes of the service value: the radio, then one record per link slot */
+#define BLE_TELEMETRY_RADIO_RECORD_LEN  8
+#define BLE_TELEMETRY_LINK_RECORD_LEN   24
+#define BLE_TELEMETRY_SERVICE_VALUE_LEN (BLE_TELEMETRY_RADIO_RECORD_LEN + BLE_MAX_LINKS * BLE_TELEMETRY_LINK_RECORD_LEN)
+
+/* Telemetry service, see btle.h */
+typedef BlueNRG1_GattDbService<BLUENRG1_UUID_128,
+            BlueNRG1_GattDbChar<BLUENRG1_UUID_128, BLE_TELEMETRY_SERVICE_VALUE_LEN,
+                                GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ> > TelemetryGattDb;
+
+/**************************************************************************/
+/*!
+    \brief
+    Link quality of every connection, sampled on a schedule.
+
+    Every BLE_TELEMETRY_PERIOD_MS, timed with a stack virtual timer while
+    links exist, the RSSI and the channel map of each link are read from
+    the controller with the state aci_hal_get_link_status() reports for it,
+    then the anchor period of the radio. The last BLE_LINK_RSSI_SAMPLES
+    RSSI values of each link are kept in BlueNRG1_Link_t, min/avg/max are
+    computed over them when read.
+
+    The GATT server reports what happens to every notification: queued
+    for lack of TX buffers, accepted by the stack, or dropped because the
+    queue was full or the link closed with updates still waiting.
+
+    With BLE_TELEMETRY_SERVICE, addService() publishes a read-only vendor
+    characteristic refreshed on every sample:
+        anchor period (4) | max free slot (4)
+    then for each of the BLE_MAX_LINKS slots, zeroed when unused,
+        handle (2) | status (1) | rssi (1) | min (1) | avg (1) | max (1) |
+        channel map (5) | queued (4) | sent (4) | dropped (4)
+    little endian, RSSI in dBm, 127 when unknown.
+*/
+/**************************************************************************/
+class BlueNRG1_Telemetry
+{
+public:
+    /* aci_hal_get_link_status() states */
+    typedef enum {
+        LINK_STATUS_IDLE        = 0x00,
+        LINK_STATUS_ADVERTISING = 0x01,
+        LINK_STATUS_SLAVE       = 0x02,
+        LINK_STATUS_SCANNING    = 0x03,
+        LINK_STATUS_MASTER      = 0x05,
+        LINK_STATUS_TX_TEST     = 0x06,
+        LINK_STATUS_RX_TEST     = 0x07
+    } LinkStatus_t;
+
+    typedef struct {
+        int8_t   rssi;            /**< Last sample in dBm, BLE_TELEMETRY_RSSI_UNKNOWN before the first. */
+        int8_t   rssiMin;         /**< Over the samples kept. */
+        int8_t   rssiAvg;
+        int8_t   rssiMax;
+        uint8_t  rssiSamples;     /**< Samples kept, up to BLE_LINK_RSSI_SAMPLES. */
+        uint8_t  status;          /**< LinkStatus_t. */
+        uint8_t  channelMap[5];   /**< Bit n: data channel n in use. */
+        uint8_t  usedChannels;
+        uint32_t samples;         /**< Samples taken since the connection. */
+        uint32_t queued;          /**< Notifications queued for lack of TX buffers. */
+        uint32_t sent;            /**< Notifications and indications accepted by the stack. */
+        uint32_t dropped;         /**< Notifications lost: queue full or link closed. */
+        uint32_t packetsCompleted;/**< Data packets acknowledged by the peer. */
+    } LinkQuality_t;
+
+    typedef struct {
+        uint32_t anchorPeriod;    /**< 0.625 ms units, 0 without links. */
+        uint32_t maxFreeSlot;     /**< Longest slot left for a new link, 0.625 ms units. */
+        uint32_t queued;          /**< Totals over all the links, closed ones included. */
+        uint32_t sent;
+        uint32_t dropped;
+    } Radio_t;
+
+    BlueNRG1_Telemetry();
+
+    void        enable(bool enable);
+    bool        isEnabled(void) const {
+        return enabled;
+    }
+    ble_error_t getLinkQuality(Gap::Handle_t handle, LinkQuality_t *quality);
+    void        getRadio(Radio_t *radio) const {
+        *radio = this->radio;
+    }
+    /* Sample every link now, without waiting for the timer */
+    void        sample(void);
+
+#if BLE_TELEMETRY_SERVICE
+    /* Add the vendor service to the GATT server, after BLE::init() */
+    ble_error_t addService(void);
+#endif
+
+    /* Notification of a link queued, accepted by the stack or lost */
+    void        onNotificationQueued(Gap::Handle_t handle);
+    void        onNotificationSent(Gap::Handle_t handle);
+    void        onNotificationDropped(Gap::Handle_t handle, uint8_t count);
+    /* Entry point for hci_number_of_completed_packets_event, for each handle */
+    void        onPacketsCompleted(Gap::Handle_t handle, uint16_t count);
+    /* A link connected or disconnected: run the sample timer while links exist */
+    void        onLinksChanged(void);
+    /* Entry point for the BLUENRG1_VTIMER_TELEMETRY expiry */
+    void        onTimeout(void);
+
+private:
+    void        sampleLink(BlueNRG1_Link_t *link, const uint8_t status[8], const uint16_t handles[8]);
+#if BLE_TELEMETRY_SERVICE
+    void        updateService(void);
+#endif
+
+    bool        enabled;
+    bool        running;   /**< Sample timer started. */
+    Radio_t     radio;
+#if BLE_TELEMETRY_SERVICE
+    GattAttribute::Handle_t serviceValueHandle;   /**< 0 until addService(). */
+#endif
+};
+
+#endif //__BLUENRG1_TELEMETRY_H__
@@ -0,0 +1,140 @@
+#include "BlueNRG1_Trace.h"
+
+#if BLE_TRACE
+
+#include <string.h>
+
+#include "hal/us_ticker_api.h"
+#include "platform/mbed_critical.h"
+
+/* Bytes of a record in the read() stream before the packet */
+#define TRACE_RECORD_HEADER     8
+
+BlueNRG1_Trace::BlueNRG1_Trace() :
+    head(0),
+    count(0),
+    overwritten(0)
+{
+}
+
+void BlueNRG1_Trace::clear(void)
+{
+    core_util_critical_section_enter();
+    head  = 0;
+    count = 0;
+    core_util_critical_section_exit();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Append a packet made of an HCI header and its parameters,
+            overwriting the oldest record when the ring is full
+*/
+/**************************************************************************/
+void BlueNRG1_Trace::record(uint8_t type, const uint8_t *header, uint8_t headerLength,
+                            const BlueNRG1_TraceParams &params)
+{
+    uint32_t  now = us_ticker_read();
+    Record_t *rec;
+    uint8_t   length;
+
+    core_util_critical_section_enter();
+    if (count < BLE_TRACE_RECORDS) {
+        rec = &records[(head + count) % BLE_TRACE_RECORDS];
+        count++;
+    } else {
+        rec  = &records[head];
+        head = (head + 1) % BLE_TRACE_RECORDS;
+        overwritten++;
+    }
+
+    length = params.length;
+    if (headerLength + length > BLE_TRACE_PAYLOAD) {
+        length = BLE_TRACE_PAYLOAD - headerLength;
+    }
+    rec->timestamp      = now;
+    rec->type           = type;
+    rec->length         = headerLength + length;
+    rec->originalLength = headerLength + params.total;
+    memcpy(rec->data, header, headerLength);
+    memcpy(&rec->data[headerLength], params.data, length);
+    core_util_critical_section_exit();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Trace a command and the status it returned, as a Command
+            Complete event
+*/
+/**************************************************************************/
+uint8_t BlueNRG1_Trace::command(uint16_t opcode, uint8_t status, const BlueNRG1_TraceParams &params)
+{
+    uint8_t cmd[3] = { (uint8_t)opcode, (uint8_t)(opcode >> 8), (uint8_t)params.total };
+    uint8_t complete[6] = { HCI_EVT_CMD_COMPLETE, 4, 1, (uint8_t)opcode, (uint8_t)(opcode >> 8), status };
+
+    record(BLE_TRACE_TYPE_COMMAND, cmd, sizeof(cmd), params);
+    record(BLE_TRACE_TYPE_EVENT, complete, sizeof(complete), BlueNRG1_TraceParams());
+
+    return status;
+}
+
+void BlueNRG1_Trace::event(uint8_t code, const BlueNRG1_TraceParams &params)
+{
+    uint8_t evt[2] = { code, (uint8_t)params.total };
+
+    record(BLE_TRACE_TYPE_EVENT, evt, sizeof(evt), params);
+}
+
+void BlueNRG1_Trace::leEvent(uint8_t subevent, const BlueNRG1_TraceParams &params)
+{
+    uint8_t evt[3] = { HCI_EVT_LE_META, (uint8_t)(params.total + 1), subevent };
+
+    record(BLE_TRACE_TYPE_EVENT, evt, sizeof(evt), params);
+}
+
+void BlueNRG1_Trace::vendorEvent(uint16_t ecode, const BlueNRG1_TraceParams &params)
+{
+    uint8_t evt[4] = { HCI_EVT_VENDOR, (uint8_t)(params.total + 2), (uint8_t)ecode, (uint8_t)(ecode >> 8) };
+
+    record(BLE_TRACE_TYPE_EVENT, evt, sizeof(evt), params);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Drain the oldest records
+
+    @returns    Bytes written in buffer, 0 when the ring is empty or the
+                oldest record does not fit
+*/
+/**************************************************************************/
+uint16_t BlueNRG1_Trace::read(uint8_t *buffer, uint16_t size)
+{
+    uint16_t pos = 0;
+
+    core_util_critical_section_enter();
+    while (count > 0) {
+        const Record_t *rec = &records[head];
+
+        if (pos + TRACE_RECORD_HEADER + rec->length > size) {
+            break;
+        }
+        buffer[pos++] = (uint8_t)rec->timestamp;
+        buffer[pos++] = (uint8_t)(rec->timestamp >> 8);
+        buffer[pos++] = (uint8_t)(rec->timestamp >> 16);
+        buffer[pos++] = (uint8_t)(rec->timestamp >> 24);
+        buffer[pos++] = rec->type;
+        buffer[pos++] = rec->length;
+        buffer[pos++] = (uint8_t)rec->originalLength;
+        buffer[pos++] = (uint8_t)(rec->originalLength >> 8);
+        memcpy(&buffer[pos], rec->data, rec->length);
+        pos += rec->length;
+
+        head = (head + 1) % BLE_TRACE_RECORDS;
+        count--;
+    }
+    core_util_critical_section_exit();
+
+    return pos;
+}
+
+#endif //BLE_TRACE
@@ -0,0 +1,244 @@
+#ifndef __BLUENRG1_TRACE_H__
+#define __BLUENRG1_TRACE_H__
+
+#include <stdint.h>
+
+/* Trace of the ACI/HCI traffic between the port and the stack, 0 compiles it out */
+#ifndef BLE_TRACE
+#define BLE_TRACE                   0
+#endif
+
+#if BLE_TRACE
+
+/* Records kept in RAM, the oldest are overwritten */
+#ifndef BLE_TRACE_RECORDS
+#define BLE_TRACE_RECORDS           48
+#endif
+
+/* Packet bytes kept per record, longer packets are truncated */
+#ifndef BLE_TRACE_PAYLOAD
+#define BLE_TRACE_PAYLOAD           28
+#endif
+
+/* Packet types of the records, H4 indicators */
+#define BLE_TRACE_TYPE_COMMAND      0x01
+#define BLE_TRACE_TYPE_EVENT        0x04
+
+/* HCI event codes */
+#define HCI_EVT_DISCONN_COMPLETE    0x05
+#define HCI_EVT_ENCRYPTION_CHANGE   0x08
+#define HCI_EVT_CMD_COMPLETE        0x0E
+#define HCI_EVT_NUM_COMP_PKTS       0x13
+#define HCI_EVT_LE_META             0x3E
+#define HCI_EVT_VENDOR              0xFF
+
+/* LE meta subevents */
+#define HCI_LE_EVT_CONN_COMPLETE        0x01
+#define HCI_LE_EVT_ADV_REPORT           0x02
+#define HCI_LE_EVT_CONN_UPDATE_COMPLETE 0x03
+#define HCI_LE_EVT_ENHANCED_CONN_COMPLETE   0x0A
+
+/* Opcodes of the commands the port sends, BlueNRG-1 ACI (UM2025) */
+#define HCI_READ_BD_ADDR_OPCODE                         0x1009
+#define HCI_READ_RSSI_OPCODE                            0x1405
+#define HCI_LE_SET_SCAN_RESPONSE_DATA_OPCODE            0x2009
+#define HCI_LE_CLEAR_WHITE_LIST_OPCODE                  0x2010
+#define HCI_LE_READ_CHANNEL_MAP_OPCODE                  0x2015
+#define HCI_LE_RAND_OPCODE                              0x2018
+#define HCI_LE_CLEAR_RESOLVING_LIST_OPCODE              0x2029
+#define HCI_LE_READ_LOCAL_RESOLVABLE_ADDRESS_OPCODE     0x202C
+#define HCI_LE_SET_ADDRESS_RESOLUTION_ENABLE_OPCODE     0x202D
+#define HCI_LE_SET_RESOLVABLE_PRIVATE_ADDRESS_TIMEOUT_OPCODE 0x202E
+#define ACI_HAL_SET_TX_POWER_LEVEL_OPCODE               0xFC0F
+#define ACI_HAL_GET_LINK_STATUS_OPCODE                  0xFC17
+#define ACI_HAL_SET_RADIO_ACTIVITY_MASK_OPCODE          0xFC18
+#define ACI_HAL_GET_ANCHOR_PERIOD_OPCODE                0xFC19
+#define ACI_GAP_SET_NON_DISCOVERABLE_OPCODE             0xFC81
+#define ACI_GAP_SET_DISCOVERABLE_OPCODE                 0xFC83
+#define ACI_GAP_SET_DIRECT_CONNECTABLE_OPCODE           0xFC84
+#define ACI_GAP_SET_IO_CAPABILITY_OPCODE                0xFC85
+#define ACI_GAP_SET_AUTHENTICATION_REQUIREMENT_OPCODE   0xFC86
+#define ACI_GAP_PASS_KEY_RESP_OPCODE                    0xFC88
+#define ACI_GAP_INIT_OPCODE                             0xFC8A
+#define ACI_GAP_SLAVE_SECURITY_REQ_OPCODE               0xFC8D
+#define ACI_GAP_UPDATE_ADV_DATA_OPCODE                  0xFC8E
+#define ACI_GAP_DELETE_AD_TYPE_OPCODE                   0xFC8F
+#define ACI_GAP_GET_SECURITY_LEVEL_OPCODE               0xFC90
+#define ACI_GAP_CONFIGURE_WHITELIST_OPCODE              0xFC92
+#define ACI_GAP_TERMINATE_OPCODE                        0xFC93
+#define ACI_GAP_CLEAR_SECURITY_DB_OPCODE                0xFC94
+#define ACI_GAP_ALLOW_REBOND_OPCODE                     0xFC95
+#define ACI_GAP_CREATE_CONNECTION_OPCODE                0xFC9C
+#define ACI_GAP_TERMINATE_GAP_PROC_OPCODE               0xFC9D
+#define ACI_GAP_START_CONNECTION_UPDATE_OPCODE          0xFC9E
+#define ACI_GAP_SEND_PAIRING_REQ_OPCODE                 0xFC9F
+#define ACI_GAP_START_OBSERVATION_PROC_OPCODE           0xFCA2
+#define ACI_GAP_GET_BONDED_DEVICES_OPCODE               0xFCA3
+#define ACI_GAP_IS_DEVICE_BONDED_OPCODE                 0xFCA4
+#define ACI_GAP_NUMERIC_COMPARISON_VALUE_CONFIRM_YESNO_OPCODE 0xFCA5
+#define ACI_GAP_ADD_DEVICES_TO_RESOLVING_LIST_OPCODE    0xFCA9
+#define ACI_GATT_INIT_OPCODE                            0xFD01
+#define ACI_GATT_ADD_SERVICE_OPCODE                     0xFD02
+#define ACI_GATT_ADD_CHAR_OPCODE                        0xFD04
+#define ACI_GATT_ADD_CHAR_DESC_OPCODE                   0xFD05
+#define ACI_GATT_UPDATE_CHAR_VALUE_OPCODE               0xFD06
+#define ACI_GATT_EXCHANGE_CONFIG_OPCODE                 0xFD0B
+#define ACI_GATT_DISC_PRIMARY_SERVICE_BY_UUID_OPCODE    0xFD13
+#define ACI_GATT_DISC_CHAR_BY_UUID_OPCODE               0xFD16
+#define ACI_GATT_DISC_ALL_CHAR_DESC_OPCODE              0xFD17
+#define ACI_GATT_WRITE_CHAR_DESC_OPCODE                 0xFD21
+#define ACI_GATT_CONFIRM_INDICATION_OPCODE              0xFD25
+#define ACI_GATT_SET_DESC_VALUE_OPCODE                  0xFD29
+#define ACI_GATT_READ_HANDLE_VALUE_OPCODE               0xFD2A
+#define ACI_GATT_UPDATE_CHAR_VALUE_EXT_OPCODE           0xFD2C
+#define ACI_L2CAP_CONN_PARAM_UPDATE_REQ_OPCODE          0xFD81
+#define ACI_L2CAP_CONN_PARAM_UPDATE_RESP_OPCODE         0xFD82
+
+/* Event codes of the vendor events the port handles */
+#define ACI_HAL_END_OF_RADIO_ACTIVITY_VSEVT_CODE        0x0004
+#define ACI_GAP_PAIRING_COMPLETE_VSEVT_CODE             0x0401
+#define ACI_GAP_PASS_KEY_REQ_VSEVT_CODE                 0x0402
+#define ACI_GAP_BOND_LOST_VSEVT_CODE                    0x0405
+#define ACI_GAP_PROC_COMPLETE_VSEVT_CODE                0x0407
+#define ACI_GAP_NUMERIC_COMPARISON_VALUE_VSEVT_CODE     0x0409
+#define ACI_L2CAP_CONN_UPDATE_RESP_VSEVT_CODE           0x0800
+#define ACI_L2CAP_PROC_TIMEOUT_VSEVT_CODE               0x0801
+#define ACI_L2CAP_CONN_UPDATE_REQ_VSEVT_CODE            0x0802
+#define ACI_GATT_ATTRIBUTE_MODIFIED_VSEVT_CODE          0x0C01
+#define ACI_ATT_EXCHANGE_MTU_RESP_VSEVT_CODE            0x0C03
+#define ACI_ATT_FIND_INFO_RESP_VSEVT_CODE               0x0C04
+#define ACI_ATT_FIND_BY_TYPE_VALUE_RESP_VSEVT_CODE      0x0C05
+#define ACI_GATT_DISC_READ_CHAR_BY_UUID_RESP_VSEVT_CODE 0x0C12
+#define ACI_GATT_INDICATION_VSEVT_CODE                  0x0C0E
+#define ACI_GATT_NOTIFICATION_VSEVT_CODE                0x0C0F
+#define ACI_GATT_PROC_COMPLETE_VSEVT_CODE               0x0C10
+#define ACI_GATT_TX_POOL_AVAILABLE_VSEVT_CODE           0x0C16
+
+/**************************************************************************/
+/*!
+    \brief
+    Parameters of a traced packet, in HCI order.
+
+    Only the first BLE_TRACE_PAYLOAD bytes are kept, the full length is
+    still counted so the record shows the packet was truncated.
+*/
+/**************************************************************************/
+class BlueNRG1_TraceParams
+{
+public:
+    BlueNRG1_TraceParams() : length(0), total(0) {
+    }
+
+    BlueNRG1_TraceParams &u8(uint8_t value) {
+        if (length < BLE_TRACE_PAYLOAD) {
+            data[length++] = value;
+        }
+        total++;
+        return *this;
+    }
+
+    BlueNRG1_TraceParams &u16(uint16_t value) {
+        return u8((uint8_t)value).u8((uint8_t)(value >> 8));
+    }
+
+    BlueNRG1_TraceParams &u32(uint32_t value) {
+        return u16((uint16_t)value).u16((uint16_t)(value >> 16));
+    }
+
+    BlueNRG1_TraceParams &bytes(const uint8_t *value, uint16_t len) {
+        for (uint16_t i = 0; (i < len) && (length < BLE_TRACE_PAYLOAD); i++) {
+            data[length++] = value[i];
+        }
+        total += len;
+        return *this;
+    }
+
+    uint8_t  data[BLE_TRACE_PAYLOAD];
+    uint8_t  length;   /**< Bytes kept in data. */
+    uint16_t total;    /**< Length of the parameters. */
+};
+
+/**************************************************************************/
+/*!
+    \brief
+    RAM ring of the commands sent to the stack and the events it raised.
+
+    The BlueNRG-1 stack is a library called directly, there is no HCI
+    transport: each ACI/HCI wrapper and event callback of the port rebuilds
+    the HCI packet from its arguments, timestamped with us_ticker_read().
+    Commands are followed by a Command Complete event carrying the status
+    they returned:
+        ret = BLE_TRACE_COMMAND(ACI_GAP_TERMINATE_OPCODE,
+                                BLE_TRACE_PARAMS.u16(handle).u8(reason),
+                                aci_gap_terminate(handle, reason));
+    With BLE_TRACE at 0 only the call is left.
+
+    read() drains the ring as records of
+        timestamp (4) | type (1) | length (1) | original length (2) | packet
+    little endian, for the UART or a GATT characteristic;
+    trace2btsnoop.py turns them into a btsnoop file for Wireshark.
+*/
+/**************************************************************************/
+class BlueNRG1_Trace
+{
+public:
+    typedef struct {
+        uint32_t timestamp;        /**< us_ticker_read() when recorded. */
+        uint8_t  type;             /**< BLE_TRACE_TYPE_COMMAND or BLE_TRACE_TYPE_EVENT. */
+        uint8_t  length;           /**< Bytes kept in data. */
+        uint16_t originalLength;   /**< Length of the HCI packet. */
+        uint8_t  data[BLE_TRACE_PAYLOAD];
+    } Record_t;
+
+    static BlueNRG1_Trace &getInstance() {
+        static BlueNRG1_Trace m_instance;
+        return m_instance;
+    }
+
+    /* Return status, so the macro can wrap the command call */
+    uint8_t  command(uint16_t opcode, uint8_t status, const BlueNRG1_TraceParams &params);
+    void     event(uint8_t code, const BlueNRG1_TraceParams &params);
+    void     leEvent(uint8_t subevent, const BlueNRG1_TraceParams &params);
+    void     vendorEvent(uint16_t ecode, const BlueNRG1_TraceParams &params);
+
+    /* Copy the oldest whole records that fit in buffer, return the bytes written */
+    uint16_t read(uint8_t *buffer, uint16_t size);
+    void     clear(void);
+
+    uint16_t getCount(void) const {
+        return count;
+    }
+    /* Records overwritten before being read */
+    uint32_t getOverwritten(void) const {
+        return overwritten;
+    }
+
+private:
+    BlueNRG1_Trace();
+    BlueNRG1_Trace(BlueNRG1_Trace const&);
+    void operator=(BlueNRG1_Trace const&);
+
+    void     record(uint8_t type, const uint8_t *header, uint8_t headerLength, const BlueNRG1_TraceParams &params);
+
+    Record_t records[BLE_TRACE_RECORDS];
+    uint16_t head;          /**< Oldest record. */
+    uint16_t count;
+    uint32_t overwritten;
+};
+
+#define BLE_TRACE_PARAMS                                BlueNRG1_TraceParams()
+#define BLE_TRACE_COMMAND(opcode, params, call)         BlueNRG1_Trace::getInstance().command((opcode), (call), (params))
+#define BLE_TRACE_EVENT(code, params)                   BlueNRG1_Trace::getInstance().event((code), (params))
+#define BLE_TRACE_LE_EVENT(subevent, params)            BlueNRG1_Trace::getInstance().leEvent((subevent), (params))
+#define BLE_TRACE_VS_EVENT(ecode, params)               BlueNRG1_Trace::getInstance().vendorEvent((ecode), (params))
+
+#else
+
+#define BLE_TRACE_COMMAND(opcode, params, call)         (call)
+#define BLE_TRACE_EVENT(code, params)                   do { } while (0)
+#define BLE_TRACE_LE_EVENT(subevent, params)            do { } while (0)
+#define BLE_TRACE_VS_EVENT(ecode, params)               do { } while (0)
+
+#endif //BLE_TRACE
+
+#endif //__BLUENRG1_TRACE_H__
@@ -0,0 +1,156 @@
+#include "BlueNRG1_TxPowerControl.h"
+#include "BlueNRG1_ble.h"
+#include "BlueNRG1_Trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#ifdef __cplusplus
+}
+#endif
+
+/* aci_hal_set_tx_power_level() settings in increasing output power */
+typedef struct {
+    uint8_t highPower;
+    uint8_t paLevel;
+    int8_t  dbm;
+} TxPowerStep_t;
+
+static const TxPowerStep_t txPowerSteps[] = {
+    { 0, 0, -18 },
+    { 0, 1, -15 },
+    { 0, 2, -12 },
+    { 0, 3,  -9 },
+    { 0, 4,  -6 },
+    { 0, 5,  -2 },
+    { 0, 6,   0 },
+    { 1, 5,   2 },
+    { 1, 6,   4 },
+    { 1, 7,   8 }    /* Used by the stack at reset */
+};
+
+#define TX_POWER_TOP_STEP   ((uint8_t)(sizeof(txPowerSteps) / sizeof(txPowerSteps[0]) - 1))
+
+BlueNRG1_TxPowerControl::BlueNRG1_TxPowerControl() :
+    enabled(true),
+    targetRssi(BLE_TX_POWER_TARGET_RSSI),
+    margin(BLE_TX_POWER_MARGIN_DB)
+{
+    memset(&status, 0, sizeof(status));
+    status.step      = TX_POWER_TOP_STEP;
+    status.dbm       = txPowerSteps[TX_POWER_TOP_STEP].dbm;
+    status.worstRssi = BLE_TELEMETRY_RSSI_UNKNOWN;
+}
+
+void BlueNRG1_TxPowerControl::enable(bool enable)
+{
+    enabled = enable;
+    if (!enabled) {
+        apply(TX_POWER_TOP_STEP);
+    }
+}
+
+ble_error_t BlueNRG1_TxPowerControl::apply(uint8_t step)
+{
+    const TxPowerStep_t *setting = &txPowerSteps[step];
+    tBleStatus ret;
+
+    if (step == status.step) {
+        return BLE_ERROR_NONE;
+    }
+
+    ret = BLE_TRACE_COMMAND(ACI_HAL_SET_TX_POWER_LEVEL_OPCODE,
+                            BLE_TRACE_PARAMS.u8(setting->highPower).u8(setting->paLevel),
+                            aci_hal_set_tx_power_level(setting->highPower, setting->paLevel));
+    if (ret != BLE_STATUS_SUCCESS) {
+        return BlueNRG1_ble::bleStatusToError(ret);
+    }
+
+    status.step = step;
+    status.dbm  = setting->dbm;
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+
+    return BLE_ERROR_NONE;
+}
+
+void BlueNRG1_TxPowerControl::onLinksChanged(void)
+{
+    if (BlueNRG1_Links::getInstance().getCount() == 0) {
+        status.downSamples = 0;
+        status.worstRssi   = BLE_TELEMETRY_RSSI_UNKNOWN;
+        apply(TX_POWER_TOP_STEP);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Estimate how the worst peer receives us and step the output
+            power, see the class description
+*/
+/**************************************************************************/
+void BlueNRG1_TxPowerControl::onSample(void)
+{
+    BlueNRG1_Links     &links     = BlueNRG1_Links::getInstance();
+    BlueNRG1_Telemetry &telemetry = BlueNRG1_Gap::getInstance().getTelemetry();
+    int16_t worst   = BLE_TELEMETRY_RSSI_UNKNOWN;
+    bool    backlog = false;
+    uint8_t step    = status.step;
+
+    if (!enabled || !telemetry.isEnabled()) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        BlueNRG1_Link_t *link = links.at(i);
+        BlueNRG1_Telemetry::LinkQuality_t quality;
+
+        if (!link->connected || (telemetry.getLinkQuality(link->handle, &quality) != BLE_ERROR_NONE)) {
+            continue;
+        }
+
+        /* TX buffers not freed in time: the link layer is retrying */
+        uint32_t congestion = quality.queued + quality.dropped;
+        if (congestion != link->quality.congestionMark) {
+            link->quality.congestionMark = congestion;
+            backlog = true;
+        }
+
+        if (quality.rssiSamples >= BLE_TX_POWER_MIN_RSSI_SAMPLES) {
+            int16_t received = quality.rssiAvg + status.dbm - BLE_TX_POWER_PEER_DBM;
+            if (received < worst) {
+                worst = received;
+            }
+        }
+    }
+    status.worstRssi = (int8_t)((worst < -128) ? -128 : worst);
+
+    if (backlog) {
+        step = ((TX_POWER_TOP_STEP - step) > BLE_TX_POWER_UP_STEPS) ? (step + BLE_TX_POWER_UP_STEPS)
+                                                                     : TX_POWER_TOP_STEP;
+        status.downSamples = 0;
+        if (step != status.step) {
+            status.backlogUps++;
+        }
+    } else if (worst == BLE_TELEMETRY_RSSI_UNKNOWN) {
+        status.downSamples = 0;
+    } else if (worst < targetRssi) {
+        status.downSamples = 0;
+        if (step < TX_POWER_TOP_STEP) {
+            step++;
+            status.stepsUp++;
+        }
+    } else if ((step > 0) &&
+               ((worst - (txPowerSteps[step].dbm - txPowerSteps[step - 1].dbm)) >= (targetRssi + margin))) {
+        if (++status.downSamples >= BLE_TX_POWER_DOWN_SAMPLES) {
+            status.downSamples = 0;
+            step--;
+            status.stepsDown++;
+        }
+    } else {
+        status.downSamples = 0;
+    }
+
+    apply(step);
+}
@@ -0,0 +1,102 @@
+#ifndef __BLUENRG1_TXPOWERCONTROL_H__
+#define __BLUENRG1_TXPOWERCONTROL_H__
+
+#include <stdint.h>
+
+#include "BlueNRG1_Links.h"
+
+/* RSSI the peer should receive us with, dBm */
+#ifndef BLE_TX_POWER_TARGET_RSSI
+#define BLE_TX_POWER_TARGET_RSSI        (-70)
+#endif
+
+/* Margin above the target the next step down must keep, dB */
+#ifndef BLE_TX_POWER_MARGIN_DB
+#define BLE_TX_POWER_MARGIN_DB          6
+#endif
+
+/* TX power assumed for the peers, to estimate the RSSI they receive us with */
+#ifndef BLE_TX_POWER_PEER_DBM
+#define BLE_TX_POWER_PEER_DBM           0
+#endif
+
+/* Samples in a row within the margin before stepping down */
+#ifndef BLE_TX_POWER_DOWN_SAMPLES
+#define BLE_TX_POWER_DOWN_SAMPLES       3
+#endif
+
+/* Steps taken up at once when notifications back up */
+#ifndef BLE_TX_POWER_UP_STEPS
+#define BLE_TX_POWER_UP_STEPS           3
+#endif
+
+/* RSSI samples a link needs before it counts */
+#ifndef BLE_TX_POWER_MIN_RSSI_SAMPLES
+#define BLE_TX_POWER_MIN_RSSI_SAMPLES   2
+#endif
+
+/**************************************************************************/
+/*!
+    \brief
+    Closed loop TX power, from the link quality BlueNRG1_Telemetry samples.
+
+    aci_hal_set_tx_power_level() sets the power of the whole radio, so the
+    controller serves the worst link. BLE exposes no RSSI measured by the
+    peer; the path loss is taken as symmetric and the peers as sending at
+    BLE_TX_POWER_PEER_DBM, so the peer receives us at about
+        rssi + ours - BLE_TX_POWER_PEER_DBM
+    with rssi the average hci_read_rssi() of the link.
+
+    After every telemetry sample:
+     - below BLE_TX_POWER_TARGET_RSSI, one step up;
+     - notifications queued or dropped since the last sample, the link
+       layer retrying instead of sending, BLE_TX_POWER_UP_STEPS up at once;
+     - when one step down keeps BLE_TX_POWER_MARGIN_DB above the target for
+       BLE_TX_POWER_DOWN_SAMPLES samples, one step down.
+    Without links the radio goes back to the highest step, 8 dBm as at
+    reset, for advertising and reconnection.
+*/
+/**************************************************************************/
+class BlueNRG1_TxPowerControl
+{
+public:
+    typedef struct {
+        int8_t   dbm;          /**< Output power in use. */
+        uint8_t  step;         /**< Position in the power table, 0 the lowest. */
+        int8_t   worstRssi;    /**< Estimated RSSI of the worst peer, 127 unknown. */
+        uint8_t  downSamples;  /**< Samples in a row within the margin. */
+        uint32_t stepsDown;
+        uint32_t stepsUp;
+        uint32_t backlogUps;   /**< Jumps up after notifications backed up. */
+    } Status_t;
+
+    BlueNRG1_TxPowerControl();
+
+    /* Disabled, the radio stays at the highest step */
+    void        enable(bool enable);
+    bool        isEnabled(void) const {
+        return enabled;
+    }
+    void        setTarget(int8_t rssi, uint8_t marginDb) {
+        targetRssi = rssi;
+        margin     = marginDb;
+    }
+    void        getStatus(Status_t *status) const {
+        *status = this->status;
+    }
+
+    /* A link connected or disconnected: back to the highest step without links */
+    void        onLinksChanged(void);
+    /* Called after every BlueNRG1_Telemetry sample */
+    void        onSample(void);
+
+private:
+    ble_error_t apply(uint8_t step);
+
+    bool        enabled;
+    int8_t      targetRssi;
+    uint8_t     margin;
+    Status_t    status;
+};
+
+#endif //__BLUENRG1_TXPOWERCONTROL_H__
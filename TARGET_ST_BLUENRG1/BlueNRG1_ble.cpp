@@ -13,13 +13,30 @@ extern "C" {
 #include "bluenrg1_hal.h"
 #include "bluenrg1_stack.h"
 #include "hci_const.h"
-#include "link_layer.h "
+#include "link_layer.h"
 #include "sm.h"
+#include "BlueNRG1_pka.h"
 #ifdef __cplusplus
 }
 #endif
 
-//#include "btle.h"
+#include "btle.h"
+#include "sleep_residency.h"
+#include "BlueNRG1_Stats.h"
+#include "BlueNRG1_Trace.h"
+
+/* Sleep modes returned by BlueNRG_Stack_Perform_Deep_Sleep_Check() */
+#define SLEEPMODE_RUNNING       0
+#define SLEEPMODE_CPU_HALT      1
+#define SLEEPMODE_WAKETIMER     2
+#define SLEEPMODE_NOTIMER       3
+
+/* privacy_enabled of aci_gap_init(), bluenrg1_gap.h only names the host privacy */
+#if BLE_PRIVACY
+#define GAP_PRIVACY_MODE        0x02
+#else
+#define GAP_PRIVACY_MODE        PRIVACY_DISABLED
+#endif
 
 /**
 * The singleton which represents the nRF51822 transport for the BLE.
@@ -42,7 +59,13 @@ BlueNRG1_ble& BlueNRG1_ble::Instance(BLE::InstanceID_t instanceId){
   return getDeviceInstance();
 }
 
-BlueNRG1_ble::BlueNRG1_ble(){}
+BlueNRG1_ble::BlueNRG1_ble() :
+    isInitialized(false),
+    stackTickPending(false),
+    eventsSignaled(false),
+    expiredTimers(0)
+{
+}
 
 BlueNRG1_ble::~BlueNRG1_ble(){}
 
@@ -57,17 +80,38 @@ ble_error_t BlueNRG1_ble::init(BLE::InstanceID_t instanceID, FunctionPointerWith
         return BLE_ERROR_ALREADY_INITIALIZED;
     }
   
-    // Init the BlueNRG/BlueNRG-MS stack
-    //btleInit();  //ST
     // BlueNRG-1 stack init
-    /*ret = BlueNRG_Stack_Initialization(&BlueNRG_Stack_Init_params);
+    ret = BlueNRG_Stack_Initialization(&BlueNRG_Stack_Init_params);
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = BLE_TRACE_COMMAND(ACI_GATT_INIT_OPCODE, BLE_TRACE_PARAMS, aci_gatt_init());
+    }
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = BLE_TRACE_COMMAND(ACI_GAP_INIT_OPCODE,
+                                BLE_TRACE_PARAMS.u8(GAP_PERIPHERAL_ROLE).u8(GAP_PRIVACY_MODE).u8(DEVICE_NAME_LEN),
+                                aci_gap_init(GAP_PERIPHERAL_ROLE, GAP_PRIVACY_MODE, DEVICE_NAME_LEN,
+                                             &gapServiceHandle, &devNameCharHandle, &appearanceCharHandle));
+    }
     if (ret != BLE_STATUS_SUCCESS) {
-        printf("Error in BlueNRG_Stack_Initialization() 0x%02x\r\n", ret);
-        while(1);
-    }*/
-    printf("STACK INIT \n\r");
+        BLE::InitializationCompleteCallbackContext context = {
+            BLE::Instance(instanceID),
+            BLE_ERROR_INTERNAL_STACK_FAILURE
+        };
+        callback.call(&context);
+        return BLE_ERROR_INTERNAL_STACK_FAILURE;
+    }
+
+#if BLE_SM_SECURE_CONNECTIONS
+    // The P-256 computations of the stack end with the PKA interrupt
+    PKA_ClearITPendingBit(PKA_PROCEND);
+    PKA_ITConfig(PKA_PROCEND, ENABLE);
+    NVIC_EnableIRQ(PKA_IRQn);
+#endif
 
     isInitialized = true;
+    BlueNRG1_GattServer::getInstance().setReservation(NUM_APP_GATT_SERVICES, NUM_APP_GATT_ATTRIBUTES,
+                                                      APP_ATT_VALUE_ARRAY_SIZE);
+    requestStackTick();
+
     BLE::InitializationCompleteCallbackContext context = {
         BLE::Instance(instanceID),
         BLE_ERROR_NONE
@@ -79,9 +123,108 @@ ble_error_t BlueNRG1_ble::init(BLE::InstanceID_t instanceID, FunctionPointerWith
 
 
 
+ble_error_t BlueNRG1_ble::shutdown(void)
+{
+    return BLE_ERROR_NOT_IMPLEMENTED;
+}
+
+const char *BlueNRG1_ble::getVersion(void)
+{
+    return "BlueNRG-1 BLE stack v2.x";
+}
+
+/**
+* Flag that BTLE_StackTick() has work to do and wake up the application.
+* It is called from the radio ISR, from the stack VTimer callback and after
+* every ACI command issued by the port; the EventQueue is signalled at most
+* once until processEvents() runs.
+*/
+void BlueNRG1_ble::requestStackTick(void)
+{
+    bool signal = false;
+
+    core_util_critical_section_enter();
+    stackTickPending = true;
+    if (!eventsSignaled) {
+        eventsSignaled = true;
+        signal = true;
+    }
+    core_util_critical_section_exit();
+
+    if (signal) {
+        signalEventsToProcess(BLE::DEFAULT_INSTANCE);
+    }
+}
+
 void BlueNRG1_ble::processEvents() {
-    //btle_handler();   //ST
-  printf("btle_handler()\n\r");
+    core_util_critical_section_enter();
+    eventsSignaled = false;
+    bool tick = stackTickPending;
+    stackTickPending = false;
+    core_util_critical_section_exit();
+
+    if (!tick) {
+        return;
+    }
+
+    BTLE_StackTick();
+
+    core_util_critical_section_enter();
+    uint8_t timers = expiredTimers;
+    expiredTimers = 0;
+    core_util_critical_section_exit();
+
+    if (timers & (1 << BLUENRG1_VTIMER_ADV_SCHEDULER)) {
+        BlueNRG1_Gap::getInstance().onAdvSchedulerTimeout();
+    }
+    if (timers & (1 << BLUENRG1_VTIMER_CONNECT)) {
+        BlueNRG1_Gap::getInstance().onConnectTimeout();
+    }
+    if (timers & (1 << BLUENRG1_VTIMER_CONN_MANAGER)) {
+        BlueNRG1_Gap::getInstance().getConnManager().onTimeout();
+    }
+    if (timers & (1 << BLUENRG1_VTIMER_TELEMETRY)) {
+        BlueNRG1_Gap::getInstance().getTelemetry().onTimeout();
+        BlueNRG1_Gap::getInstance().getTxPowerControl().onSample();
+    }
+    BlueNRG1_Gap::getInstance().getRadioScheduler().process();
+
+    // The stack keeps asking to run while it still has ACI events queued: the
+    // radio interrupt does not come for them. Every tick is an EventQueue event
+    // of its own, the application work posted meanwhile runs in between
+    if (BlueNRG_Stack_Perform_Deep_Sleep_Check() == SLEEPMODE_RUNNING) {
+        requestStackTick();
+    }
+}
+
+/**
+* Translate a BlueNRG-1 stack status into an mbed error code.
+*/
+ble_error_t BlueNRG1_ble::bleStatusToError(uint8_t status)
+{
+    switch (status) {
+        case BLE_STATUS_SUCCESS:
+            return BLE_ERROR_NONE;
+        case BLE_STATUS_INSUFFICIENT_RESOURCES:
+        case BLE_STATUS_OUT_OF_HANDLE:
+            return BLE_ERROR_NO_MEM;
+        case BLE_STATUS_INVALID_HANDLE:
+        case BLE_STATUS_INVALID_PARAMS:
+        case BLE_STATUS_INVALID_PARAMETER:
+            return BLE_ERROR_INVALID_PARAM;
+        case BLE_STATUS_BUSY:
+            return BLE_STACK_BUSY;
+        case BLE_STATUS_NOT_ALLOWED:
+            return BLE_ERROR_OPERATION_NOT_PERMITTED;
+        default:
+            return BLE_ERROR_INTERNAL_STACK_FAILURE;
+    }
+}
+
+void BlueNRG1_ble::waitForEvent(void)
+{
+    processEvents();
+    sleep();
 }
 
 
@@ -89,6 +232,10 @@ GattServer &BlueNRG1_ble::getGattServer(){
     return BlueNRG1_GattServer::getInstance();
 }
 
+const GattServer &BlueNRG1_ble::getGattServer() const{
+    return BlueNRG1_GattServer::getInstance();
+}
+
 
 Gap        &BlueNRG1_ble::getGap(){
     return BlueNRG1_Gap::getInstance();
@@ -96,4 +243,83 @@ Gap        &BlueNRG1_ble::getGap(){
 
 const Gap  &BlueNRG1_ble::getGap() const{
     return BlueNRG1_Gap::getInstance();
-}
\ No newline at end of file
+}
+
+
+/**
+* Radio interrupt: let the link layer run, then schedule the host part of the
+* stack on the EventQueue.
+*/
+extern "C" void Blue_Handler(void)
+{
+    RAL_Isr();
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+/**
+* Public key accelerator interrupt: a P-256 key generation or DH key computation
+* the stack started for an LE Secure Connections pairing is over, the next
+* BTLE_StackTick() collects the result and moves the pairing on.
+*/
+extern "C" void PKA_Handler(void)
+{
+    PKA_ClearITPendingBit(PKA_PROCEND);
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).requestStackTick();
+}
+
+/**
+* Stack virtual timers expire in interrupt context, the timeout is serviced by
+* the next BTLE_StackTick() and the port timers are dispatched right after it.
+*/
+void BlueNRG1_ble::onVTimerTimeout(uint8_t timerNum)
+{
+    core_util_critical_section_enter();
+    expiredTimers |= (uint8_t)(1 << timerNum);
+    core_util_critical_section_exit();
+
+    requestStackTick();
+}
+
+extern "C" void HAL_VTimerTimeoutCallback(uint8_t timerNum)
+{
+    BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).onVTimerTimeout(timerNum);
+}
+
+/**
+* Let hal_deepsleep() know how deep the stack allows the device to sleep.
+*/
+extern "C" uint8_t bluenrg1_sleep_check(void)
+{
+    if (!BlueNRG1_ble::Instance(BLE::DEFAULT_INSTANCE).hasInitialized()) {
+        return SLEEP_STATE_NOTIMER;
+    }
+    return BlueNRG_Stack_Perform_Deep_Sleep_Check();
+}
+
+/**
+* Stack RAM reserved by btle.h against what the port has seen used of it,
+* the GAP and GATT services of aci_gap_init() and aci_gatt_init() included.
+*/
+extern "C" void bluenrg1_stats_ble_get(bluenrg1_stats_ble_t *stats)
+{
+    const BlueNRG1_MemoryUse_t &use = BlueNRG1_GattServer::getInstance().getMemoryUse();
+
+    stats->reserved_size      = BlueNRG_Stack_Init_params.total_buffer_size;
+    stats->packet_size        = BlueNRG_Stack_Init_params.mblockCount;
+    stats->packet_used        = use.txBlocks;
+    stats->packet_max         = (use.txPoolExhausted > 0) ? BlueNRG_Stack_Init_params.mblockCount : use.txBlocksMax;
+    stats->packet_fail_cnt    = use.txPoolExhausted;
+    stats->prepare_write_size = BlueNRG_Stack_Init_params.prWriteListSize;
+    stats->prepare_write_max  = use.prepareWritesMax;
+    stats->att_value_size     = BlueNRG_Stack_Init_params.attrValueArrSize;
+    stats->att_value_used     = DEFAULT_ATT_VALUE_ARRAY_SIZE + use.attValueBytes;
+    stats->attr_size          = BlueNRG_Stack_Init_params.numAttrRecord;
+    stats->attr_used          = DEFAULT_NUM_GATT_ATTRIBUTES + use.attributes;
+    stats->service_size       = BlueNRG_Stack_Init_params.numAttrServ;
+    stats->service_used       = DEFAULT_NUM_GATT_SERVICES + use.services;
+}
+
+extern "C" void bluenrg1_stats_ble_reset(void)
+{
+    BlueNRG1_GattServer::getInstance().resetMemoryPeaks();
+}
@@ -13,6 +13,12 @@
 
 //#include "btle.h"
 
+/* Stack virtual timers [0..3] used by the port */
+#define BLUENRG1_VTIMER_ADV_SCHEDULER   0
+#define BLUENRG1_VTIMER_CONNECT         1
+#define BLUENRG1_VTIMER_CONN_MANAGER    2
+#define BLUENRG1_VTIMER_TELEMETRY       3
+
 class BlueNRG1_ble : public BLEInstanceBase
 {
 public:
@@ -35,15 +41,20 @@ public:
         return BlueNRG1_GattClient::getInstance();
     }
     virtual SecurityManager& getSecurityManager() {
-        return *sm;
+        return BlueNRG1_SecurityManager::getInstance();
     }
     virtual const SecurityManager& getSecurityManager() const {
-        return *sm;
+        return BlueNRG1_SecurityManager::getInstance();
     }
     virtual void        waitForEvent(void);
     
     
     void reset(void);
+
+    void requestStackTick(void);
+    void onVTimerTimeout(uint8_t timerNum);
+
+    static ble_error_t bleStatusToError(uint8_t status);
     
 /*
     uint8_t getUpdaterHardwareVersion(uint8_t *hw_version);
@@ -56,7 +67,14 @@ public:
     
 private:
     bool isInitialized;
-    SecurityManager *sm;
+
+    volatile bool stackTickPending;  /**< BTLE_StackTick() has work to do. */
+    volatile bool eventsSignaled;    /**< The EventQueue has already been woken up. */
+    volatile uint8_t expiredTimers;  /**< Port virtual timers waiting for processEvents(). */
+
+    uint16_t gapServiceHandle;
+    uint16_t devNameCharHandle;
+    uint16_t appearanceCharHandle;
     
     
 public:
@@ -0,0 +1,1896 @@
+/**
+  * Host emulation of the BlueNRG-1 stack library, see BlueNRG1_SimAci.h.
+  */
+#include <string.h>
+
+#include "BlueNRG1_SimAci.h"
+
+#include "ble_status.h"
+#include "bluenrg1_api.h"
+#include "bluenrg1_events.h"
+#include "bluenrg1_stack.h"
+
+/* Sizes of the emulation */
+#define SIM_MAX_LINKS           8
+#define SIM_MAX_SERVICES        16
+#define SIM_MAX_ATTRIBUTES      96
+#define SIM_VALUE_POOL_SIZE     4096
+#define SIM_EVENT_QUEUE_SIZE    64
+#define SIM_TX_QUEUE_SIZE       32
+#define SIM_VTIMERS             4
+#define SIM_ADVERTISERS         8
+#define SIM_MAX_BONDS           8
+
+/* Values of BlueNRG_Stack_Perform_Deep_Sleep_Check() */
+#define SIM_SLEEPMODE_RUNNING   0
+#define SIM_SLEEPMODE_WAKETIMER 2
+#define SIM_SLEEPMODE_NOTIMER   3
+
+/* sysT32 ticks are 2.4414 us: 4096 ticks every 10 ms */
+#define SIM_US_TO_SYST(us)      ((uint32_t)(((uint64_t)(us) * 4096) / 10000))
+#define SIM_SYST_TO_US(t)       (((int64_t)(t) * 10000) / 4096)
+
+#define SIM_DEFAULT_ATT_MTU     23
+#define SIM_ACL_PAYLOAD         27   /* DEFAULT_ATT_MTU + L2CAP header */
+#define SIM_FIRST_CONN_HANDLE   0x0801
+
+/* GATT constants of bluenrg1_gatt_server.h */
+#define SIM_UUID_TYPE_16        0x01
+#define SIM_PROP_NOTIFY         0x10
+#define SIM_PROP_INDICATE       0x20
+#define SIM_UPDATE_NOTIFICATION 0x01
+#define SIM_UPDATE_INDICATION   0x02
+#define SIM_GATT_SERVICE_UUID   0x1801
+#define SIM_GAP_SERVICE_UUID    0x1800
+#define SIM_SERVICE_CHANGED     0x2A05
+#define SIM_DEVICE_NAME         0x2A00
+#define SIM_APPEARANCE          0x2A01
+
+/* Roles of hci_le_connection_complete_event */
+#define SIM_ROLE_MASTER         0x00
+#define SIM_ROLE_SLAVE          0x01
+
+#define SIM_GAP_DIRECT_CONNECTION_PROC  0x40
+#define SIM_GAP_OBSERVATION_PROC        0x80
+
+/* aci_hal_get_link_status() states */
+#define SIM_LINK_STATUS_SLAVE   0x02
+#define SIM_LINK_STATUS_MASTER  0x05
+#define SIM_HAL_LINKS           8
+
+/* aci_hal_set_radio_activity_mask() bits of the connection events */
+#define SIM_ACTIVITY_SLAVE      0x0004
+#define SIM_ACTIVITY_MASTER     0x0020
+
+/* Radio time of a connection event in aci_hal_get_anchor_period(), 0.625 ms units */
+#define SIM_CONN_EVENT_SLOTS    4
+
+/* RSSI of a new link, changed with BlueNRG1_Sim_SetRssi() */
+#define SIM_DEFAULT_RSSI        (-60)
+
+/* Reason of a disconnection requested locally */
+#define SIM_CONN_TERMINATED_LOCAL_HOST  0x16
+
+/* High duty cycle directed advertising gives up after 1.28 s */
+#define SIM_DIRECTED_ADV_US     1280000
+#define SIM_DIRECTED_ADV_TIMEOUT        0x3C
+
+/* Advertising filter policy bit of the connection requests */
+#define SIM_FILTER_CONN_REQS    0x02
+
+/* aci_gap_set_authentication_requirement() values */
+#define SIM_MITM_REQUIRED       0x01
+#define SIM_USE_FIXED_PIN       0x00
+#define SIM_SC_MANDATORY        0x02
+#define SIM_IO_DISPLAY_YES_NO   0x01
+
+/* aci_gap_pairing_complete_event() status and SMP reason of a rejected Numeric Comparison */
+#define SIM_PAIRING_TIMEOUT     0x01
+#define SIM_PAIRING_FAILED      0x02
+#define SIM_NUMERIC_COMPARISON_FAILED   0x0C
+
+/* SMP timeout, for the passkey or the Numeric Comparison answer */
+#define SIM_SMP_TIMEOUT_US      30000000
+
+/* aci_gap_get_security_level() levels of security mode 1 */
+#define SIM_LEVEL_NO_SECURITY   1
+#define SIM_LEVEL_ENCRYPTED     2
+#define SIM_LEVEL_AUTHENTICATED 3
+
+/* privacy_enabled of aci_gap_init() */
+#define SIM_PRIVACY_CONTROLLER  0x02
+
+/* hci_le_set_resolvable_private_address_timeout() range, s */
+#define SIM_RPA_TIMEOUT_MAX     0xA1B8
+
+/* Peer_Address_Type of a resolved peer: identity type + 2 */
+#define SIM_IDENTITY_RESOLVED   0x02
+
+typedef enum {
+    SIM_ATTR_SERVICE,
+    SIM_ATTR_CHAR,
+    SIM_ATTR_VALUE,
+    SIM_ATTR_CCCD,
+    SIM_ATTR_DESC
+} SimAttrKind_t;
+
+typedef struct {
+    uint16_t handle;
+    uint16_t uuid;          /* 16 bit UUID, 0 for 128 bit ones */
+    uint8_t  kind;          /* SimAttrKind_t */
+    uint8_t  properties;    /* Of the characteristic, on its value and CCCD */
+    uint8_t  evtMask;
+    uint16_t maxLength;
+    uint16_t length;
+    uint16_t offset;        /* In valuePool */
+    uint16_t cccd[SIM_MAX_LINKS];
+} SimAttr_t;
+
+typedef struct {
+    uint16_t handle;
+    uint16_t nextHandle;
+    uint16_t endHandle;
+} SimService_t;
+
+typedef struct {
+    uint64_t queuedAt;
+    uint8_t  blocks;
+} SimTxPacket_t;
+
+typedef struct {
+    uint8_t       connected;
+    uint8_t       role;
+    uint16_t      handle;
+    uint8_t       peerAddrType;
+    uint8_t       peerAddr[6];
+    uint16_t      interval;       /* 1.25 ms units */
+    uint16_t      latency;
+    uint16_t      timeout;
+    uint16_t      attMtu;
+    int8_t        rssi;
+    uint64_t      nextEvent;
+    SimTxPacket_t tx[SIM_TX_QUEUE_SIZE];
+    uint8_t       txHead;
+    uint8_t       txCount;
+    uint8_t       txStarved;      /* An update was refused since the last event */
+    uint8_t       terminate;      /* aci_gap_terminate() waiting for the next event */
+    uint8_t       updatePending;  /* Parameters applied on the next event */
+    uint16_t      newInterval;
+    uint16_t      newLatency;
+    uint16_t      newTimeout;
+    uint8_t       l2capPending;   /* L2CAP update request waiting for the answer */
+    uint8_t       level;          /* Security level of mode 1 */
+    uint8_t       passkeyPending; /* Pairing waiting for aci_gap_pass_key_resp() */
+    uint8_t       comparePending; /* Pairing waiting for aci_gap_numeric_comparison_value_confirm_yesno() */
+    uint64_t      smpDeadline;    /* SMP timeout of the pending passkey or Numeric Comparison */
+} SimLink_t;
+
+typedef struct {
+    uint8_t addrType;
+    uint8_t addr[6];
+} SimPeer_t;
+
+typedef enum {
+    SIM_EVT_CONNECTION,
+    SIM_EVT_DISCONNECTION,
+    SIM_EVT_CONN_UPDATE,
+    SIM_EVT_PACKETS_COMPLETED,
+    SIM_EVT_TX_POOL_AVAILABLE,
+    SIM_EVT_ATTR_MODIFIED,
+    SIM_EVT_MTU,
+    SIM_EVT_GATT_PROC_COMPLETE,
+    SIM_EVT_GAP_PROC_COMPLETE,
+    SIM_EVT_ADV_REPORT,
+    SIM_EVT_L2CAP_UPDATE_RESP,
+    SIM_EVT_RADIO_ACTIVITY,
+    SIM_EVT_DIRECTED_ADV_TIMEOUT,
+    SIM_EVT_ENCRYPTION_CHANGE,
+    SIM_EVT_PAIRING_COMPLETE,
+    SIM_EVT_PASS_KEY_REQ,
+    SIM_EVT_NUMERIC_COMPARISON
+} SimEventType_t;
+
+typedef struct {
+    uint8_t  type;        /* SimEventType_t */
+    uint8_t  status;
+    uint16_t conn;
+    uint16_t arg[4];
+    uint8_t  length;
+    uint8_t  data[31];
+} SimEvent_t;
+
+typedef struct {
+    uint8_t addrType;
+    uint8_t addr[6];
+    uint8_t length;
+    uint8_t data[31];
+    int8_t  rssi;
+} SimAdvertiser_t;
+
+static BlueNRG1_SimConfig_t simConfig = {
+    4,                          /* packetsPerEvent */
+    158,                        /* peerMtu */
+    24,                         /* peerInterval, 30 ms */
+    { 0x01, 0x00, 0x00, 0xE1, 0x80, 0x02 }
+};
+static BlueNRG1_SimStats_t  simStats;
+
+static uint64_t        simNow;
+static uint16_t        simMaxAttMtu = SIM_DEFAULT_ATT_MTU;
+static uint8_t         simMaxLinks  = SIM_MAX_LINKS;
+
+static SimService_t    services[SIM_MAX_SERVICES];
+static uint8_t         serviceCount;
+static SimAttr_t       attributes[SIM_MAX_ATTRIBUTES];
+static uint8_t         attributeCount;
+static uint8_t         valuePool[SIM_VALUE_POOL_SIZE];
+static uint16_t        valuePoolUsed;
+
+static SimLink_t       links[SIM_MAX_LINKS];
+static uint16_t        nextConnHandle;
+static uint32_t        txBlocksUsed;
+
+static SimEvent_t      events[SIM_EVENT_QUEUE_SIZE];
+static uint8_t         eventHead;
+static uint8_t         eventCount;
+
+static uint8_t         timerActive[SIM_VTIMERS];
+static uint64_t        timerExpiry[SIM_VTIMERS];
+
+static uint8_t         advertising;
+static uint8_t         scanning;
+static uint8_t         connecting;
+static uint8_t         connectAddr[6];
+static uint8_t         connectAddrType;
+static uint16_t        connectInterval;
+static SimAdvertiser_t advertisers[SIM_ADVERTISERS];
+static uint8_t         advertiserCount;
+static uint16_t        radioActivityMask;
+static uint8_t         advFilterPolicy;
+static SimPeer_t       directedPeer;
+static uint64_t        directedUntil;   /* 0 when not advertising directed */
+static uint8_t         bondingMode;
+static uint8_t         mitmMode;
+static uint8_t         fixedPin;
+static uint8_t         ioCapability;
+static uint8_t         scSupport;
+static SimPeer_t       bonds[SIM_MAX_BONDS];
+static uint8_t         bondCount;
+static SimPeer_t       whiteList[SIM_MAX_BONDS];
+static uint8_t         whiteListCount;
+static uint8_t         controllerPrivacy;
+static uint8_t         addressResolution;
+static SimPeer_t       resolvingList[SIM_MAX_BONDS];
+static uint8_t         resolvingListCount;
+static uint32_t        randState = 0x2545F491;
+
+static uint8_t sim_find_peer(const SimPeer_t *peers, uint8_t count, uint8_t addrType, const uint8_t addr[6]);
+static uint8_t sim_local_rpa(uint8_t addrType, const uint8_t addr[6], uint8_t rpa[6]);
+
+/*
+ * Callbacks of the stack, defined by the application when it needs them
+ */
+#define SIM_WEAK __attribute__((weak))
+
+SIM_WEAK void Blue_Handler(void) {}
+SIM_WEAK void HAL_VTimerTimeoutCallback(uint8_t timerNum) { (void)timerNum; }
+SIM_WEAK void hci_le_connection_complete_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Role,
+                                               uint8_t Peer_Address_Type, uint8_t Peer_Address[6],
+                                               uint16_t Conn_Interval, uint16_t Conn_Latency,
+                                               uint16_t Supervision_Timeout, uint8_t Master_Clock_Accuracy) {}
+SIM_WEAK void hci_le_enhanced_connection_complete_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Role,
+                                                        uint8_t Peer_Address_Type, uint8_t Peer_Address[6],
+                                                        uint8_t Local_Resolvable_Private_Address[6],
+                                                        uint8_t Peer_Resolvable_Private_Address[6],
+                                                        uint16_t Conn_Interval, uint16_t Conn_Latency,
+                                                        uint16_t Supervision_Timeout,
+                                                        uint8_t Master_Clock_Accuracy) {}
+SIM_WEAK void hci_disconnection_complete_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Reason) {}
+SIM_WEAK void hci_le_connection_update_complete_event(uint8_t Status, uint16_t Connection_Handle,
+                                                      uint16_t Conn_Interval, uint16_t Conn_Latency,
+                                                      uint16_t Supervision_Timeout) {}
+SIM_WEAK void hci_number_of_completed_packets_event(uint8_t Number_of_Handles,
+                                                    Handle_Packets_Pair_Entry_t Handle_Packets_Pair_Entry[]) {}
+SIM_WEAK void aci_gatt_tx_pool_available_event(uint16_t Connection_Handle, uint16_t Available_Buffers) {}
+SIM_WEAK void aci_gatt_attribute_modified_event(uint16_t Connection_Handle, uint16_t Attr_Handle, uint16_t Offset,
+                                                uint16_t Attr_Data_Length, uint8_t Attr_Data[]) {}
+SIM_WEAK void aci_att_exchange_mtu_resp_event(uint16_t Connection_Handle, uint16_t Server_RX_MTU) {}
+SIM_WEAK void aci_gatt_proc_complete_event(uint16_t Connection_Handle, uint8_t Error_Code) {}
+SIM_WEAK void aci_gap_proc_complete_event(uint8_t Procedure_Code, uint8_t Status, uint8_t Data_Length,
+                                          uint8_t Data[]) {}
+SIM_WEAK void hci_le_advertising_report_event(uint8_t Num_Reports, Advertising_Report_t Advertising_Report[]) {}
+SIM_WEAK void aci_l2cap_connection_update_resp_event(uint16_t Connection_Handle, uint16_t Result) {}
+SIM_WEAK void aci_hal_end_of_radio_activity_event(uint8_t Last_State, uint8_t Next_State,
+                                                  uint32_t Next_State_SysTime) {}
+SIM_WEAK void hci_encryption_change_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Encryption_Enabled) {}
+SIM_WEAK void aci_gap_pairing_complete_event(uint16_t Connection_Handle, uint8_t Status, uint8_t Reason) {}
+SIM_WEAK void aci_gap_pass_key_req_event(uint16_t Connection_Handle) {}
+SIM_WEAK void aci_gap_bond_lost_event(void) {}
+SIM_WEAK void aci_gap_numeric_comparison_value_event(uint16_t Connection_Handle, uint32_t Numeric_Value) {}
+
+/*
+ * Event queue, emptied by BTLE_StackTick()
+ */
+static SimEvent_t *sim_event(uint8_t type, uint16_t conn, uint8_t status)
+{
+    static SimEvent_t overflow;
+    SimEvent_t *event;
+
+    if (eventCount >= SIM_EVENT_QUEUE_SIZE) {
+        /* The real stack drops events too when its queue is full */
+        return &overflow;
+    }
+
+    event = &events[(eventHead + eventCount) % SIM_EVENT_QUEUE_SIZE];
+    memset(event, 0, sizeof(*event));
+    event->type   = type;
+    event->conn   = conn;
+    event->status = status;
+    eventCount++;
+    if (eventCount > simStats.eventQueuePeak) {
+        simStats.eventQueuePeak = eventCount;
+    }
+
+    return event;
+}
+
+static void sim_dispatch(SimEvent_t *event)
+{
+    switch (event->type) {
+        case SIM_EVT_CONNECTION: {
+            SimLink_t *link = NULL;
+            uint8_t i;
+            for (i = 0; i < SIM_MAX_LINKS; i++) {
+                if (links[i].connected && (links[i].handle == event->conn)) {
+                    link = &links[i];
+                }
+            }
+            if ((link != NULL) && controllerPrivacy) {
+                /* The simulated peers use their identity address, reported as resolved when in the list,
+                   and the controller its resolvable private address for them */
+                uint8_t localRpa[6] = { 0 };
+                uint8_t peerRpa[6]  = { 0 };
+                uint8_t type        = link->peerAddrType;
+                if (addressResolution && sim_local_rpa(link->peerAddrType, link->peerAddr, localRpa)) {
+                    type += SIM_IDENTITY_RESOLVED;
+                }
+                hci_le_enhanced_connection_complete_event(event->status, link->handle, link->role, type,
+                                                          link->peerAddr, localRpa, peerRpa, link->interval,
+                                                          link->latency, link->timeout, 0);
+            } else if (link != NULL) {
+                hci_le_connection_complete_event(event->status, link->handle, link->role, link->peerAddrType,
+                                                 link->peerAddr, link->interval, link->latency, link->timeout, 0);
+            }
+            break;
+        }
+        case SIM_EVT_DISCONNECTION:
+            hci_disconnection_complete_event(event->status, event->conn, (uint8_t)event->arg[0]);
+            break;
+        case SIM_EVT_CONN_UPDATE:
+            hci_le_connection_update_complete_event(event->status, event->conn, event->arg[0], event->arg[1],
+                                                    event->arg[2]);
+            break;
+        case SIM_EVT_PACKETS_COMPLETED: {
+            Handle_Packets_Pair_Entry_t entry;
+            entry.Connection_Handle           = event->conn;
+            entry.HC_Num_Of_Completed_Packets = event->arg[0];
+            hci_number_of_completed_packets_event(1, &entry);
+            break;
+        }
+        case SIM_EVT_TX_POOL_AVAILABLE:
+            aci_gatt_tx_pool_available_event(event->conn, event->arg[0]);
+            break;
+        case SIM_EVT_ATTR_MODIFIED:
+            aci_gatt_attribute_modified_event(event->conn, event->arg[0], 0, event->length, event->data);
+            break;
+        case SIM_EVT_MTU:
+            aci_att_exchange_mtu_resp_event(event->conn, event->arg[0]);
+            break;
+        case SIM_EVT_GATT_PROC_COMPLETE:
+            aci_gatt_proc_complete_event(event->conn, event->status);
+            break;
+        case SIM_EVT_GAP_PROC_COMPLETE:
+            aci_gap_proc_complete_event((uint8_t)event->arg[0], event->status, 0, event->data);
+            break;
+        case SIM_EVT_ADV_REPORT: {
+            Advertising_Report_t report;
+            report.Event_Type   = 0x00;   /* ADV_IND */
+            report.Address_Type = (uint8_t)event->arg[0];
+            memcpy(report.Address, &event->arg[1], 6);
+            report.Length_Data  = event->length;
+            report.Data         = event->data;
+            report.RSSI         = (uint8_t)event->status;
+            hci_le_advertising_report_event(1, &report);
+            break;
+        }
+        case SIM_EVT_L2CAP_UPDATE_RESP:
+            aci_l2cap_connection_update_resp_event(event->conn, event->arg[0]);
+            break;
+        case SIM_EVT_RADIO_ACTIVITY: {
+            /* The next activity is the nearest connection event when delivered */
+            SimLink_t *next = NULL;
+            uint8_t i;
+            for (i = 0; i < SIM_MAX_LINKS; i++) {
+                if (links[i].connected && ((next == NULL) || (links[i].nextEvent < next->nextEvent))) {
+                    next = &links[i];
+                }
+            }
+            if (next == NULL) {
+                aci_hal_end_of_radio_activity_event((uint8_t)event->arg[0], 0x00, 0);
+            } else {
+                aci_hal_end_of_radio_activity_event((uint8_t)event->arg[0],
+                                                    (next->role == SIM_ROLE_MASTER) ? SIM_LINK_STATUS_MASTER
+                                                                                    : SIM_LINK_STATUS_SLAVE,
+                                                    SIM_US_TO_SYST(next->nextEvent));
+            }
+            break;
+        }
+        case SIM_EVT_DIRECTED_ADV_TIMEOUT:
+            hci_le_connection_complete_event(event->status, 0, SIM_ROLE_SLAVE, (uint8_t)event->arg[0], event->data,
+                                             0, 0, 0, 0);
+            break;
+        case SIM_EVT_ENCRYPTION_CHANGE:
+            hci_encryption_change_event(event->status, event->conn, (uint8_t)event->arg[0]);
+            break;
+        case SIM_EVT_PAIRING_COMPLETE:
+            aci_gap_pairing_complete_event(event->conn, event->status, (uint8_t)event->arg[0]);
+            break;
+        case SIM_EVT_PASS_KEY_REQ:
+            aci_gap_pass_key_req_event(event->conn);
+            break;
+        case SIM_EVT_NUMERIC_COMPARISON:
+            aci_gap_numeric_comparison_value_event(event->conn, ((uint32_t)event->arg[1] << 16) | event->arg[0]);
+            break;
+        default:
+            break;
+    }
+}
+
+void BTLE_StackTick(void)
+{
+    /* Events raised by the callbacks wait for the next tick */
+    uint8_t pending = eventCount;
+
+    simStats.stackTicks++;
+    while ((pending > 0) && (eventCount > 0)) {
+        SimEvent_t event = events[eventHead];
+        eventHead = (eventHead + 1) % SIM_EVENT_QUEUE_SIZE;
+        eventCount--;
+        pending--;
+        simStats.eventsDispatched++;
+        sim_dispatch(&event);
+    }
+}
+
+/*
+ * Links
+ */
+static SimLink_t *sim_link(uint16_t handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < SIM_MAX_LINKS; i++) {
+        if (links[i].connected && (links[i].handle == handle)) {
+            return &links[i];
+        }
+    }
+    return NULL;
+}
+
+static SimLink_t *sim_open_link(uint8_t role, uint8_t peerAddrType, const uint8_t peerAddr[6], uint16_t interval)
+{
+    uint8_t i, used = 0;
+
+    for (i = 0; i < SIM_MAX_LINKS; i++) {
+        used += links[i].connected;
+    }
+    if (used >= simMaxLinks) {
+        return NULL;
+    }
+
+    for (i = 0; i < SIM_MAX_LINKS; i++) {
+        if (!links[i].connected) {
+            SimLink_t *link = &links[i];
+            memset(link, 0, sizeof(*link));
+            link->connected    = 1;
+            link->role         = role;
+            link->handle       = nextConnHandle++;
+            link->peerAddrType = peerAddrType;
+            memcpy(link->peerAddr, peerAddr, 6);
+            link->interval     = interval;
+            link->timeout      = 400;   /* 4 s */
+            link->attMtu       = SIM_DEFAULT_ATT_MTU;
+            link->rssi         = SIM_DEFAULT_RSSI;
+            link->nextEvent    = simNow + (uint64_t)interval * 1250;
+            return link;
+        }
+    }
+    return NULL;
+}
+
+static void sim_close_link(SimLink_t *link, uint8_t reason)
+{
+    /* Packets not sent go back to the pool */
+    uint8_t i;
+
+    for (i = 0; i < link->txCount; i++) {
+        txBlocksUsed -= link->tx[(link->txHead + i) % SIM_TX_QUEUE_SIZE].blocks;
+    }
+    link->connected = 0;
+    sim_event(SIM_EVT_DISCONNECTION, link->handle, BLE_STATUS_SUCCESS)->arg[0] = reason;
+}
+
+/* Send what the link has queued, free the blocks and report them, one
+   completed packet per ACL fragment like the controller */
+static void sim_connection_event(SimLink_t *link)
+{
+    uint8_t sent = 0;
+    uint16_t fragments = 0;
+
+    simStats.connectionEvents++;
+
+    if (link->terminate) {
+        sim_close_link(link, SIM_CONN_TERMINATED_LOCAL_HOST);
+        return;
+    }
+    if ((link->passkeyPending || link->comparePending) && (link->smpDeadline <= simNow)) {
+        link->passkeyPending = 0;
+        link->comparePending = 0;
+        sim_event(SIM_EVT_PAIRING_COMPLETE, link->handle, SIM_PAIRING_TIMEOUT)->arg[0] = 0;
+    }
+
+    while ((link->txCount > 0) && (sent < simConfig.packetsPerEvent)) {
+        SimTxPacket_t *packet = &link->tx[link->txHead];
+        uint32_t latency = (uint32_t)(simNow - packet->queuedAt);
+
+        txBlocksUsed -= packet->blocks;
+        fragments += packet->blocks;
+        simStats.notificationsSent++;
+        simStats.latencySumUs += latency;
+        if (latency > simStats.latencyMaxUs) {
+            simStats.latencyMaxUs = latency;
+        }
+        link->txHead = (link->txHead + 1) % SIM_TX_QUEUE_SIZE;
+        link->txCount--;
+        sent++;
+    }
+    if (sent > 0) {
+        sim_event(SIM_EVT_PACKETS_COMPLETED, link->handle, BLE_STATUS_SUCCESS)->arg[0] = fragments;
+        if (link->txStarved) {
+            link->txStarved = 0;
+            sim_event(SIM_EVT_TX_POOL_AVAILABLE, link->handle, BLE_STATUS_SUCCESS)->arg[0] =
+                (uint16_t)(simStats.txPoolBlocks - txBlocksUsed);
+        }
+    }
+
+    if (link->l2capPending) {
+        /* The simulated centrals accept every request */
+        link->l2capPending = 0;
+        sim_event(SIM_EVT_L2CAP_UPDATE_RESP, link->handle, BLE_STATUS_SUCCESS)->arg[0] = 0;
+        link->updatePending = 1;
+    } else if (link->updatePending) {
+        SimEvent_t *event;
+        link->updatePending = 0;
+        link->interval      = link->newInterval;
+        link->latency       = link->newLatency;
+        link->timeout       = link->newTimeout;
+        event = sim_event(SIM_EVT_CONN_UPDATE, link->handle, BLE_STATUS_SUCCESS);
+        event->arg[0] = link->interval;
+        event->arg[1] = link->latency;
+        event->arg[2] = link->timeout;
+    }
+
+    link->nextEvent += (uint64_t)link->interval * 1250;
+
+    if (radioActivityMask & ((link->role == SIM_ROLE_MASTER) ? SIM_ACTIVITY_MASTER : SIM_ACTIVITY_SLAVE)) {
+        sim_event(SIM_EVT_RADIO_ACTIVITY, link->handle, BLE_STATUS_SUCCESS)->arg[0] =
+            (link->role == SIM_ROLE_MASTER) ? SIM_LINK_STATUS_MASTER : SIM_LINK_STATUS_SLAVE;
+    }
+}
+
+/*
+ * Virtual clock
+ */
+uint64_t BlueNRG1_Sim_Now(void)
+{
+    return simNow;
+}
+
+uint64_t BlueNRG1_Sim_NextDeadline(void)
+{
+    uint64_t deadline = UINT64_MAX;
+    uint8_t i;
+
+    for (i = 0; i < SIM_VTIMERS; i++) {
+        if (timerActive[i] && (timerExpiry[i] < deadline)) {
+            deadline = timerExpiry[i];
+        }
+    }
+    for (i = 0; i < SIM_MAX_LINKS; i++) {
+        if (links[i].connected && (links[i].nextEvent < deadline)) {
+            deadline = links[i].nextEvent;
+        }
+    }
+    if ((directedUntil != 0) && (directedUntil < deadline)) {
+        deadline = directedUntil;
+    }
+    if (connecting || (eventCount > 0)) {
+        deadline = simNow;
+    }
+
+    return deadline;
+}
+
+/* A direct connection reaches an advertiser on the next deadline */
+static void sim_try_connect(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < advertiserCount; i++) {
+        if ((advertisers[i].addrType == connectAddrType) && (memcmp(advertisers[i].addr, connectAddr, 6) == 0)) {
+            SimLink_t *link = sim_open_link(SIM_ROLE_MASTER, connectAddrType, connectAddr, connectInterval);
+            connecting = 0;
+            sim_event(SIM_EVT_GAP_PROC_COMPLETE, 0, BLE_STATUS_SUCCESS)->arg[0] = SIM_GAP_DIRECT_CONNECTION_PROC;
+            if (link != NULL) {
+                sim_event(SIM_EVT_CONNECTION, link->handle, BLE_STATUS_SUCCESS);
+            }
+            return;
+        }
+    }
+}
+
+void BlueNRG1_Sim_Advance(uint32_t us)
+{
+    uint64_t target = simNow + us;
+
+    for (;;) {
+        uint64_t deadline = UINT64_MAX;
+        uint8_t  raised = eventCount;
+        uint8_t  i;
+
+        if (connecting) {
+            sim_try_connect();
+        }
+
+        for (i = 0; i < SIM_VTIMERS; i++) {
+            if (timerActive[i] && (timerExpiry[i] < deadline)) {
+                deadline = timerExpiry[i];
+            }
+        }
+        for (i = 0; i < SIM_MAX_LINKS; i++) {
+            if (links[i].connected && (links[i].nextEvent < deadline)) {
+                deadline = links[i].nextEvent;
+            }
+        }
+        if ((directedUntil != 0) && (directedUntil < deadline)) {
+            deadline = directedUntil;
+        }
+        if ((deadline > target) && (eventCount == raised)) {
+            break;
+        }
+        if (deadline <= target) {
+            simNow = deadline;
+        }
+
+        for (i = 0; i < SIM_MAX_LINKS; i++) {
+            if (links[i].connected && (links[i].nextEvent <= simNow)) {
+                sim_connection_event(&links[i]);
+            }
+        }
+        for (i = 0; i < SIM_VTIMERS; i++) {
+            if (timerActive[i] && (timerExpiry[i] <= simNow)) {
+                timerActive[i] = 0;
+                HAL_VTimerTimeoutCallback(i);
+            }
+        }
+        if ((directedUntil != 0) && (directedUntil <= simNow)) {
+            SimEvent_t *event = sim_event(SIM_EVT_DIRECTED_ADV_TIMEOUT, 0, SIM_DIRECTED_ADV_TIMEOUT);
+            event->arg[0] = directedPeer.addrType;
+            memcpy(event->data, directedPeer.addr, 6);
+            directedUntil = 0;
+            advertising   = 0;
+        }
+
+        /* Radio interrupt: the application schedules BTLE_StackTick() */
+        if (eventCount > 0) {
+            Blue_Handler();
+        }
+        if (deadline > target) {
+            break;
+        }
+    }
+
+    simNow = target;
+}
+
+/*
+ * Stack initialization and power management
+ */
+tBleStatus BlueNRG_Stack_Initialization(const BlueNRG_Stack_Initialization_t *BlueNRG_Stack_Init_params_p)
+{
+    memset(services, 0, sizeof(services));
+    memset(attributes, 0, sizeof(attributes));
+    memset(links, 0, sizeof(links));
+    memset(timerActive, 0, sizeof(timerActive));
+    serviceCount   = 0;
+    attributeCount = 0;
+    valuePoolUsed  = 0;
+    txBlocksUsed   = 0;
+    eventHead      = 0;
+    eventCount     = 0;
+    nextConnHandle = SIM_FIRST_CONN_HANDLE;
+    advertising    = 0;
+    scanning       = 0;
+    connecting     = 0;
+    directedUntil  = 0;
+    advFilterPolicy = 0;
+    whiteListCount = 0;
+
+    simMaxAttMtu = BlueNRG_Stack_Init_params_p->attMtu;
+    simMaxLinks  = BlueNRG_Stack_Init_params_p->numOfLinks;
+    if (simMaxLinks > SIM_MAX_LINKS) {
+        simMaxLinks = SIM_MAX_LINKS;
+    }
+    BlueNRG1_Sim_ResetStats();
+    simStats.txPoolBlocks = BlueNRG_Stack_Init_params_p->mblockCount;
+
+    return BLE_STATUS_SUCCESS;
+}
+
+uint8_t BlueNRG_Stack_Perform_Deep_Sleep_Check(void)
+{
+    uint8_t i;
+
+    if (eventCount > 0) {
+        return SIM_SLEEPMODE_RUNNING;
+    }
+    for (i = 0; i < SIM_VTIMERS; i++) {
+        if (timerActive[i]) {
+            return SIM_SLEEPMODE_WAKETIMER;
+        }
+    }
+    for (i = 0; i < SIM_MAX_LINKS; i++) {
+        if (links[i].connected) {
+            return SIM_SLEEPMODE_WAKETIMER;
+        }
+    }
+    return (advertising || scanning) ? SIM_SLEEPMODE_WAKETIMER : SIM_SLEEPMODE_NOTIMER;
+}
+
+void RAL_Isr(void)
+{
+    /* The radio activity already happened in BlueNRG1_Sim_Advance() */
+}
+
+/*
+ * Virtual timers
+ */
+int HAL_VTimerStart_ms(uint8_t timerNum, int32_t msRelTimeout)
+{
+    if (timerNum >= SIM_VTIMERS) {
+        return 1;
+    }
+    timerActive[timerNum] = 1;
+    timerExpiry[timerNum] = simNow + (uint64_t)msRelTimeout * 1000;
+    return 0;
+}
+
+int HAL_VTimerStart_sysT32(uint8_t timerNum, uint32_t time)
+{
+    int64_t delay = SIM_SYST_TO_US((int32_t)(time - SIM_US_TO_SYST(simNow)));
+
+    if (timerNum >= SIM_VTIMERS) {
+        return 1;
+    }
+    timerActive[timerNum] = 1;
+    timerExpiry[timerNum] = simNow + ((delay > 0) ? (uint64_t)delay : 0);
+    return 0;
+}
+
+void HAL_VTimer_Stop(uint8_t timerNum)
+{
+    if (timerNum < SIM_VTIMERS) {
+        timerActive[timerNum] = 0;
+    }
+}
+
+int HAL_VTimerExpiry_sysT32(uint8_t timerNum, uint32_t *sysTime)
+{
+    if ((timerNum >= SIM_VTIMERS) || !timerActive[timerNum]) {
+        return 1;
+    }
+    *sysTime = SIM_US_TO_SYST(timerExpiry[timerNum]);
+    return 0;
+}
+
+uint32_t HAL_VTimerGetCurrentTime_sysT32(void)
+{
+    return SIM_US_TO_SYST(simNow);
+}
+
+uint32_t HAL_VTimerAcc_sysT32_ms(uint32_t sysTime, int32_t msTime)
+{
+    return sysTime + (uint32_t)(((int64_t)msTime * 4096) / 10);
+}
+
+int32_t HAL_VTimerDiff_ms_sysT32(uint32_t sysTime1, uint32_t sysTime2)
+{
+    return (int32_t)(SIM_SYST_TO_US((int32_t)(sysTime1 - sysTime2)) / 1000);
+}
+
+/*
+ * GATT database
+ */
+static SimAttr_t *sim_attr(uint16_t handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < attributeCount; i++) {
+        if (attributes[i].handle == handle) {
+            return &attributes[i];
+        }
+    }
+    return NULL;
+}
+
+static SimService_t *sim_service(uint16_t handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < serviceCount; i++) {
+        if (services[i].handle == handle) {
+            return &services[i];
+        }
+    }
+    return NULL;
+}
+
+static SimAttr_t *sim_new_attr(SimService_t *service, uint8_t kind, uint16_t uuid, uint16_t maxLength)
+{
+    SimAttr_t *attr;
+
+    if ((attributeCount >= SIM_MAX_ATTRIBUTES) || (valuePoolUsed + maxLength > SIM_VALUE_POOL_SIZE)) {
+        return NULL;
+    }
+    if ((service != NULL) && (service->nextHandle > service->endHandle)) {
+        return NULL;
+    }
+
+    attr = &attributes[attributeCount++];
+    memset(attr, 0, sizeof(*attr));
+    attr->handle    = (service != NULL) ? service->nextHandle++ : 0;
+    attr->kind      = kind;
+    attr->uuid      = uuid;
+    attr->maxLength = maxLength;
+    attr->offset    = valuePoolUsed;
+    valuePoolUsed  += maxLength;
+    return attr;
+}
+
+static tBleStatus sim_add_service(uint16_t uuid, uint8_t records, uint16_t *serviceHandle)
+{
+    SimService_t *service;
+    uint16_t first = 1;
+
+    if (serviceCount >= SIM_MAX_SERVICES) {
+        return BLE_STATUS_INSUFFICIENT_RESOURCES;
+    }
+    if (serviceCount > 0) {
+        first = services[serviceCount - 1].endHandle + 1;
+    }
+
+    service = &services[serviceCount++];
+    service->handle     = first;
+    service->nextHandle = first;
+    service->endHandle  = first + records - 1;
+    if (sim_new_attr(service, SIM_ATTR_SERVICE, uuid, 0) == NULL) {
+        return BLE_STATUS_INSUFFICIENT_RESOURCES;
+    }
+    *serviceHandle = service->handle;
+    return BLE_STATUS_SUCCESS;
+}
+
+static tBleStatus sim_add_char(uint16_t serviceHandle, uint16_t uuid, uint16_t maxLength, uint8_t properties,
+                               uint8_t evtMask, uint16_t *charHandle)
+{
+    SimService_t *service = sim_service(serviceHandle);
+    SimAttr_t *decl, *value, *cccd;
+
+    if (service == NULL) {
+        return BLE_STATUS_INVALID_HANDLE;
+    }
+
+    decl  = sim_new_attr(service, SIM_ATTR_CHAR, uuid, 0);
+    value = (decl != NULL) ? sim_new_attr(service, SIM_ATTR_VALUE, uuid, maxLength) : NULL;
+    if (value == NULL) {
+        return BLE_STATUS_OUT_OF_HANDLE;
+    }
+    decl->properties  = properties;
+    value->properties = properties;
+    value->evtMask    = evtMask;
+
+    if (properties & (SIM_PROP_NOTIFY | SIM_PROP_INDICATE)) {
+        cccd = sim_new_attr(service, SIM_ATTR_CCCD, 0x2902, 2);
+        if (cccd == NULL) {
+            return BLE_STATUS_OUT_OF_HANDLE;
+        }
+        cccd->properties = properties;
+        cccd->evtMask    = evtMask;
+        cccd->length     = 2;
+    }
+
+    *charHandle = decl->handle;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_init(void)
+{
+    uint16_t service, charHandle;
+
+    simStats.aciCommands++;
+    sim_add_service(SIM_GATT_SERVICE_UUID, 4, &service);
+    return sim_add_char(service, SIM_SERVICE_CHANGED, 4, SIM_PROP_INDICATE, 0, &charHandle);
+}
+
+tBleStatus aci_gap_init(uint8_t Role, uint8_t privacy_enabled, uint8_t device_name_char_len,
+                        uint16_t *Service_Handle, uint16_t *Dev_Name_Char_Handle, uint16_t *Appearance_Char_Handle)
+{
+    tBleStatus ret;
+
+    (void)Role;
+    simStats.aciCommands++;
+    controllerPrivacy = (privacy_enabled == SIM_PRIVACY_CONTROLLER);
+
+    ret = sim_add_service(SIM_GAP_SERVICE_UUID, 8, Service_Handle);
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = sim_add_char(*Service_Handle, SIM_DEVICE_NAME, device_name_char_len, 0x02, 0, Dev_Name_Char_Handle);
+    }
+    if (ret == BLE_STATUS_SUCCESS) {
+        ret = sim_add_char(*Service_Handle, SIM_APPEARANCE, 2, 0x02, 0, Appearance_Char_Handle);
+    }
+    return ret;
+}
+
+tBleStatus aci_gatt_add_service(uint8_t Service_UUID_Type, Service_UUID_t *Service_UUID, uint8_t Service_Type,
+                                uint8_t Max_Attribute_Records, uint16_t *Service_Handle)
+{
+    (void)Service_Type;
+    simStats.aciCommands++;
+
+    return sim_add_service((Service_UUID_Type == SIM_UUID_TYPE_16) ? Service_UUID->Service_UUID_16 : 0,
+                           Max_Attribute_Records, Service_Handle);
+}
+
+tBleStatus aci_gatt_add_char(uint16_t Service_Handle, uint8_t Char_UUID_Type, Char_UUID_t *Char_UUID,
+                             uint16_t Char_Value_Length, uint8_t Char_Properties, uint8_t Security_Permissions,
+                             uint8_t GATT_Evt_Mask, uint8_t Enc_Key_Size, uint8_t Is_Variable, uint16_t *Char_Handle)
+{
+    (void)Security_Permissions;
+    (void)Enc_Key_Size;
+    (void)Is_Variable;
+    simStats.aciCommands++;
+
+    return sim_add_char(Service_Handle, (Char_UUID_Type == SIM_UUID_TYPE_16) ? Char_UUID->Char_UUID_16 : 0,
+                        Char_Value_Length, Char_Properties, GATT_Evt_Mask, Char_Handle);
+}
+
+tBleStatus aci_gatt_add_char_desc(uint16_t Service_Handle, uint16_t Char_Handle, uint8_t Char_Desc_Uuid_Type,
+                                  Char_Desc_Uuid_t *Char_Desc_Uuid, uint8_t Char_Desc_Value_Max_Len,
+                                  uint8_t Char_Desc_Value_Length, uint8_t Char_Desc_Value[],
+                                  uint8_t Security_Permissions, uint8_t Access_Permissions, uint8_t GATT_Evt_Mask,
+                                  uint8_t Enc_Key_Size, uint8_t Is_Variable, uint16_t *Char_Desc_Handle)
+{
+    SimService_t *service = sim_service(Service_Handle);
+    SimAttr_t *desc;
+
+    (void)Char_Handle;
+    (void)Security_Permissions;
+    (void)Access_Permissions;
+    (void)Enc_Key_Size;
+    (void)Is_Variable;
+    simStats.aciCommands++;
+
+    if (service == NULL) {
+        return BLE_STATUS_INVALID_HANDLE;
+    }
+    desc = sim_new_attr(service, SIM_ATTR_DESC,
+                        (Char_Desc_Uuid_Type == SIM_UUID_TYPE_16) ? Char_Desc_Uuid->Char_UUID_16 : 0,
+                        Char_Desc_Value_Max_Len);
+    if (desc == NULL) {
+        return BLE_STATUS_OUT_OF_HANDLE;
+    }
+    desc->evtMask = GATT_Evt_Mask;
+    desc->length  = (Char_Desc_Value_Length < Char_Desc_Value_Max_Len) ? Char_Desc_Value_Length : Char_Desc_Value_Max_Len;
+    memcpy(&valuePool[desc->offset], Char_Desc_Value, desc->length);
+
+    *Char_Desc_Handle = desc->handle;
+    return BLE_STATUS_SUCCESS;
+}
+
+static tBleStatus sim_set_value(SimAttr_t *attr, uint16_t offset, uint16_t length, const uint8_t *value,
+                                uint16_t totalLength)
+{
+    if ((uint32_t)offset + length > attr->maxLength) {
+        return BLE_STATUS_INVALID_PARAMS;
+    }
+    memcpy(&valuePool[attr->offset + offset], value, length);
+    attr->length = (totalLength > attr->maxLength) ? attr->maxLength : totalLength;
+    return BLE_STATUS_SUCCESS;
+}
+
+/* Queue one notification or indication on a link, taking blocks from the TX pool */
+static tBleStatus sim_send(SimLink_t *link, uint16_t length)
+{
+    uint16_t pdu = (length > link->attMtu - 3) ? link->attMtu : (uint16_t)(length + 3);
+    uint8_t blocks = (uint8_t)((pdu + 4 + SIM_ACL_PAYLOAD - 1) / SIM_ACL_PAYLOAD);
+    SimTxPacket_t *packet;
+
+    if ((txBlocksUsed + blocks > simStats.txPoolBlocks) || (link->txCount >= SIM_TX_QUEUE_SIZE)) {
+        link->txStarved = 1;
+        simStats.txPoolRejects++;
+        return BLE_STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    packet = &link->tx[(link->txHead + link->txCount) % SIM_TX_QUEUE_SIZE];
+    packet->queuedAt = simNow;
+    packet->blocks   = blocks;
+    link->txCount++;
+    txBlocksUsed += blocks;
+    if (txBlocksUsed > simStats.txPoolPeak) {
+        simStats.txPoolPeak = txBlocksUsed;
+    }
+    simStats.notificationsQueued++;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_update_char_value_ext(uint16_t Conn_Handle_To_Notify, uint16_t Service_Handle,
+                                          uint16_t Char_Handle, uint8_t Update_Type, uint16_t Char_Length,
+                                          uint16_t Value_Offset, uint8_t Value_Length, uint8_t Value[])
+{
+    SimAttr_t *value = sim_attr(Char_Handle + 1);
+    SimAttr_t *cccd  = sim_attr(Char_Handle + 2);
+    tBleStatus ret;
+    uint8_t i;
+
+    (void)Service_Handle;
+    simStats.aciCommands++;
+
+    if ((value == NULL) || (value->kind != SIM_ATTR_VALUE)) {
+        return BLE_STATUS_INVALID_HANDLE;
+    }
+    ret = sim_set_value(value, Value_Offset, Value_Length, Value, Char_Length);
+    if ((ret != BLE_STATUS_SUCCESS) || (Update_Type == 0) ||
+        (cccd == NULL) || (cccd->kind != SIM_ATTR_CCCD)) {
+        return ret;
+    }
+
+    for (i = 0; i < SIM_MAX_LINKS; i++) {
+        SimLink_t *link = &links[i];
+        uint16_t enabled = cccd->cccd[i] & (SIM_UPDATE_NOTIFICATION | SIM_UPDATE_INDICATION) & Update_Type;
+
+        if (!link->connected || !enabled ||
+            ((Conn_Handle_To_Notify != 0) && (Conn_Handle_To_Notify != link->handle))) {
+            continue;
+        }
+        ret = sim_send(link, Char_Length);
+        if (ret != BLE_STATUS_SUCCESS) {
+            return ret;
+        }
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_update_char_value(uint16_t Service_Handle, uint16_t Char_Handle, uint8_t Val_Offset,
+                                      uint8_t Char_Value_Length, uint8_t Char_Value[])
+{
+    return aci_gatt_update_char_value_ext(0, Service_Handle, Char_Handle,
+                                          SIM_UPDATE_NOTIFICATION | SIM_UPDATE_INDICATION,
+                                          Val_Offset + Char_Value_Length, Val_Offset, Char_Value_Length, Char_Value);
+}
+
+tBleStatus aci_gatt_set_desc_value(uint16_t Serv_Handle, uint16_t Char_Handle, uint16_t Char_Desc_Handle,
+                                   uint16_t Val_Offset, uint8_t Char_Desc_Value_Length, uint8_t Char_Desc_Value[])
+{
+    SimAttr_t *desc = sim_attr(Char_Desc_Handle);
+
+    (void)Serv_Handle;
+    (void)Char_Handle;
+    simStats.aciCommands++;
+
+    if (desc == NULL) {
+        return BLE_STATUS_INVALID_HANDLE;
+    }
+    return sim_set_value(desc, Val_Offset, Char_Desc_Value_Length, Char_Desc_Value,
+                         Val_Offset + Char_Desc_Value_Length);
+}
+
+tBleStatus aci_gatt_read_handle_value(uint16_t Attr_Handle, uint16_t Offset, uint16_t Value_Length_Requested,
+                                      uint16_t *Length, uint16_t *Value_Length, uint8_t Value[])
+{
+    SimAttr_t *attr = sim_attr(Attr_Handle);
+    uint16_t count;
+
+    simStats.aciCommands++;
+
+    if (attr == NULL) {
+        return BLE_STATUS_INVALID_HANDLE;
+    }
+    count = (Offset < attr->length) ? (uint16_t)(attr->length - Offset) : 0;
+    if (count > Value_Length_Requested) {
+        count = Value_Length_Requested;
+    }
+    memcpy(Value, &valuePool[attr->offset + Offset], count);
+    *Length       = count;
+    *Value_Length = attr->length;
+    return BLE_STATUS_SUCCESS;
+}
+
+/*
+ * GAP
+ */
+tBleStatus hci_read_bd_addr(uint8_t BD_ADDR[6])
+{
+    simStats.aciCommands++;
+    memcpy(BD_ADDR, simConfig.bdAddr, 6);
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_set_discoverable(uint8_t Advertising_Type, uint16_t Advertising_Interval_Min,
+                                    uint16_t Advertising_Interval_Max, uint8_t Own_Address_Type,
+                                    uint8_t Advertising_Filter_Policy, uint8_t Local_Name_Length,
+                                    uint8_t Local_Name[], uint8_t Service_Uuid_length, uint8_t Service_Uuid_List[],
+                                    uint16_t Slave_Conn_Interval_Min, uint16_t Slave_Conn_Interval_Max)
+{
+    simStats.aciCommands++;
+    advertising     = 1;
+    advFilterPolicy = Advertising_Filter_Policy;
+    directedUntil   = 0;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_set_direct_connectable(uint8_t Own_Address_Type, uint8_t Directed_Advertising_Type,
+                                          uint8_t Direct_Address_Type, uint8_t Direct_Address[6],
+                                          uint16_t Advertising_Interval_Min, uint16_t Advertising_Interval_Max)
+{
+    simStats.aciCommands++;
+    if (advertising) {
+        return BLE_STATUS_NOT_ALLOWED;
+    }
+    advertising           = 1;
+    advFilterPolicy       = 0;
+    directedPeer.addrType = Direct_Address_Type;
+    memcpy(directedPeer.addr, Direct_Address, 6);
+    directedUntil         = simNow + SIM_DIRECTED_ADV_US;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_set_non_discoverable(void)
+{
+    simStats.aciCommands++;
+    advertising   = 0;
+    directedUntil = 0;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_update_adv_data(uint8_t AdvDataLen, uint8_t AdvData[])
+{
+    simStats.aciCommands++;
+    return (AdvDataLen <= 31) ? BLE_STATUS_SUCCESS : BLE_STATUS_INVALID_PARAMS;
+}
+
+tBleStatus aci_gap_delete_ad_type(uint8_t ADType)
+{
+    (void)ADType;
+    simStats.aciCommands++;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_set_scan_response_data(uint8_t Scan_Response_Data_Length, uint8_t Scan_Response_Data[31])
+{
+    (void)Scan_Response_Data;
+    simStats.aciCommands++;
+    return (Scan_Response_Data_Length <= 31) ? BLE_STATUS_SUCCESS : BLE_STATUS_INVALID_PARAMS;
+}
+
+tBleStatus aci_gap_start_observation_proc(uint16_t LE_Scan_Interval, uint16_t LE_Scan_Window, uint8_t LE_Scan_Type,
+                                          uint8_t Own_Address_Type, uint8_t Filter_Duplicates,
+                                          uint8_t Scanning_Filter_Policy)
+{
+    uint8_t i;
+
+    simStats.aciCommands++;
+    if (scanning || connecting) {
+        return BLE_STATUS_NOT_ALLOWED;
+    }
+    scanning = 1;
+
+    for (i = 0; i < advertiserCount; i++) {
+        SimEvent_t *event = sim_event(SIM_EVT_ADV_REPORT, 0, (uint8_t)advertisers[i].rssi);
+        event->arg[0] = advertisers[i].addrType;
+        memcpy(&event->arg[1], advertisers[i].addr, 6);
+        event->length = advertisers[i].length;
+        memcpy(event->data, advertisers[i].data, advertisers[i].length);
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_create_connection(uint16_t LE_Scan_Interval, uint16_t LE_Scan_Window, uint8_t Peer_Address_Type,
+                                     uint8_t Peer_Address[6], uint8_t Own_Address_Type, uint16_t Conn_Interval_Min,
+                                     uint16_t Conn_Interval_Max, uint16_t Conn_Latency, uint16_t Supervision_Timeout,
+                                     uint16_t Minimum_CE_Length, uint16_t Maximum_CE_Length)
+{
+    simStats.aciCommands++;
+    if (scanning || connecting) {
+        return BLE_STATUS_NOT_ALLOWED;
+    }
+    connecting      = 1;
+    connectAddrType = Peer_Address_Type;
+    memcpy(connectAddr, Peer_Address, 6);
+    connectInterval = Conn_Interval_Max;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_terminate_gap_proc(uint8_t Procedure_Code)
+{
+    simStats.aciCommands++;
+
+    if ((Procedure_Code == SIM_GAP_OBSERVATION_PROC) && scanning) {
+        scanning = 0;
+    } else if ((Procedure_Code == SIM_GAP_DIRECT_CONNECTION_PROC) && connecting) {
+        connecting = 0;
+    } else {
+        return BLE_STATUS_NOT_ALLOWED;
+    }
+    sim_event(SIM_EVT_GAP_PROC_COMPLETE, 0, BLE_STATUS_SUCCESS)->arg[0] = Procedure_Code;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_terminate(uint16_t Connection_Handle, uint8_t Reason)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    (void)Reason;
+    simStats.aciCommands++;
+    if (link == NULL) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    link->terminate = 1;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_start_connection_update(uint16_t Connection_Handle, uint16_t Conn_Interval_Min,
+                                           uint16_t Conn_Interval_Max, uint16_t Conn_Latency,
+                                           uint16_t Supervision_Timeout, uint16_t Minimum_CE_Length,
+                                           uint16_t Maximum_CE_Length)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    simStats.aciCommands++;
+    if ((link == NULL) || (link->role != SIM_ROLE_MASTER)) {
+        return BLE_STATUS_NOT_ALLOWED;
+    }
+    if (link->updatePending) {
+        return BLE_STATUS_BUSY;
+    }
+    link->updatePending = 1;
+    link->newInterval   = Conn_Interval_Max;
+    link->newLatency    = Conn_Latency;
+    link->newTimeout    = Supervision_Timeout;
+    return BLE_STATUS_SUCCESS;
+}
+
+/*
+ * Link quality
+ */
+tBleStatus hci_read_rssi(uint16_t Connection_Handle, uint8_t *RSSI)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    simStats.aciCommands++;
+    if (link == NULL) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    *RSSI = (uint8_t)link->rssi;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_read_channel_map(uint16_t Connection_Handle, uint8_t LE_Channel_Map[5])
+{
+    simStats.aciCommands++;
+    if (sim_link(Connection_Handle) == NULL) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    /* The 37 data channels */
+    memset(LE_Channel_Map, 0xFF, 4);
+    LE_Channel_Map[4] = 0x1F;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_hal_get_link_status(uint8_t Link_Status[8], uint16_t Link_Connection_Handle[16 / 2])
+{
+    uint8_t i;
+
+    simStats.aciCommands++;
+    memset(Link_Status, 0, SIM_HAL_LINKS);
+    memset(Link_Connection_Handle, 0, SIM_HAL_LINKS * sizeof(uint16_t));
+    for (i = 0; (i < SIM_MAX_LINKS) && (i < SIM_HAL_LINKS); i++) {
+        if (links[i].connected) {
+            Link_Status[i] = (links[i].role == SIM_ROLE_MASTER) ? SIM_LINK_STATUS_MASTER : SIM_LINK_STATUS_SLAVE;
+            Link_Connection_Handle[i] = links[i].handle;
+        }
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_hal_set_tx_power_level(uint8_t En_High_Power, uint8_t PA_Level)
+{
+    simStats.aciCommands++;
+    return ((En_High_Power <= 1) && (PA_Level <= 7)) ? BLE_STATUS_SUCCESS : BLE_STATUS_INVALID_PARAMS;
+}
+
+tBleStatus aci_hal_set_radio_activity_mask(uint16_t Radio_Activity_Mask)
+{
+    simStats.aciCommands++;
+    radioActivityMask = Radio_Activity_Mask;
+    return BLE_STATUS_SUCCESS;
+}
+
+/* The shortest interval of the links, each link taking a slot of SIM_CONN_EVENT_SLOTS in it */
+tBleStatus aci_hal_get_anchor_period(uint32_t *Anchor_Period, uint32_t *Max_Free_Slot)
+{
+    uint32_t period = 0;
+    uint32_t used = 0;
+    uint8_t  i;
+
+    simStats.aciCommands++;
+    for (i = 0; i < SIM_MAX_LINKS; i++) {
+        if (links[i].connected) {
+            uint32_t interval = (uint32_t)links[i].interval * 2;   /* 0.625 ms units */
+            if ((period == 0) || (interval < period)) {
+                period = interval;
+            }
+            used += SIM_CONN_EVENT_SLOTS;
+        }
+    }
+    *Anchor_Period = period;
+    *Max_Free_Slot = (period > used) ? (period - used) : 0;
+    return BLE_STATUS_SUCCESS;
+}
+
+/*
+ * Security manager, the bonds are kept until aci_gap_clear_security_db()
+ */
+static uint8_t sim_find_peer(const SimPeer_t *peers, uint8_t count, uint8_t addrType, const uint8_t addr[6])
+{
+    uint8_t i;
+
+    for (i = 0; i < count; i++) {
+        if ((peers[i].addrType == addrType) && (memcmp(peers[i].addr, addr, 6) == 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Encrypt the link, the peer stores the keys when bonding */
+static void sim_pair(SimLink_t *link)
+{
+    link->level = mitmMode ? SIM_LEVEL_AUTHENTICATED : SIM_LEVEL_ENCRYPTED;
+    sim_event(SIM_EVT_ENCRYPTION_CHANGE, link->handle, BLE_STATUS_SUCCESS)->arg[0] = 1;
+    sim_event(SIM_EVT_PAIRING_COMPLETE, link->handle, BLE_STATUS_SUCCESS);
+    if (bondingMode && (bondCount < SIM_MAX_BONDS) &&
+        !sim_find_peer(bonds, bondCount, link->peerAddrType, link->peerAddr)) {
+        bonds[bondCount].addrType = link->peerAddrType;
+        memcpy(bonds[bondCount].addr, link->peerAddr, 6);
+        bondCount++;
+    }
+}
+
+/* A bonded peer encrypts at once, the others pair, under MITM protection with a Numeric Comparison
+   when both sides can display yes/no with Secure Connections, with a passkey otherwise */
+static tBleStatus sim_secure(uint16_t handle)
+{
+    SimLink_t *link = sim_link(handle);
+
+    if (link == NULL) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    if (link->passkeyPending || link->comparePending) {
+        return BLE_STATUS_BUSY;
+    }
+
+    if (sim_find_peer(bonds, bondCount, link->peerAddrType, link->peerAddr)) {
+        link->level = mitmMode ? SIM_LEVEL_AUTHENTICATED : SIM_LEVEL_ENCRYPTED;
+        sim_event(SIM_EVT_ENCRYPTION_CHANGE, link->handle, BLE_STATUS_SUCCESS)->arg[0] = 1;
+    } else if (mitmMode && scSupport && (ioCapability == SIM_IO_DISPLAY_YES_NO)) {
+        uint32_t   value;
+        SimEvent_t *event;
+        randState = (randState * 1103515245) + 12345;
+        value = (randState >> 8) % 1000000;
+        link->comparePending = 1;
+        link->smpDeadline    = simNow + SIM_SMP_TIMEOUT_US;
+        event = sim_event(SIM_EVT_NUMERIC_COMPARISON, link->handle, BLE_STATUS_SUCCESS);
+        event->arg[0] = (uint16_t)value;
+        event->arg[1] = (uint16_t)(value >> 16);
+    } else if (mitmMode && !fixedPin) {
+        link->passkeyPending = 1;
+        link->smpDeadline    = simNow + SIM_SMP_TIMEOUT_US;
+        sim_event(SIM_EVT_PASS_KEY_REQ, link->handle, BLE_STATUS_SUCCESS);
+    } else {
+        sim_pair(link);
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_set_io_capability(uint8_t IO_Capability)
+{
+    simStats.aciCommands++;
+    if (IO_Capability > 0x04) {
+        return BLE_STATUS_INVALID_PARAMS;
+    }
+    ioCapability = IO_Capability;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_set_authentication_requirement(uint8_t Bonding_Mode, uint8_t MITM_Mode, uint8_t SC_Support,
+                                                  uint8_t KeyPress_Notification_Support,
+                                                  uint8_t Min_Encryption_Key_Size,
+                                                  uint8_t Max_Encryption_Key_Size, uint8_t Use_Fixed_Pin,
+                                                  uint32_t Fixed_Pin, uint8_t Identity_Address_Type)
+{
+    simStats.aciCommands++;
+    if ((Min_Encryption_Key_Size < 7) || (Max_Encryption_Key_Size > 16) ||
+        (Min_Encryption_Key_Size > Max_Encryption_Key_Size) || (Fixed_Pin > 999999) ||
+        (SC_Support > SIM_SC_MANDATORY)) {
+        return BLE_STATUS_INVALID_PARAMS;
+    }
+    bondingMode = Bonding_Mode;
+    mitmMode    = (MITM_Mode == SIM_MITM_REQUIRED);
+    fixedPin    = (Use_Fixed_Pin == SIM_USE_FIXED_PIN);
+    scSupport   = (SC_Support != 0);
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_slave_security_req(uint16_t Connection_Handle)
+{
+    simStats.aciCommands++;
+    return sim_secure(Connection_Handle);
+}
+
+tBleStatus aci_gap_send_pairing_req(uint16_t Connection_Handle, uint8_t Force_Rebond)
+{
+    (void)Force_Rebond;
+    simStats.aciCommands++;
+    return sim_secure(Connection_Handle);
+}
+
+tBleStatus aci_gap_pass_key_resp(uint16_t Connection_Handle, uint32_t Pass_Key)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    simStats.aciCommands++;
+    if ((link == NULL) || !link->passkeyPending || (Pass_Key > 999999)) {
+        return BLE_STATUS_INVALID_PARAMS;
+    }
+    /* The simulated peers always enter the passkey right */
+    link->passkeyPending = 0;
+    sim_pair(link);
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_numeric_comparison_value_confirm_yesno(uint16_t Connection_Handle, uint8_t Confirm_Yes_No)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    simStats.aciCommands++;
+    if ((link == NULL) || !link->comparePending) {
+        return BLE_STATUS_INVALID_PARAMS;
+    }
+    link->comparePending = 0;
+    if (Confirm_Yes_No) {
+        sim_pair(link);
+    } else {
+        sim_event(SIM_EVT_PAIRING_COMPLETE, link->handle, SIM_PAIRING_FAILED)->arg[0] = SIM_NUMERIC_COMPARISON_FAILED;
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_allow_rebond(uint16_t Connection_Handle)
+{
+    simStats.aciCommands++;
+    return (sim_link(Connection_Handle) != NULL) ? BLE_STATUS_SUCCESS : ERR_UNKNOWN_CONN_IDENTIFIER;
+}
+
+tBleStatus aci_gap_get_security_level(uint16_t Connection_Handle, uint8_t *Security_Mode, uint8_t *Security_Level)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    simStats.aciCommands++;
+    if (link == NULL) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    *Security_Mode  = 1;
+    *Security_Level = (link->level != 0) ? link->level : SIM_LEVEL_NO_SECURITY;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_clear_security_db(void)
+{
+    simStats.aciCommands++;
+    bondCount = 0;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_get_bonded_devices(uint8_t *Num_of_Addresses, Bonded_Device_Entry_t Bonded_Device_Entry[])
+{
+    uint8_t i;
+
+    simStats.aciCommands++;
+    for (i = 0; i < bondCount; i++) {
+        Bonded_Device_Entry[i].Address_Type = bonds[i].addrType;
+        memcpy(Bonded_Device_Entry[i].Address, bonds[i].addr, 6);
+    }
+    *Num_of_Addresses = bondCount;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_is_device_bonded(uint8_t Peer_Address_Type, uint8_t Peer_Address[6])
+{
+    simStats.aciCommands++;
+    return sim_find_peer(bonds, bondCount, Peer_Address_Type, Peer_Address) ? BLE_STATUS_SUCCESS
+                                                                           : BLE_STATUS_DEV_NOT_BONDED;
+}
+
+tBleStatus aci_gap_configure_whitelist(void)
+{
+    uint8_t i;
+
+    simStats.aciCommands++;
+    if (bondCount == 0) {
+        return BLE_STATUS_FAILED;
+    }
+    for (i = 0; i < bondCount; i++) {
+        if (!sim_find_peer(whiteList, whiteListCount, bonds[i].addrType, bonds[i].addr)) {
+            whiteList[whiteListCount++] = bonds[i];
+        }
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_clear_white_list(void)
+{
+    simStats.aciCommands++;
+    if (advertising && (advFilterPolicy != 0)) {
+        return ERR_COMMAND_DISALLOWED;
+    }
+    whiteListCount = 0;
+    return BLE_STATUS_SUCCESS;
+}
+
+/* The resolving list only changes with the address resolution disabled or the radio idle */
+static uint8_t sim_resolving_list_locked(void)
+{
+    return addressResolution && (advertising || scanning || connecting);
+}
+
+tBleStatus aci_gap_add_devices_to_resolving_list(uint8_t Num_of_Resolving_list_Entries,
+                                                 Whitelist_Identity_Entry_t Whitelist_Identity_Entry[],
+                                                 uint8_t Clear_Resolving_List)
+{
+    uint8_t i;
+
+    simStats.aciCommands++;
+    if (!controllerPrivacy || sim_resolving_list_locked()) {
+        return ERR_COMMAND_DISALLOWED;
+    }
+    if (Clear_Resolving_List) {
+        resolvingListCount = 0;
+    }
+    for (i = 0; i < Num_of_Resolving_list_Entries; i++) {
+        Whitelist_Identity_Entry_t *entry = &Whitelist_Identity_Entry[i];
+        /* The IRK comes from the security database */
+        if (!sim_find_peer(bonds, bondCount, entry->Peer_Identity_Address_Type, entry->Peer_Identity_Address)) {
+            return BLE_STATUS_DEV_NOT_BONDED;
+        }
+        if (sim_find_peer(resolvingList, resolvingListCount, entry->Peer_Identity_Address_Type,
+                          entry->Peer_Identity_Address)) {
+            continue;
+        }
+        if (resolvingListCount >= SIM_MAX_BONDS) {
+            return BLE_STATUS_INSUFFICIENT_RESOURCES;
+        }
+        resolvingList[resolvingListCount].addrType = entry->Peer_Identity_Address_Type;
+        memcpy(resolvingList[resolvingListCount].addr, entry->Peer_Identity_Address, 6);
+        resolvingListCount++;
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+/* Resolvable private address for a peer of the resolving list: the public
+   address with the two top bits set to 01, the same until the list changes */
+static uint8_t sim_local_rpa(uint8_t addrType, const uint8_t addr[6], uint8_t rpa[6])
+{
+    if (!sim_find_peer(resolvingList, resolvingListCount, addrType, addr)) {
+        return 0;
+    }
+    memcpy(rpa, simConfig.bdAddr, 6);
+    rpa[5] = (rpa[5] & 0x3F) | 0x40;
+    return 1;
+}
+
+tBleStatus hci_le_read_local_resolvable_address(uint8_t Peer_Identity_Address_Type,
+                                                uint8_t Peer_Identity_Address[6],
+                                                uint8_t Local_Resolvable_Address[6])
+{
+    simStats.aciCommands++;
+    if (!controllerPrivacy || !sim_local_rpa(Peer_Identity_Address_Type, Peer_Identity_Address,
+                                             Local_Resolvable_Address)) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_clear_resolving_list(void)
+{
+    simStats.aciCommands++;
+    if (sim_resolving_list_locked()) {
+        return ERR_COMMAND_DISALLOWED;
+    }
+    resolvingListCount = 0;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_set_address_resolution_enable(uint8_t Address_Resolution_Enable)
+{
+    simStats.aciCommands++;
+    if (advertising || scanning || connecting) {
+        return ERR_COMMAND_DISALLOWED;
+    }
+    addressResolution = (Address_Resolution_Enable != 0);
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_set_resolvable_private_address_timeout(uint16_t RPA_Timeout)
+{
+    simStats.aciCommands++;
+    if ((RPA_Timeout == 0) || (RPA_Timeout > SIM_RPA_TIMEOUT_MAX)) {
+        return BLE_STATUS_INVALID_PARAMS;
+    }
+    /* The simulated peers do not look at our address, it is not rotated */
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_rand(uint8_t Random_Number[8])
+{
+    uint8_t i;
+
+    simStats.aciCommands++;
+    for (i = 0; i < 8; i++) {
+        randState = (randState * 1103515245) + 12345;
+        Random_Number[i] = (uint8_t)(randState >> 16);
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+/*
+ * L2CAP
+ */
+tBleStatus aci_l2cap_connection_parameter_update_req(uint16_t Connection_Handle, uint16_t Conn_Interval_Min,
+                                                     uint16_t Conn_Interval_Max, uint16_t Slave_latency,
+                                                     uint16_t Timeout_Multiplier)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    simStats.aciCommands++;
+    if ((link == NULL) || (link->role != SIM_ROLE_SLAVE)) {
+        return BLE_STATUS_NOT_ALLOWED;
+    }
+    if (link->l2capPending || link->updatePending) {
+        return BLE_STATUS_BUSY;
+    }
+    link->l2capPending = 1;
+    link->newInterval  = Conn_Interval_Max;
+    link->newLatency   = Slave_latency;
+    link->newTimeout   = Timeout_Multiplier;
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_l2cap_connection_parameter_update_resp(uint16_t Connection_Handle, uint16_t Conn_Interval_Min,
+                                                      uint16_t Conn_Interval_Max, uint16_t Slave_latency,
+                                                      uint16_t Timeout_Multiplier, uint16_t Minimum_CE_Length,
+                                                      uint16_t Maximum_CE_Length, uint8_t Identifier,
+                                                      uint8_t Accept)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+
+    simStats.aciCommands++;
+    if (link == NULL) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    if (Accept) {
+        link->updatePending = 1;
+        link->newInterval   = Conn_Interval_Max;
+        link->newLatency    = Slave_latency;
+        link->newTimeout    = Timeout_Multiplier;
+    }
+    return BLE_STATUS_SUCCESS;
+}
+
+/*
+ * GATT client, towards peers without database
+ */
+static tBleStatus sim_client_procedure(uint16_t connHandle)
+{
+    simStats.aciCommands++;
+    if (sim_link(connHandle) == NULL) {
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    sim_event(SIM_EVT_GATT_PROC_COMPLETE, connHandle, BLE_STATUS_SUCCESS);
+    return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_exchange_config(uint16_t Connection_Handle)
+{
+    SimLink_t *link = sim_link(Connection_Handle);
+    uint16_t mtu = (simConfig.peerMtu < simMaxAttMtu) ? simConfig.peerMtu : simMaxAttMtu;
+
+    if (link == NULL) {
+        simStats.aciCommands++;
+        return ERR_UNKNOWN_CONN_IDENTIFIER;
+    }
+    link->attMtu = mtu;
+    sim_event(SIM_EVT_MTU, Connection_Handle, BLE_STATUS_SUCCESS)->arg[0] = mtu;
+    return sim_client_procedure(Connection_Handle);
+}
+
+tBleStatus aci_gatt_disc_primary_service_by_uuid(uint16_t Connection_Handle, uint8_t UUID_Type, UUID_t *UUID)
+{
+    return sim_client_procedure(Connection_Handle);
+}
+
+tBleStatus aci_gatt_disc_char_by_uuid(uint16_t Connection_Handle, uint16_t Start_Handle, uint16_t End_Handle,
+                                      uint8_t UUID_Type, UUID_t *UUID)
+{
+    return sim_client_procedure(Connection_Handle);
+}
+
+tBleStatus aci_gatt_disc_all_char_desc(uint16_t Connection_Handle, uint16_t Char_Handle, uint16_t End_Handle)
+{
+    return sim_client_procedure(Connection_Handle);
+}
+
+tBleStatus aci_gatt_write_char_desc(uint16_t Connection_Handle, uint16_t Attr_Handle, uint8_t Attribute_Val_Length,
+                                    uint8_t Attribute_Val[])
+{
+    return sim_client_procedure(Connection_Handle);
+}
+
+tBleStatus aci_gatt_confirm_indication(uint16_t Connection_Handle)
+{
+    simStats.aciCommands++;
+    return (sim_link(Connection_Handle) != NULL) ? BLE_STATUS_SUCCESS : ERR_UNKNOWN_CONN_IDENTIFIER;
+}
+
+/*
+ * Peer side, driven by the host application
+ */
+void BlueNRG1_Sim_Configure(const BlueNRG1_SimConfig_t *config)
+{
+    simConfig = *config;
+}
+
+int BlueNRG1_Sim_Connect(const uint8_t peerAddr[6])
+{
+    SimLink_t *link;
+
+    if (!advertising) {
+        return -1;
+    }
+    /* The simulated centrals use static random addresses */
+    if ((directedUntil != 0) && ((directedPeer.addrType != 0x01) || (memcmp(directedPeer.addr, peerAddr, 6) != 0))) {
+        return -1;
+    }
+    if ((advFilterPolicy & SIM_FILTER_CONN_REQS) && !sim_find_peer(whiteList, whiteListCount, 0x01, peerAddr)) {
+        return -1;
+    }
+    link = sim_open_link(SIM_ROLE_SLAVE, 0x01, peerAddr, simConfig.peerInterval);
+    if (link == NULL) {
+        return -1;
+    }
+    /* Connectable advertising stops on connection */
+    advertising   = 0;
+    directedUntil = 0;
+    sim_event(SIM_EVT_CONNECTION, link->handle, BLE_STATUS_SUCCESS);
+    Blue_Handler();
+    return link->handle;
+}
+
+int BlueNRG1_Sim_Disconnect(uint16_t connHandle, uint8_t reason)
+{
+    SimLink_t *link = sim_link(connHandle);
+
+    if (link == NULL) {
+        return -1;
+    }
+    sim_close_link(link, reason);
+    Blue_Handler();
+    return 0;
+}
+
+int BlueNRG1_Sim_Write(uint16_t connHandle, uint16_t attrHandle, const uint8_t *value, uint16_t length)
+{
+    SimLink_t *link = sim_link(connHandle);
+    SimAttr_t *attr = sim_attr(attrHandle);
+    SimEvent_t *event;
+
+    if ((link == NULL) || (attr == NULL) || (length > sizeof(event->data))) {
+        return -1;
+    }
+
+    if (attr->kind == SIM_ATTR_CCCD) {
+        attr->cccd[link - links] = (length > 1) ? (uint16_t)(value[0] | (value[1] << 8)) : value[0];
+    } else if (sim_set_value(attr, 0, length, value, length) != BLE_STATUS_SUCCESS) {
+        return -1;
+    }
+
+    event = sim_event(SIM_EVT_ATTR_MODIFIED, connHandle, BLE_STATUS_SUCCESS);
+    event->arg[0] = attrHandle;
+    event->length = (uint8_t)length;
+    memcpy(event->data, value, length);
+    Blue_Handler();
+    return 0;
+}
+
+int BlueNRG1_Sim_ExchangeMtu(uint16_t connHandle, uint16_t mtu)
+{
+    SimLink_t *link = sim_link(connHandle);
+
+    if (link == NULL) {
+        return -1;
+    }
+    link->attMtu = (mtu < simMaxAttMtu) ? mtu : simMaxAttMtu;
+    sim_event(SIM_EVT_MTU, connHandle, BLE_STATUS_SUCCESS)->arg[0] = link->attMtu;
+    Blue_Handler();
+    return 0;
+}
+
+int BlueNRG1_Sim_Advertise(uint8_t addrType, const uint8_t addr[6], const uint8_t *data, uint8_t length, int8_t rssi)
+{
+    SimAdvertiser_t *advertiser;
+
+    if ((advertiserCount >= SIM_ADVERTISERS) || (length > sizeof(advertiser->data))) {
+        return -1;
+    }
+    advertiser = &advertisers[advertiserCount++];
+    advertiser->addrType = addrType;
+    memcpy(advertiser->addr, addr, 6);
+    advertiser->length = length;
+    memcpy(advertiser->data, data, length);
+    advertiser->rssi = rssi;
+    return 0;
+}
+
+int BlueNRG1_Sim_SetRssi(uint16_t connHandle, int8_t rssi)
+{
+    SimLink_t *link = sim_link(connHandle);
+
+    if (link == NULL) {
+        return -1;
+    }
+    link->rssi = rssi;
+    return 0;
+}
+
+const BlueNRG1_SimStats_t *BlueNRG1_Sim_GetStats(void)
+{
+    return &simStats;
+}
+
+void BlueNRG1_Sim_ResetStats(void)
+{
+    uint32_t blocks = simStats.txPoolBlocks;
+
+    memset(&simStats, 0, sizeof(simStats));
+    simStats.txPoolBlocks = blocks;
+    simStats.txPoolPeak   = txBlocksUsed;
+}
@@ -0,0 +1,102 @@
+#ifndef __BLUENRG1_SIMACI_H__
+#define __BLUENRG1_SIMACI_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  * Host replacement of libbluenrg1_stack.a.
+  *
+  * The ACI commands, HCI events and virtual timers the port uses are
+  * emulated on a virtual clock that only moves in BlueNRG1_Sim_Advance():
+  *  - the GATT database assigns handles like the stack does, services
+  *    reserving Max_Attribute_Records handles and CCCDs following the
+  *    characteristic value;
+  *  - aci_hal_end_of_radio_activity_event follows the connection events
+  *    enabled with aci_hal_set_radio_activity_mask();
+  *  - notifications and indications take blocks from a TX pool of
+  *    mblockCount blocks, BLE_STATUS_INSUFFICIENT_RESOURCES when it is
+  *    exhausted, and leave on the next connection events of their link,
+  *    reported completed one packet per block;
+  *  - a security request pairs at once, or after aci_gap_pass_key_resp()
+  *    under MITM protection without fixed pin, and bonds the peer until
+  *    aci_gap_clear_security_db(); a bonded peer encrypts without pairing;
+  *  - with Secure Connections, MITM protection and display yes/no IO
+  *    capabilities the pairing waits for the Numeric Comparison answer;
+  *    a passkey or comparison left unanswered fails the pairing with a
+  *    timeout after 30 s, as SMP does;
+  *  - BlueNRG1_Sim_Connect() honours the connection filter policy of the
+  *    whitelist and directed advertising, which times out after 1.28 s;
+  *  - with the controller privacy of aci_gap_init(), connections are
+  *    reported by hci_le_enhanced_connection_complete_event, the peers in
+  *    the resolving list with a resolved identity address type; the
+  *    resolving list takes bonded peers only;
+  *  - events are queued and delivered by BTLE_StackTick(), after the sim
+  *    raised the radio interrupt with Blue_Handler().
+  *
+  * The simulated peers have no GATT database: client discoveries complete
+  * empty, the exchange MTU procedure answers with peerMtu.
+  *
+  * A host application replaces EventQueue::dispatch_forever() by a loop
+  * calling dispatch(0) (equeue_posix.c) and BlueNRG1_Sim_Advance() up to
+  * the earliest of BlueNRG1_Sim_NextDeadline() and the host Timeouts
+  * (host/mbed.h). CMakeLists.txt builds it so with the notification
+  * benchmark BlueNRG1_SimBench.cpp.
+  */
+
+typedef struct {
+    uint8_t  packetsPerEvent;  /**< Data packets each link sends per connection event. */
+    uint16_t peerMtu;          /**< RX MTU of the simulated peers. */
+    uint16_t peerInterval;     /**< Interval the simulated centrals connect with, 1.25 ms units. */
+    uint8_t  bdAddr[6];        /**< Returned by hci_read_bd_addr(). */
+} BlueNRG1_SimConfig_t;
+
+typedef struct {
+    uint32_t txPoolBlocks;       /**< mblockCount given to BlueNRG_Stack_Initialization(). */
+    uint32_t txPoolPeak;         /**< Most blocks in use at once. */
+    uint32_t txPoolRejects;      /**< Updates refused for lack of blocks. */
+    uint32_t notificationsQueued;
+    uint32_t notificationsSent;
+    uint64_t latencySumUs;       /**< Update accepted to packet sent, summed over notificationsSent. */
+    uint32_t latencyMaxUs;
+    uint32_t eventQueuePeak;     /**< Most events waiting for BTLE_StackTick(). */
+    uint32_t eventsDispatched;
+    uint32_t connectionEvents;
+    uint32_t stackTicks;
+    uint32_t aciCommands;
+} BlueNRG1_SimStats_t;
+
+void     BlueNRG1_Sim_Configure(const BlueNRG1_SimConfig_t *config);
+
+/* Virtual time in us */
+uint64_t BlueNRG1_Sim_Now(void);
+/* Next timer expiry or connection event, UINT64_MAX when idle */
+uint64_t BlueNRG1_Sim_NextDeadline(void);
+/* Move the virtual clock, running the connection events and timers met */
+void     BlueNRG1_Sim_Advance(uint32_t us);
+
+/* A central with a static random address connects to the advertising device, returns the handle or -1 */
+int      BlueNRG1_Sim_Connect(const uint8_t peerAddr[6]);
+/* The peer of a link disconnects */
+int      BlueNRG1_Sim_Disconnect(uint16_t connHandle, uint8_t reason);
+/* The peer writes an attribute, CCCDs included */
+int      BlueNRG1_Sim_Write(uint16_t connHandle, uint16_t attrHandle, const uint8_t *value, uint16_t length);
+/* The peer starts the exchange MTU procedure */
+int      BlueNRG1_Sim_ExchangeMtu(uint16_t connHandle, uint16_t mtu);
+/* A peripheral advertises: reported while scanning, connectable by aci_gap_create_connection() */
+int      BlueNRG1_Sim_Advertise(uint8_t addrType, const uint8_t addr[6], const uint8_t *data, uint8_t length,
+                                int8_t rssi);
+/* RSSI hci_read_rssi() returns for a link, -60 dBm when connected */
+int      BlueNRG1_Sim_SetRssi(uint16_t connHandle, int8_t rssi);
+
+const BlueNRG1_SimStats_t *BlueNRG1_Sim_GetStats(void);
+void     BlueNRG1_Sim_ResetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__BLUENRG1_SIMACI_H__
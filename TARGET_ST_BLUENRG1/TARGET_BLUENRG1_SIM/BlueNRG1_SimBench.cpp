@@ -0,0 +1,360 @@
+/**
+  * Notification path benchmark of the port, on the host simulation of the
+  * BlueNRG-1 stack (BlueNRG1_SimAci.c).
+  *
+  * The application of source/main.cpp is reproduced without its sensor:
+  * the Heart Rate service is notified every period to the centrals that
+  * subscribed, from an EventQueue (equeue_posix.c) which the loop of run()
+  * dispatches while the virtual clock moves to the next deadline of the
+  * sim or of a Timeout.
+  *
+  * Usage: bluenrg1_sim_bench [links [period_ms [seconds [interval]]]]
+  *   links     centrals connected and subscribed, [1:BLE_MAX_LINKS]
+  *   period_ms time between two heart rate measurements
+  *   seconds   virtual time measured, after the connections are set up
+  *   interval  connection interval of the centrals, 1.25 ms units
+  *
+  * The metrics of the measured time are printed one per line; the exit
+  * status is not zero when the notification path allocated memory,
+  * nothing was sent or onDataSent counted more updates than were sent.
+  */
+#include <events/mbed_events.h>
+#include <mbed.h>
+#include "ble/BLE.h"
+#include "ble/Gap.h"
+#include "app_gatt_db.h"
+#include "ble/services/HeartRateService.h"
+#include "BlueNRG1_Gap.h"
+#include "BlueNRG1_GattServer.h"
+#include "BlueNRG1_Links.h"
+#include "BlueNRG1_SimAci.h"
+
+/* Setup steps, virtual time */
+static const uint32_t SETUP_STEP_US = 100000;
+
+static EventQueue eventQueue(/* event count */ 16 * EVENTS_EVENT_SIZE);
+
+static HeartRateService *hrServicePtr;
+
+MBED_STATIC_ASSERT(HeartRateService::MAX_VALUE_BYTES == HeartRateGattDb::MAX_VALUE_LEN,
+                   "HeartRateService and app_gatt_db.h disagree on the measurement size");
+static uint16_t hrmCounter = 60;
+static uint8_t  linkCount  = 2;
+static uint32_t periodMs   = 1000;
+static uint32_t seconds    = 60;
+static uint16_t interval   = 24;
+static uint8_t  connectionCount;
+
+static Timeout  measurementTimer;
+static uint32_t measurements;
+static uint32_t updatesSent;     /* Reported by onDataSent */
+
+/* Depth of the queues, sampled after each dispatch */
+static struct {
+    uint32_t posted;         /* processEvents calls waiting on the EventQueue */
+    uint32_t postedPeak;
+    uint32_t processEvents;
+    uint32_t pendingPeak;    /* Updates the GATT server parks for TX buffers, all links */
+} queues;
+
+/*
+ * Allocation counters: operator new goes through malloc, wrapped at link time
+ */
+static struct {
+    uint32_t count;
+    uint64_t bytes;
+} allocations;
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_calloc(size_t count, size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    allocations.count++;
+    allocations.bytes += size;
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t count, size_t size)
+{
+    allocations.count++;
+    allocations.bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+    allocations.count++;
+    allocations.bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = malloc(size);
+    if (ptr == NULL) {
+        abort();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+/*
+ * Application
+ */
+void processEvents()
+{
+    queues.posted--;
+    queues.processEvents++;
+    BLE::Instance().processEvents();
+}
+
+void scheduleBleEventsProcessing(BLE::OnEventsToProcessCallbackContext *context)
+{
+    (void)context;
+    if (eventQueue.call(processEvents) != 0) {
+        queues.posted++;
+        if (queues.posted > queues.postedPeak) {
+            queues.postedPeak = queues.posted;
+        }
+    }
+}
+
+void connectionCallback(const Gap::ConnectionCallbackParams_t *params)
+{
+    (void)params;
+    connectionCount++;
+    if (connectionCount < linkCount) {
+        BlueNRG1_Gap::getInstance().startSlowAdvertising();
+    }
+}
+
+void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *params)
+{
+    (void)params;
+    connectionCount--;
+}
+
+void dataSentCallback(unsigned count)
+{
+    updatesSent += count;
+}
+
+void updateSensorValue()
+{
+    hrmCounter = (hrmCounter < 180) ? hrmCounter + 1 : 60;
+    hrServicePtr->addRRInterval((uint16_t)((60 * 1024) / hrmCounter));
+    hrServicePtr->updateHeartRate(hrmCounter, BlueNRG1_GattServer::getInstance().getMaxPayload());
+    measurements++;
+}
+
+/* Timeout interrupt: the measurement goes to the event loop, like the DMA interrupt of main.cpp */
+void onMeasurementTimer()
+{
+    measurementTimer.attach_us(onMeasurementTimer, (us_timestamp_t)periodMs * 1000);
+    eventQueue.call(updateSensorValue);
+}
+
+void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
+{
+    BLE &ble = params->ble;
+
+    if (params->error != BLE_ERROR_NONE) {
+        error("BLE init failed: %d", params->error);
+    }
+
+    ble.gap().onConnection(connectionCallback);
+    ble.gap().onDisconnection(disconnectionCallback);
+    ble.gattServer().onDataSent(dataSentCallback);
+
+    hrServicePtr = new HeartRateService(ble, hrmCounter, HeartRateService::LOCATION_FINGER);
+
+    static const uint16_t uuid16_list[] = {GattService::UUID_HEART_RATE_SERVICE};
+    ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
+    ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS, (uint8_t *)uuid16_list, sizeof(uuid16_list));
+    ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED);
+    ble.gap().setAdvertisingInterval(1000);
+    ble.gap().startAdvertising();
+}
+
+/*
+ * Virtual time
+ */
+static void sampleQueues(void)
+{
+    uint32_t pending = 0;
+
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().at(i);
+        if (link->connected) {
+            pending += BlueNRG1_GattServer::getInstance().getPendingCount(link->handle);
+        }
+    }
+    if (pending > queues.pendingPeak) {
+        queues.pendingPeak = pending;
+    }
+}
+
+/* Dispatch the EventQueue and move the clock from deadline to deadline */
+static void run(uint64_t us)
+{
+    uint64_t until = BlueNRG1_Sim_Now() + us;
+
+    for (;;) {
+        eventQueue.dispatch(0);
+        sampleQueues();
+
+        uint64_t now  = BlueNRG1_Sim_Now();
+        uint64_t next = BlueNRG1_Sim_NextDeadline();
+        if (Timeout::nextDeadline() < next) {
+            next = Timeout::nextDeadline();
+        }
+        if (next > until) {
+            BlueNRG1_Sim_Advance((uint32_t)(until - now));
+            eventQueue.dispatch(0);
+            return;
+        }
+        BlueNRG1_Sim_Advance((uint32_t)((next > now) ? next - now : 0));
+        Timeout::expire(BlueNRG1_Sim_Now());
+    }
+}
+
+static void subscribe(uint16_t connHandle)
+{
+    static const uint8_t enable[2] = { 0x01, 0x00 };
+
+    for (uint16_t handle = 1; handle < 0x100; handle++) {
+        const BlueNRG1_AttrEntry_t *entry = BlueNRG1_GattServer::getInstance().findAttribute(handle);
+        if ((entry != NULL) && (entry->type == BLUENRG1_ATTR_CCCD)) {
+            BlueNRG1_Sim_Write(connHandle, handle, enable, sizeof(enable));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        linkCount = (uint8_t)atoi(argv[1]);
+    }
+    if (argc > 2) {
+        periodMs = (uint32_t)atoi(argv[2]);
+    }
+    if (argc > 3) {
+        seconds = (uint32_t)atoi(argv[3]);
+    }
+    if (argc > 4) {
+        interval = (uint16_t)atoi(argv[4]);
+    }
+    if ((linkCount < 1) || (linkCount > BLE_MAX_LINKS) || (periodMs == 0) || (seconds == 0) || (interval < 6)) {
+        fprintf(stderr, "usage: %s [links [period_ms [seconds [interval]]]], links in [1:%d]\n",
+                argv[0], BLE_MAX_LINKS);
+        return EXIT_FAILURE;
+    }
+
+    BlueNRG1_SimConfig_t config = {
+        4,                 /* packetsPerEvent */
+        BLE_MAX_ATT_MTU,   /* peerMtu */
+        interval,          /* peerInterval */
+        { 0x01, 0x00, 0x00, 0xE1, 0x80, 0x02 }
+    };
+    BlueNRG1_Sim_Configure(&config);
+
+    BLE &ble = BLE::Instance();
+    ble.onEventsToProcess(scheduleBleEventsProcessing);
+    ble.init(bleInitComplete);
+    run(SETUP_STEP_US);
+
+    for (uint8_t i = 0; i < linkCount; i++) {
+        const uint8_t peer[6] = { (uint8_t)(0x10 + i), 0x00, 0x00, 0x00, 0x00, 0xC0 };
+        int handle = BlueNRG1_Sim_Connect(peer);
+
+        if (handle < 0) {
+            fprintf(stderr, "central %u could not connect\n", i);
+            return EXIT_FAILURE;
+        }
+        run(SETUP_STEP_US);
+        BlueNRG1_Sim_ExchangeMtu((uint16_t)handle, BLE_MAX_ATT_MTU);
+        subscribe((uint16_t)handle);
+        run(SETUP_STEP_US);
+    }
+
+    /* Measured part: the setup allocations and traffic are left out */
+    uint32_t setupAllocations = allocations.count;
+    allocations.count = 0;
+    allocations.bytes = 0;
+    memset(&queues, 0, sizeof(queues));
+    updatesSent = 0;
+    BlueNRG1_Sim_ResetStats();
+
+    measurementTimer.attach_us(onMeasurementTimer, (us_timestamp_t)periodMs * 1000);
+    run((uint64_t)seconds * 1000000);
+    measurementTimer.detach();
+
+    const BlueNRG1_SimStats_t *stats = BlueNRG1_Sim_GetStats();
+    /* Only the advertising of the boot looks for a collector at the fast interval */
+    uint32_t fastPhases = BlueNRG1_Gap::getInstance().getAdvScheduler().getStats().fastPhases;
+    uint32_t dropped = 0;
+    for (uint8_t i = 0; i < BLE_MAX_LINKS; i++) {
+        BlueNRG1_Link_t *link = BlueNRG1_Links::getInstance().at(i);
+        if (link->connected) {
+            dropped += link->quality.dropped;
+        }
+    }
+
+    printf("links                     %u\n", connectionCount);
+    printf("period_ms                 %lu\n", (unsigned long)periodMs);
+    printf("virtual_s                 %lu\n", (unsigned long)seconds);
+    printf("measurements              %lu\n", (unsigned long)measurements);
+    printf("notifications_queued      %lu\n", (unsigned long)stats->notificationsQueued);
+    printf("notifications_sent        %lu\n", (unsigned long)stats->notificationsSent);
+    printf("notifications_dropped     %lu\n", (unsigned long)dropped);
+    printf("updates_sent_reported     %lu\n", (unsigned long)updatesSent);
+    printf("latency_avg_us            %lu\n", (unsigned long)((stats->notificationsSent > 0)
+                                                              ? stats->latencySumUs / stats->notificationsSent : 0));
+    printf("latency_max_us            %lu\n", (unsigned long)stats->latencyMaxUs);
+    printf("tx_pool_blocks            %lu\n", (unsigned long)stats->txPoolBlocks);
+    printf("tx_pool_peak              %lu\n", (unsigned long)stats->txPoolPeak);
+    printf("tx_pool_rejects           %lu\n", (unsigned long)stats->txPoolRejects);
+    printf("stack_event_queue_peak    %lu\n", (unsigned long)stats->eventQueuePeak);
+    printf("port_pending_queue_peak   %lu\n", (unsigned long)queues.pendingPeak);
+    printf("app_event_queue_peak      %lu\n", (unsigned long)queues.postedPeak);
+    printf("process_events            %lu\n", (unsigned long)queues.processEvents);
+    printf("stack_ticks               %lu\n", (unsigned long)stats->stackTicks);
+    printf("connection_events         %lu\n", (unsigned long)stats->connectionEvents);
+    printf("aci_commands              %lu\n", (unsigned long)stats->aciCommands);
+    printf("adv_fast_phases           %lu\n", (unsigned long)fastPhases);
+    printf("allocations_setup         %lu\n", (unsigned long)setupAllocations);
+    printf("allocations_measured      %lu\n", (unsigned long)allocations.count);
+    printf("allocated_bytes_measured  %lu\n", (unsigned long)allocations.bytes);
+
+    if ((connectionCount != linkCount) || (stats->notificationsSent == 0) || (allocations.count != 0) ||
+        (fastPhases != 1) || (updatesSent > stats->notificationsSent)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/**
+  * Flash of the simulation build: the NOLOAD areas declared by btle.h and
+  * BlueNRG1_GattCache.cpp (see host/compiler.h), erased at start, and the
+  * FLASH_xxx() functions of host/BlueNRG1_flash.h programming them.
+  *
+  * Addresses are host addresses truncated to 32 bits like on the target:
+  * the benchmark is linked without PIE so that the arrays sit below 4 GB.
+  */
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "BlueNRG1_flash.h"
+
+#define SIM_FLASH_ERASED    0xFFFFFFFF
+#define SIM_ERASED(words)   { [0 ... (words) - 1] = SIM_FLASH_ERASED }
+
+/* TOTAL_FLASH_BUFFER_SIZE(FLASH_SEC_DB_SIZE, FLASH_SERVER_DB_SIZE) of btle.h, rounded up */
+#define SIM_STACKLIB_FLASH_WORDS    (4096 >> 2)
+/* BLE_GATT_CACHE_PAGE_SIZE of BlueNRG1_GattCache.h, one page */
+#define SIM_GATT_CACHE_WORDS        (N_BYTES_PAGE >> 2)
+
+uint32_t stacklib_flash_data[SIM_STACKLIB_FLASH_WORDS] __attribute__((aligned(N_BYTES_PAGE))) =
+    SIM_ERASED(SIM_STACKLIB_FLASH_WORDS);
+uint8_t  stacklib_stored_device_id_data[56] = { [0 ... 55] = 0xFF };
+uint32_t gatt_cache_flash_data[SIM_GATT_CACHE_WORDS] __attribute__((aligned(N_BYTES_PAGE))) =
+    SIM_ERASED(SIM_GATT_CACHE_WORDS);
+
+static uint32_t *sim_flash_word(uint32_t address)
+{
+    assert((address & 3) == 0);
+    return (uint32_t *)(uintptr_t)address;
+}
+
+void FLASH_ErasePage(uint16_t PageNumber)
+{
+    uint32_t *page = sim_flash_word(FLASH_START + (uint32_t)PageNumber * N_BYTES_PAGE);
+
+    memset(page, 0xFF, N_BYTES_PAGE);
+}
+
+uint32_t FLASH_ReadWord(uint32_t Address)
+{
+    return *sim_flash_word(Address);
+}
+
+/* Programming only clears bits, like the NOR array */
+void FLASH_ProgramWord(uint32_t Address, uint32_t Data)
+{
+    *sim_flash_word(Address) &= Data;
+}
+
+void FLASH_ProgramWordBurst(uint32_t Address, uint32_t *Data)
+{
+    uint8_t i;
+
+    for (i = 0; i < 4; i++) {
+        FLASH_ProgramWord(Address + 4 * i, Data[i]);
+    }
+}
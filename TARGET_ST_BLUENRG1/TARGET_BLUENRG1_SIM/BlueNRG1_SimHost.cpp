@@ -0,0 +1,156 @@
+/**
+  * Host runtime of the simulation build: the mbed platform functions the
+  * port calls, on the virtual clock of BlueNRG1_SimAci.c.
+  *
+  * Everything runs in the thread of the benchmark, the radio interrupt and
+  * the timeouts included: critical sections have nothing to mask.
+  */
+#include <stdarg.h>
+
+#include "mbed.h"
+#include "BlueNRG1_SimAci.h"
+
+/*
+ * us ticker
+ */
+extern "C" uint32_t us_ticker_read(void)
+{
+    return (uint32_t)BlueNRG1_Sim_Now();
+}
+
+/*
+ * Critical sections
+ */
+extern "C" void core_util_critical_section_enter(void)
+{
+}
+
+extern "C" void core_util_critical_section_exit(void)
+{
+}
+
+extern "C" bool core_util_are_interrupts_enabled(void)
+{
+    return true;
+}
+
+extern "C" bool core_util_is_isr_active(void)
+{
+    return false;
+}
+
+/*
+ * Errors: a failed assertion ends the benchmark
+ */
+extern "C" void mbed_assert_internal(const char *expr, const char *file, int line)
+{
+    fprintf(stderr, "mbed assertation failed: %s, file: %s, line %d\n", expr, file, line);
+    abort();
+}
+
+extern "C" void error(const char *format, ...)
+{
+    va_list arg;
+
+    va_start(arg, format);
+    vfprintf(stderr, format, arg);
+    va_end(arg);
+    fputc('\n', stderr);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Sleep manager: the benchmark advances the clock itself
+ */
+extern "C" void sleep_manager_lock_deep_sleep(void)
+{
+}
+
+extern "C" void sleep_manager_unlock_deep_sleep(void)
+{
+}
+
+extern "C" bool sleep_manager_can_deep_sleep(void)
+{
+    return true;
+}
+
+extern "C" void sleep_manager_sleep_auto(void)
+{
+}
+
+/*
+ * Timeout on the virtual clock
+ */
+namespace mbed {
+
+Timeout *Timeout::attached = NULL;
+
+Timeout::Timeout() : function(), deadline(0), next(NULL)
+{
+}
+
+Timeout::~Timeout()
+{
+    unlink();
+}
+
+void Timeout::unlink(void)
+{
+    for (Timeout **it = &attached; *it != NULL; it = &(*it)->next) {
+        if (*it == this) {
+            *it = next;
+            break;
+        }
+    }
+    next = NULL;
+}
+
+void Timeout::attach_us(Callback<void()> func, us_timestamp_t t)
+{
+    unlink();
+    function = func;
+    deadline = BlueNRG1_Sim_Now() + t;
+    next     = attached;
+    attached = this;
+}
+
+void Timeout::detach(void)
+{
+    unlink();
+    function = NULL;
+}
+
+uint64_t Timeout::nextDeadline(void)
+{
+    uint64_t deadline = UINT64_MAX;
+
+    for (Timeout *it = attached; it != NULL; it = it->next) {
+        if (it->deadline < deadline) {
+            deadline = it->deadline;
+        }
+    }
+
+    return deadline;
+}
+
+void Timeout::expire(uint64_t now)
+{
+    Timeout *it = attached;
+
+    while (it != NULL) {
+        if (it->deadline <= now) {
+            /* One shot: detached before the callback, which may attach it again */
+            Callback<void()> function = it->function;
+            it->detach();
+            if (function) {
+                function();
+            }
+            it = attached;
+        } else {
+            it = it->next;
+        }
+    }
+}
+
+} // namespace mbed
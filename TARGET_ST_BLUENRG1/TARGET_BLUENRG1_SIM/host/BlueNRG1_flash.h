@@ -0,0 +1,28 @@
+/**
+  * Host stand-in of the BlueNRG-1 flash driver header for the simulation
+  * build, implemented by BlueNRG1_SimFlash.c.
+  *
+  * There is no flash at a fixed address on the host: FLASH_START is 0 and
+  * the flash areas are host arrays, so that the addresses the port computes
+  * from them are the host addresses. The benchmark is linked without PIE
+  * to keep them in the 32 bits the driver takes.
+  */
+#ifndef BLUENRG1_FLASH_H
+#define BLUENRG1_FLASH_H
+
+#include <stdint.h>
+
+#define _MEMORY_FLASH_BEGIN_    0
+#define _MEMORY_FLASH_SIZE_     (160 * 1024)
+#define _MEMORY_BYTES_PER_PAGE_ (2048)
+
+#define FLASH_START             (_MEMORY_FLASH_BEGIN_)
+#define N_BYTES_WORD            (4)
+#define N_BYTES_PAGE            (_MEMORY_BYTES_PER_PAGE_)
+
+void     FLASH_ErasePage(uint16_t PageNumber);
+uint32_t FLASH_ReadWord(uint32_t Address);
+void     FLASH_ProgramWord(uint32_t Address, uint32_t Data);
+void     FLASH_ProgramWordBurst(uint32_t Address, uint32_t *Data);
+
+#endif /* BLUENRG1_FLASH_H */
@@ -0,0 +1,18 @@
+/**
+  * Host stand-in of the BlueNRG-1 PKA driver header for the simulation
+  * build: BlueNRG1_SimAci.c computes nothing, the interrupt is never raised.
+  */
+#ifndef BLUENRG1_PKA_H
+#define BLUENRG1_PKA_H
+
+#include <stdint.h>
+#include "hal_types.h"
+#include "cmsis.h"
+
+#define PKA_PROCEND     0x01
+#define PKA_IRQn        22
+
+static inline void PKA_ClearITPendingBit(uint8_t PkaFlag) { (void)PkaFlag; }
+static inline void PKA_ITConfig(uint8_t PkaFlag, FunctionalState NewState) { (void)PkaFlag; (void)NewState; }
+
+#endif /* BLUENRG1_PKA_H */
@@ -0,0 +1,23 @@
+/**
+  * Host stand-in of the CMSIS core functions the port and the mbed
+  * platform headers use, for the simulation build. The simulation runs in
+  * one thread, interrupts included: barriers only order the compiler.
+  */
+#ifndef MBED_CMSIS_H
+#define MBED_CMSIS_H
+
+#include <stdlib.h>
+
+#ifndef __INLINE
+#define __INLINE        inline
+#endif
+
+#define __DMB()         __sync_synchronize()
+#define __DSB()         __sync_synchronize()
+#define __ISB()         __sync_synchronize()
+#define __WFI()         do { } while (0)
+
+static inline void NVIC_EnableIRQ(int IRQn) { (void)IRQn; }
+static inline void NVIC_SystemReset(void) { exit(0); }
+
+#endif /* MBED_CMSIS_H */
@@ -0,0 +1,27 @@
+/**
+  * Host stand-in of the BlueNRG-1 compiler.h for the simulation build.
+  *
+  * The NOLOAD flash areas of btle.h and BlueNRG1_GattCache.cpp are only
+  * declared here: BlueNRG1_SimFlash.c defines them as erased, writable
+  * arrays, so that no constant is folded from their declaration and the
+  * FLASH_xxx() emulation can program them.
+  */
+#ifndef __COMPILER_H__
+#define __COMPILER_H__
+
+#define QUOTEME(a)                  #a
+#define REQUIRED(var)               var __attribute__((used))
+#define SECTION(name)
+#define ALIGN(N)                    __attribute__((aligned(N)))
+#define WEAK_FUNCTION(function)     __attribute__((weak)) function
+#define NORETURN_FUNCTION(function) __attribute__((noreturn)) function
+#define NOSTACK_FUNCTION(function)  function
+#define NO_INIT(var)                var
+#define NOLOAD(var)                 extern var
+#define NO_INIT_ZERO(var, sect)     var
+#define VARIABLE_SIZE               0
+
+/* IAR keyword of bluenrg1_gatt_server.h, the host layout does not matter */
+#define __packed
+
+#endif /* __COMPILER_H__ */
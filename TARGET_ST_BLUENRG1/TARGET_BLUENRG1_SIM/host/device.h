@@ -0,0 +1,8 @@
+/**
+  * Host stand-in of the target device.h: the simulation build has no
+  * peripherals, hal/ticker_api.h only needs the file to exist.
+  */
+#ifndef MBED_DEVICE_H
+#define MBED_DEVICE_H
+
+#endif
@@ -0,0 +1,63 @@
+/**
+  * Host stand-in of mbed.h for the simulation build (see CMakeLists.txt):
+  * the platform headers the port and the benchmark use, and a Timeout
+  * driven by the virtual clock of BlueNRG1_SimAci.c instead of the us ticker.
+  */
+#ifndef MBED_H
+#define MBED_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cmsis.h"
+#include "platform/mbed_toolchain.h"
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+#include "platform/mbed_error.h"
+#include "platform/mbed_sleep.h"
+#include "platform/Callback.h"
+#include "platform/NonCopyable.h"
+#include "hal/us_ticker_api.h"
+
+namespace mbed {
+
+/**
+  * One shot timer of the virtual clock: the callback runs from
+  * BlueNRG1_SimHost_Run() once BlueNRG1_Sim_Now() reached the deadline,
+  * in place of the us ticker interrupt.
+  */
+class Timeout : private NonCopyable<Timeout> {
+public:
+    Timeout();
+    ~Timeout();
+
+    void attach(Callback<void()> func, float t) {
+        attach_us(func, (us_timestamp_t)(t * 1000000.0f));
+    }
+    void attach_us(Callback<void()> func, us_timestamp_t t);
+    void detach(void);
+
+    /* Nearest deadline of the attached timeouts, UINT64_MAX without any */
+    static uint64_t nextDeadline(void);
+    /* Run the callbacks of the timeouts expired at now */
+    static void     expire(uint64_t now);
+
+private:
+    void            unlink(void);
+
+    Callback<void()> function;
+    uint64_t         deadline;
+    Timeout         *next;
+
+    static Timeout  *attached;
+};
+
+} // namespace mbed
+
+using namespace mbed;
+using namespace std;
+
+#endif
@@ -12,9 +12,14 @@
 
 /* This file contains all the information needed to init the BlueNRG-1 stack.
  * These constants and variables are used from the BlueNRG-1 stack to reserve RAM and FLASH
- * according the application requests
+ * according the application requests, as declared in app_gatt_db.h
  */
 
+#include "app_gatt_db.h"
+#include "BlueNRG1_Links.h"
+#include "BlueNRG1_OtaService.h"
+#include "BlueNRG1_Telemetry.h"
+
 
 /* Default number of link */
 #define MIN_NUM_LINK            1
@@ -23,56 +28,69 @@
 /* Default number of GAP and GATT attributes */
 #define DEFAULT_NUM_GATT_ATTRIBUTES 9
 
-#if defined (ST_OTA_LOWER_APPLICATION) || defined (ST_OTA_HIGHER_APPLICATION)
-/* Number of services requests from the Sensor demo */
-#define NUM_APP_GATT_SERVICES (2 + 1) /* 2 Sensor services + 1 OTA service */
-
-/* Number of attributes requests from the chat demo */
-#define NUM_APP_GATT_ATTRIBUTES (15 + 9) /* 15 attributes x BLE Sensor demo services characteristics + 9 for OTA Service characteristics */
-
-#define SENSOR_MAX_ATT_SIZE (20)
-
-#else /* NO OTA Service is required */
-
-/* Number of services requests from the sensor demo */
-#define NUM_APP_GATT_SERVICES 2
-
-/* Number of attributes requests from the sensor demo */
-#define NUM_APP_GATT_ATTRIBUTES 15
+/* Services, attributes and attribute value bytes of the OTA service (BlueNRG1_OtaService) */
+#if BLE_OTA
+#define OTA_GATT_SERVICES        (OtaGattDb::SERVICES)
+#define OTA_GATT_CHARACTERISTICS (OtaGattDb::CHARACTERISTICS)
+#define OTA_GATT_ATTRIBUTES      (OtaGattDb::ATTRIBUTES)
+#define OTA_ATT_VALUE_ARRAY_SIZE (OtaGattDb::VALUE_BYTES)
+#define OTA_MAX_ATT_SIZE         (OtaGattDb::MAX_VALUE_LEN)
+#else
+#define OTA_GATT_SERVICES        (0)
+#define OTA_GATT_CHARACTERISTICS (0)
+#define OTA_GATT_ATTRIBUTES      (0)
+#define OTA_ATT_VALUE_ARRAY_SIZE (0)       /* No OTA service is used */
+#define OTA_MAX_ATT_SIZE         (0)
+#endif
 
-#define SENSOR_MAX_ATT_SIZE (6)
+/* Same for the telemetry service (BlueNRG1_Telemetry) */
+#if BLE_TELEMETRY_SERVICE
+#define TELEMETRY_GATT_SERVICES        (TelemetryGattDb::SERVICES)
+#define TELEMETRY_GATT_CHARACTERISTICS (TelemetryGattDb::CHARACTERISTICS)
+#define TELEMETRY_GATT_ATTRIBUTES      (TelemetryGattDb::ATTRIBUTES)
+#define TELEMETRY_ATT_VALUE_ARRAY_SIZE (TelemetryGattDb::VALUE_BYTES)
+#define TELEMETRY_MAX_ATT_SIZE         (TelemetryGattDb::MAX_VALUE_LEN)
+#else
+#define TELEMETRY_GATT_SERVICES        (0)
+#define TELEMETRY_GATT_CHARACTERISTICS (0)
+#define TELEMETRY_GATT_ATTRIBUTES      (0)
+#define TELEMETRY_ATT_VALUE_ARRAY_SIZE (0)
+#define TELEMETRY_MAX_ATT_SIZE         (0)
 #endif
 
-/* Number of links needed for the demo: 1
- * Only 1 the default
- */
-#define NUM_LINKS               (MIN_NUM_LINK)
+/* Services the port adds besides the application ones */
+#define PORT_GATT_SERVICES        (OTA_GATT_SERVICES + TELEMETRY_GATT_SERVICES)
+#define PORT_GATT_CHARACTERISTICS (OTA_GATT_CHARACTERISTICS + TELEMETRY_GATT_CHARACTERISTICS)
+#define PORT_GATT_ATTRIBUTES      (OTA_GATT_ATTRIBUTES + TELEMETRY_GATT_ATTRIBUTES)
+#define PORT_ATT_VALUE_ARRAY_SIZE (OTA_ATT_VALUE_ARRAY_SIZE + TELEMETRY_ATT_VALUE_ARRAY_SIZE)
+#define PORT_MAX_ATT_SIZE         ((OTA_MAX_ATT_SIZE > TELEMETRY_MAX_ATT_SIZE) ? OTA_MAX_ATT_SIZE : TELEMETRY_MAX_ATT_SIZE)
 
-/* Maximum number of attribute records that can be added to the first application service: acceleration service */
-#define MAX_NUMBER_ATTRIBUTES_RECORDS_SERVICE_1 (7)
+/* Number of services requests from the application, see app_gatt_db.h */
+#define NUM_APP_GATT_SERVICES   (AppGattDb::SERVICES + PORT_GATT_SERVICES)
 
-/* Maximum number of attribute records that can be added to the second application service: environmental service */
-#define MAX_NUMBER_ATTRIBUTES_RECORDS_SERVICE_2 (10)
+/* Number of attributes requests from the application, see app_gatt_db.h */
+#define NUM_APP_GATT_ATTRIBUTES (AppGattDb::ATTRIBUTES + PORT_GATT_ATTRIBUTES)
 
-/* Number of GATT attributes needed for the sensor demo. */
+/* Number of links: one slot of the BlueNRG1_Links table each */
+#define NUM_LINKS               (BLE_MAX_LINKS)
+
+/* Number of GATT attributes needed for the application. */
 #define NUM_GATT_ATTRIBUTES     (DEFAULT_NUM_GATT_ATTRIBUTES + NUM_APP_GATT_ATTRIBUTES)
 
-/* Number of GATT services needed for the sensor demo. */
+/* Number of GATT services needed for the application. */
 #define NUM_GATT_SERVICES       (DEFAULT_NUM_GATT_SERVICES + NUM_APP_GATT_SERVICES)
 
-/* Array size for the attribute value for OTA service */
-#if defined (ST_OTA_LOWER_APPLICATION) || defined (ST_OTA_HIGHER_APPLICATION)
-#define OTA_ATT_VALUE_ARRAY_SIZE (119)    /* OTA service is used: 4 characteristics (1 notify property) */
-#else
-#define OTA_ATT_VALUE_ARRAY_SIZE (0)       /* No OTA service is used */
-#endif
+/* Attribute value bytes of the GAP and GATT services: 36 + Device Name */
+#define DEFAULT_ATT_VALUE_ARRAY_SIZE (36 + DEVICE_NAME_LEN)
+
+/* Attribute value bytes of the application, see app_gatt_db.h */
+#define APP_ATT_VALUE_ARRAY_SIZE (AppGattDb::VALUE_BYTES + PORT_ATT_VALUE_ARRAY_SIZE)
 
 /* Array size for the attribute value */
-#ifndef SENSOR_EMULATION
-#define ATT_VALUE_ARRAY_SIZE    (43 + 106  + OTA_ATT_VALUE_ARRAY_SIZE) //(GATT + GAP) = 43 (Device Name: BlueNRG) + Acceleration (Acceleration (27) + Free Fall (21) characteristics) +  Environmental Sensor (Temperature (28), Pressure (29)  characteristics)  Services
-#else
-#define ATT_VALUE_ARRAY_SIZE    (43 + 106 + 28 + OTA_ATT_VALUE_ARRAY_SIZE) //(GATT + GAP) = 43 (Device Name: BlueNRG) + Acceleration (Acceleration (27) + Free Fall (21) characteristics) +  Environmental Sensor (Temperature (28) , Pressure (29), Humidity (28) characteristics)  Services
-#endif
+#define ATT_VALUE_ARRAY_SIZE    (DEFAULT_ATT_VALUE_ARRAY_SIZE + APP_ATT_VALUE_ARRAY_SIZE)
+
+/* Biggest attribute value of the application */
+#define APP_MAX_ATT_SIZE        ((AppGattDb::MAX_VALUE_LEN > PORT_MAX_ATT_SIZE) ? AppGattDb::MAX_VALUE_LEN : PORT_MAX_ATT_SIZE)
 
 /* Flash security database size */
 #define FLASH_SEC_DB_SIZE       (0x400)
@@ -81,10 +99,10 @@
 #define FLASH_SERVER_DB_SIZE    (0x400)
 
 /* Set supported max value for ATT_MTU enabled by the application. Allowed values in range: [23:158] [New parameter added on BLE stack v2.x] */
-#define MAX_ATT_MTU             (DEFAULT_ATT_MTU)
+#define MAX_ATT_MTU             (BLE_MAX_ATT_MTU)
 
 /* Set supported max value for attribute size: it is the biggest attribute size enabled by the application */
-#define MAX_ATT_SIZE            (SENSOR_MAX_ATT_SIZE)
+#define MAX_ATT_SIZE            (APP_MAX_ATT_SIZE)
 
 /* Set the minumum number of prepare write requests needed for a long write procedure for a characteristic with len > 20bytes:
  *
@@ -106,6 +124,13 @@
 /* Set the total number of memory blocks for packet allocation [New parameter added on BLE stack v2.x] */
 #define PCKT_COUNT             (MIN_PCKT_COUNT + OPT_MBLOCKS)
 
+/* Fail the build when the application database does not fit the stack or the port */
+MBED_STATIC_ASSERT(MAX_ATT_SIZE <= DEFAULT_MAX_ATT_SIZE, "Attribute value longer than the BlueNRG-1 stack supports");
+MBED_STATIC_ASSERT((NUM_LINKS >= MIN_NUM_LINK) && (NUM_LINKS <= 8), "BLE_MAX_LINKS out of range [1:8]");
+MBED_STATIC_ASSERT((MAX_ATT_MTU >= DEFAULT_ATT_MTU) && (MAX_ATT_MTU <= DEFAULT_MAX_ATT_MTU), "MAX_ATT_MTU out of range [23:158]");
+MBED_STATIC_ASSERT(AppGattDb::CHARACTERISTICS + PORT_GATT_CHARACTERISTICS <= BLE_TOTAL_CHARACTERISTICS, "Too many characteristics for BLE_TOTAL_CHARACTERISTICS");
+MBED_STATIC_ASSERT(NUM_APP_GATT_ATTRIBUTES - AppGattDb::CHARACTERISTICS - PORT_GATT_CHARACTERISTICS <= BLE_TOTAL_ATTRIBUTES, "Too many attributes for BLE_TOTAL_ATTRIBUTES");
+
 /* RAM reserved to manage all the data stack according the number of links,
  * number of services, number of attributes and attribute value length
  */
@@ -186,4 +211,6 @@ const BlueNRG_Stack_Initialization_t BlueNRG_Stack_Init_params = {
 };
 
 
-#endif
\ No newline at end of file
+#endif /* _SENSORDEMO_CONFIG_H_ */
+
+#endif /* __BTLE_H__ */
@@ -0,0 +1,104 @@
+#!/usr/bin/env python
+"""
+Convert the records drained from BlueNRG1_Trace::read() to a btsnoop file
+Wireshark opens as an HCI H4 capture.
+
+The input is either the raw bytes of read(), or a console log where the
+application printed them in hex on lines starting with "T:" (other lines
+are ignored):
+
+    trace2btsnoop.py uart.log trace.btsnoop
+    trace2btsnoop.py --binary trace.bin trace.btsnoop
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+
+RECORD_HEADER = struct.Struct('<IBBH')   # timestamp, type, length, original length
+HEX_PREFIX = 'T:'
+
+TYPE_COMMAND = 0x01
+TYPE_EVENT = 0x04
+
+# btsnoop version 1, datalink 1002 (HCI UART, H4 indicator first)
+BTSNOOP_HEADER = b'btsnoop\0' + struct.pack('>II', 1, 1002)
+BTSNOOP_RECORD = struct.Struct('>IIIIq')
+# Microseconds from 0000-01-01 to 2000-01-01, the us_ticker has no epoch
+BTSNOOP_EPOCH = 0x00E03AB44A676000
+
+FLAG_RECEIVED = 0x01
+FLAG_COMMAND_EVENT = 0x02
+
+
+def read_input(path, binary):
+    if binary:
+        with open(path, 'rb') as f:
+            return f.read()
+
+    data = bytearray()
+    with open(path, 'r') as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith(HEX_PREFIX):
+                data += binascii.unhexlify(line[len(HEX_PREFIX):].strip().replace(' ', ''))
+    return bytes(data)
+
+
+def records(data):
+    pos = 0
+    while pos + RECORD_HEADER.size <= len(data):
+        timestamp, kind, length, original = RECORD_HEADER.unpack_from(data, pos)
+        pos += RECORD_HEADER.size
+        if pos + length > len(data):
+            sys.stderr.write('truncated record at offset %d\n' % (pos - RECORD_HEADER.size))
+            break
+        yield timestamp, kind, data[pos:pos + length], original
+        pos += length
+
+
+def convert(data, out):
+    out.write(BTSNOOP_HEADER)
+
+    wraps = 0
+    last = None
+    count = 0
+    for timestamp, kind, packet, original in records(data):
+        # us_ticker_read() wraps every 2^32 us
+        if last is not None and timestamp < last:
+            wraps += 1
+        last = timestamp
+        time_us = BTSNOOP_EPOCH + (wraps << 32) + timestamp
+
+        flags = FLAG_COMMAND_EVENT
+        if kind == TYPE_EVENT:
+            flags |= FLAG_RECEIVED
+        elif kind != TYPE_COMMAND:
+            sys.stderr.write('unknown record type 0x%02x\n' % kind)
+            continue
+
+        # The H4 indicator is part of the packet for datalink 1002
+        out.write(BTSNOOP_RECORD.pack(original + 1, len(packet) + 1, flags, 0, time_us))
+        out.write(struct.pack('B', kind))
+        out.write(packet)
+        count += 1
+
+    return count
+
+
+def main():
+    parser = argparse.ArgumentParser(description='BlueNRG1_Trace records to btsnoop')
+    parser.add_argument('input', help='console log with "T:" hex lines, or raw records with --binary')
+    parser.add_argument('output', help='btsnoop file to write')
+    parser.add_argument('--binary', action='store_true', help='input holds the raw bytes of read()')
+    args = parser.parse_args()
+
+    data = read_input(args.input, args.binary)
+    with open(args.output, 'wb') as out:
+        count = convert(data, out)
+    sys.stderr.write('%d packets written to %s\n' % (count, args.output))
+
+
+if __name__ == '__main__':
+    main()
@@ -19,6 +19,25 @@
 
 #include "ble/BLE.h"
 
+/**
+ * Size of the heart rate measurement characteristic value, flags included.
+ * The notifications never exceed it, whatever the ATT MTU of the links.
+ */
+#ifndef HEART_RATE_SERVICE_MAX_VALUE_BYTES
+#if defined(TARGET_ST_BLUENRG1)
+#error "HEART_RATE_SERVICE_MAX_VALUE_BYTES is set by the build configuration, see app_gatt_db.h"
+#else
+#define HEART_RATE_SERVICE_MAX_VALUE_BYTES 20
+#endif
+#endif
+
+/**
+ * Number of RR-intervals kept until a notification carries them.
+ */
+#ifndef HEART_RATE_SERVICE_RR_INTERVALS
+#define HEART_RATE_SERVICE_RR_INTERVALS 16
+#endif
+
 /**
  * BLE Heart Rate Service.
  *
@@ -46,12 +65,18 @@
  * is acquired; this function updates the value of the heart rate measurement
  * characteristic and notifies the new value to subscribed clients.
  *
+ * The measurement may also carry the sensor contact status, set with
+ * updateSensorContact(), the energy expended since the last reset, set with
+ * updateEnergyExpended(), and the RR-intervals measured since the previous
+ * measurement, queued with addRRInterval(). The RR-intervals accumulate in a
+ * ring of HEART_RATE_SERVICE_RR_INTERVALS entries; each measurement packs as
+ * many of them as the payload passed to updateHeartRate() holds, oldest
+ * first, and the rest waits for the next measurement. When the ring is full
+ * the oldest interval is dropped.
+ *
  * @note You can find specification of the heart rate service here:
  * https://www.bluetooth.com/specifications/gatt
  *
- * @important The service does not expose information related to the sensor
- * contact, the accumulated energy expanded or the interbeat intervals.
- *
  * @important The heart rate profile limits the number of instantiations of the
  * heart rate services to one.
  */
@@ -97,6 +122,12 @@ public:
         LOCATION_FOOT,
     };
 
+    /**
+     * Size of the heart rate measurement value this service was built with,
+     * for the applications sizing the GATT database of their stack.
+     */
+    static const unsigned MAX_VALUE_BYTES = HEART_RATE_SERVICE_MAX_VALUE_BYTES;
+
 public:
     /**
      * Construct and initialize a heart rate service.
@@ -143,12 +174,66 @@ public:
      * BLE stack.
      */
     void updateHeartRate(uint16_t hrmCounter) {
-        valueBytes.updateHeartRate(hrmCounter);
-        ble.gattServer().write(
+        updateHeartRate(hrmCounter, DEFAULT_MAX_PAYLOAD_BYTES);
+    }
+
+    /**
+     * Update the heart rate that the service exposes, in a notification of
+     * at most @p maxPayload bytes.
+     *
+     * The RR-intervals queued and the energy expended not notified yet are
+     * added to the measurement as long as it fits; what does not fit is
+     * notified with the next measurement.
+     *
+     * @param[in] hrmCounter Heart rate measured in BPM.
+     * @param[in] maxPayload Notification payload of the subscribed clients,
+     * ATT_MTU - 3 of the link with the smallest ATT MTU.
+     *
+     * @important This function must be called in the execution context of the
+     * BLE stack.
+     */
+    void updateHeartRate(uint16_t hrmCounter, uint16_t maxPayload) {
+        valueBytes.updateHeartRate(hrmCounter, maxPayload);
+        ble_error_t error = ble.gattServer().write(
             hrmRate.getValueHandle(),
             valueBytes.getPointer(),
             valueBytes.getNumValueBytes()
         );
+        if (error == BLE_ERROR_NONE) {
+            valueBytes.onSent();
+        }
+    }
+
+    /**
+     * Queue an RR-interval for the next measurements.
+     *
+     * @param[in] rrInterval Interval between two heart beats, in units of
+     * 1/1024 second.
+     */
+    void addRRInterval(uint16_t rrInterval) {
+        valueBytes.addRRInterval(rrInterval);
+    }
+
+    /**
+     * Set the energy expended carried by the next measurement.
+     *
+     * @param[in] energyExpended Energy expended since the last reset, in
+     * kilo Joules; 0xFFFF once the energy reaches or exceeds 65535 kJ.
+     */
+    void updateEnergyExpended(uint16_t energyExpended) {
+        valueBytes.updateEnergyExpended(energyExpended);
+    }
+
+    /**
+     * Report the sensor contact status in the next measurements.
+     *
+     * The measurements only report the sensor contact feature once this
+     * function has been called.
+     *
+     * @param[in] contactDetected Whether the sensor touches the skin.
+     */
+    void updateSensorContact(bool contactDetected) {
+        valueBytes.updateSensorContact(contactDetected);
     }
 
 protected:
@@ -170,31 +255,124 @@ protected:
     }
 
 protected:
+    /*
+     * Notification payload with the default ATT MTU of 23 bytes.
+     */
+    static const uint16_t DEFAULT_MAX_PAYLOAD_BYTES = 20;
+
     /*
      * Heart rate measurement value.
      */
     struct HeartRateValueBytes {
-        /* 1 byte for the Flags, and up to two bytes for heart rate value. */
-        static const unsigned MAX_VALUE_BYTES = 3;
+        /* 1 byte for the Flags, then the heart rate value, the energy
+         * expended and the RR-intervals. */
+        static const unsigned MAX_VALUE_BYTES = HeartRateService::MAX_VALUE_BYTES;
         static const unsigned FLAGS_BYTE_INDEX = 0;
 
         static const unsigned VALUE_FORMAT_BITNUM = 0;
         static const uint8_t  VALUE_FORMAT_FLAG = (1 << VALUE_FORMAT_BITNUM);
+        static const unsigned SENSOR_CONTACT_DETECTED_BITNUM = 1;
+        static const uint8_t  SENSOR_CONTACT_DETECTED_FLAG = (1 << SENSOR_CONTACT_DETECTED_BITNUM);
+        static const unsigned SENSOR_CONTACT_SUPPORTED_BITNUM = 2;
+        static const uint8_t  SENSOR_CONTACT_SUPPORTED_FLAG = (1 << SENSOR_CONTACT_SUPPORTED_BITNUM);
+        static const unsigned ENERGY_EXPENDED_BITNUM = 3;
+        static const uint8_t  ENERGY_EXPENDED_FLAG = (1 << ENERGY_EXPENDED_BITNUM);
+        static const unsigned RR_INTERVAL_BITNUM = 4;
+        static const uint8_t  RR_INTERVAL_FLAG = (1 << RR_INTERVAL_BITNUM);
+
+        static const unsigned MAX_RR_INTERVALS = HEART_RATE_SERVICE_RR_INTERVALS;
 
-        HeartRateValueBytes(uint16_t hrmCounter) : valueBytes()
+        HeartRateValueBytes(uint16_t hrmCounter) :
+            valueBytes(),
+            numValueBytes(0),
+            contactFlags(0),
+            energyExpendedPending(false),
+            energyExpended(0),
+            rrIntervalsHead(0),
+            rrIntervalsCount(0),
+            rrIntervalsPacked(0)
         {
-            updateHeartRate(hrmCounter);
+            updateHeartRate(hrmCounter, MAX_VALUE_BYTES);
         }
 
-        void updateHeartRate(uint16_t hrmCounter)
+        /*
+         * Encode a measurement of at most maxPayload bytes; the energy
+         * expended and the RR-intervals it carries stay pending until
+         * onSent().
+         */
+        void updateHeartRate(uint16_t hrmCounter, uint16_t maxPayload)
         {
+            unsigned limit = (maxPayload < MAX_VALUE_BYTES) ? maxPayload : MAX_VALUE_BYTES;
+            unsigned index = FLAGS_BYTE_INDEX + 1;
+            uint8_t  flags = contactFlags;
+
             if (hrmCounter <= 255) {
-                valueBytes[FLAGS_BYTE_INDEX] &= ~VALUE_FORMAT_FLAG;
-                valueBytes[FLAGS_BYTE_INDEX + 1] = hrmCounter;
+                valueBytes[index++] = hrmCounter;
             } else {
-                valueBytes[FLAGS_BYTE_INDEX] |= VALUE_FORMAT_FLAG;
-                valueBytes[FLAGS_BYTE_INDEX + 1] = (uint8_t)(hrmCounter & 0xFF);
-                valueBytes[FLAGS_BYTE_INDEX + 2] = (uint8_t)(hrmCounter >> 8);
+                flags |= VALUE_FORMAT_FLAG;
+                valueBytes[index++] = (uint8_t)(hrmCounter & 0xFF);
+                valueBytes[index++] = (uint8_t)(hrmCounter >> 8);
+            }
+
+            if (energyExpendedPending && ((index + sizeof(uint16_t)) <= limit)) {
+                flags |= ENERGY_EXPENDED_FLAG;
+                valueBytes[index++] = (uint8_t)(energyExpended & 0xFF);
+                valueBytes[index++] = (uint8_t)(energyExpended >> 8);
+            }
+
+            rrIntervalsPacked = 0;
+            while ((rrIntervalsPacked < rrIntervalsCount) && ((index + sizeof(uint16_t)) <= limit)) {
+                uint16_t rrInterval = rrIntervals[(rrIntervalsHead + rrIntervalsPacked) % MAX_RR_INTERVALS];
+                valueBytes[index++] = (uint8_t)(rrInterval & 0xFF);
+                valueBytes[index++] = (uint8_t)(rrInterval >> 8);
+                rrIntervalsPacked++;
+            }
+            if (rrIntervalsPacked > 0) {
+                flags |= RR_INTERVAL_FLAG;
+            }
+
+            valueBytes[FLAGS_BYTE_INDEX] = flags;
+            numValueBytes = index;
+        }
+
+        /*
+         * The last measurement encoded was accepted, forget what it carried.
+         */
+        void onSent(void)
+        {
+            if (valueBytes[FLAGS_BYTE_INDEX] & ENERGY_EXPENDED_FLAG) {
+                energyExpendedPending = false;
+            }
+            rrIntervalsHead = (rrIntervalsHead + rrIntervalsPacked) % MAX_RR_INTERVALS;
+            rrIntervalsCount -= rrIntervalsPacked;
+            rrIntervalsPacked = 0;
+        }
+
+        void addRRInterval(uint16_t rrInterval)
+        {
+            if (rrIntervalsCount == MAX_RR_INTERVALS) {
+                /* Drop the oldest, it may be part of the measurement encoded */
+                rrIntervalsHead = (rrIntervalsHead + 1) % MAX_RR_INTERVALS;
+                rrIntervalsCount--;
+                if (rrIntervalsPacked > 0) {
+                    rrIntervalsPacked--;
+                }
+            }
+            rrIntervals[(rrIntervalsHead + rrIntervalsCount) % MAX_RR_INTERVALS] = rrInterval;
+            rrIntervalsCount++;
+        }
+
+        void updateEnergyExpended(uint16_t energy)
+        {
+            energyExpended = energy;
+            energyExpendedPending = true;
+        }
+
+        void updateSensorContact(bool contactDetected)
+        {
+            contactFlags = SENSOR_CONTACT_SUPPORTED_FLAG;
+            if (contactDetected) {
+                contactFlags |= SENSOR_CONTACT_DETECTED_FLAG;
             }
         }
 
@@ -210,15 +388,22 @@ protected:
 
         unsigned getNumValueBytes(void) const
         {
-            if (valueBytes[FLAGS_BYTE_INDEX] & VALUE_FORMAT_FLAG) {
-                return 1 + sizeof(uint16_t);
-            } else {
-                return 1 + sizeof(uint8_t);
-            }
+            return numValueBytes;
         }
 
     private:
-        uint8_t valueBytes[MAX_VALUE_BYTES];
+        /* The smallest measurement, flags and a 16 bit value, must fit */
+        MBED_STATIC_ASSERT(MAX_VALUE_BYTES >= 3, "HEART_RATE_SERVICE_MAX_VALUE_BYTES too small");
+
+        uint8_t  valueBytes[MAX_VALUE_BYTES];
+        unsigned numValueBytes;
+        uint8_t  contactFlags;
+        bool     energyExpendedPending;
+        uint16_t energyExpended;
+        uint16_t rrIntervals[MAX_RR_INTERVALS];
+        unsigned rrIntervalsHead;
+        unsigned rrIntervalsCount;
+        unsigned rrIntervalsPacked;   /* RR-intervals of the last measurement encoded. */
     };
 
 protected:
@@ -0,0 +1,138 @@
+/* mbed Microcontroller Library
+ *******************************************************************************
+ * The ADC converts continuously and raises a DMA request per result. The DMA
+ * channel runs in circular mode over both halves of the buffer: the half
+ * transfer and transfer complete interrupts hand the half just filled to the
+ * application, which has until the DMA wraps around to process it in place.
+ * The CPU only wakes up twice per buffer, whatever the sample rate.
+ *******************************************************************************
+ */
+#include <string.h>
+#include "ppg_acquisition.h"
+#include "cmsis.h"
+#include "mbed_critical.h"
+#include "BlueNRG1_adc.h"
+#include "BlueNRG1_dma.h"
+#include "BlueNRG1_sysCtrl.h"
+
+#if PPG_ADC_OSR == 200
+#define PPG_ADC_OSR_SETTING     ADC_OSR_200
+#elif PPG_ADC_OSR == 100
+#define PPG_ADC_OSR_SETTING     ADC_OSR_100
+#elif PPG_ADC_OSR == 64
+#define PPG_ADC_OSR_SETTING     ADC_OSR_64
+#elif PPG_ADC_OSR == 32
+#define PPG_ADC_OSR_SETTING     ADC_OSR_32
+#else
+#error "PPG_ADC_OSR must be 200, 100, 64 or 32"
+#endif
+
+/* DMA channel taking the ADC requests */
+#define PPG_DMA_CHANNEL         DMA_CH0
+#define PPG_DMA_ADC_CHANNEL     DMA_ADC_CHANNEL0
+#define PPG_DMA_FLAG_HT         DMA_FLAG_HT0
+#define PPG_DMA_FLAG_TC         DMA_FLAG_TC0
+
+static int16_t samples[2][PPG_BUFFER_SAMPLES];
+static volatile uint8_t held[2];    /* Half handed to the application, not released yet */
+static ppg_buffer_handler_t buffer_handler = NULL;
+static ppg_acquisition_stats_t stats;
+
+void ppg_acquisition_start(ppg_buffer_handler_t handler)
+{
+    ADC_InitType adc;
+    DMA_InitType dma;
+
+    ppg_acquisition_stop();
+
+    buffer_handler = handler;
+    memset((void *)held, 0, sizeof(held));
+    memset(&stats, 0, sizeof(stats));
+
+    SysCtrl_PeripheralClockCmd(CLOCK_PERIPH_ADC | CLOCK_PERIPH_DMA, ENABLE);
+
+    /* One half word per conversion, from the result register to the buffer */
+    DMA_StructInit(&dma);
+    dma.DMA_PeripheralBaseAddr = (uint32_t)&ADC->DATA_CONV;
+    dma.DMA_MemoryBaseAddr     = (uint32_t)samples;
+    dma.DMA_DIR                = DMA_DIR_PeripheralSRC;
+    dma.DMA_BufferSize         = 2 * PPG_BUFFER_SAMPLES;
+    dma.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+    dma.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+    dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    dma.DMA_MemoryDataSize     = DMA_MemoryDataSize_HalfWord;
+    dma.DMA_Mode               = DMA_Mode_Circular;
+    dma.DMA_Priority           = DMA_Priority_High;
+    dma.DMA_M2M                = DMA_M2M_Disable;
+    DMA_Init(PPG_DMA_CHANNEL, &dma);
+    DMA_SelectAdcChannel(PPG_DMA_ADC_CHANNEL, ENABLE);
+    DMA_ClearFlag(PPG_DMA_FLAG_HT | PPG_DMA_FLAG_TC);
+    DMA_FlagConfig(PPG_DMA_CHANNEL, DMA_FLAG_HT | DMA_FLAG_TC, ENABLE);
+    NVIC_EnableIRQ(DMA_IRQn);
+    DMA_Cmd(PPG_DMA_CHANNEL, ENABLE);
+
+    ADC_StructInit(&adc);
+    adc.ADC_OSR              = PPG_ADC_OSR_SETTING;
+    adc.ADC_Input            = PPG_ADC_INPUT;
+    adc.ADC_ConversionMode   = ADC_ConversionMode_Continuous;
+    adc.ADC_Attenuation      = ADC_Attenuation_0dB;
+    adc.ADC_ReferenceVoltage = ADC_ReferenceVoltage_0V6;
+    ADC_Init(&adc);
+
+    /* Calibrated as the conversions start, the offset measured is then
+       subtracted from every result */
+    ADC_Calibration(ENABLE);
+    ADC_AutoOffsetUpdate(ENABLE);
+
+    ADC_DmaCmd(ENABLE);
+    ADC_Cmd(ENABLE);
+}
+
+void ppg_acquisition_stop(void)
+{
+    ADC_Cmd(DISABLE);
+    ADC_DmaCmd(DISABLE);
+    DMA_Cmd(PPG_DMA_CHANNEL, DISABLE);
+    DMA_FlagConfig(PPG_DMA_CHANNEL, DMA_FLAG_HT | DMA_FLAG_TC, DISABLE);
+    NVIC_DisableIRQ(DMA_IRQn);
+    buffer_handler = NULL;
+}
+
+void ppg_acquisition_release(const int16_t *buffer)
+{
+    held[(buffer == samples[0]) ? 0 : 1] = 0;
+}
+
+void ppg_acquisition_stats_get(ppg_acquisition_stats_t *res)
+{
+    core_util_critical_section_enter();
+    *res = stats;
+    core_util_critical_section_exit();
+}
+
+static void buffer_filled(uint8_t half)
+{
+    stats.buffers++;
+
+    /* Still in use: the event that has it will find the new samples there */
+    if (held[half]) {
+        stats.overruns++;
+        return;
+    }
+    if (buffer_handler != NULL) {
+        held[half] = 1;
+        buffer_handler(samples[half], PPG_BUFFER_SAMPLES);
+    }
+}
+
+void DMA_Handler(void)
+{
+    if (DMA_GetFlagStatus(PPG_DMA_FLAG_HT) == SET) {
+        DMA_ClearFlag(PPG_DMA_FLAG_HT);
+        buffer_filled(0);
+    }
+    if (DMA_GetFlagStatus(PPG_DMA_FLAG_TC) == SET) {
+        DMA_ClearFlag(PPG_DMA_FLAG_TC);
+        buffer_filled(1);
+    }
+}
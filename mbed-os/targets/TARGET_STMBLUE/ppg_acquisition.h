@@ -0,0 +1,68 @@
+/* mbed Microcontroller Library
+ *******************************************************************************
+ * Optical heart rate sensor sampled by the BlueNRG-1 ADC in continuous
+ * conversion, the results moved by DMA into two halves of a circular buffer.
+ *******************************************************************************
+ */
+#ifndef MBED_PPG_ACQUISITION_H
+#define MBED_PPG_ACQUISITION_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ADC input of the sensor, ADC_Input_AdcPin1 (A4) or ADC_Input_AdcPin2 (A5) */
+#ifndef PPG_ADC_INPUT
+#define PPG_ADC_INPUT           ADC_Input_AdcPin1
+#endif
+
+/* Decimation of the 1 MHz ADC clock: 200, 100, 64 or 32 */
+#ifndef PPG_ADC_OSR
+#define PPG_ADC_OSR             200
+#endif
+
+/* Conversions per second */
+#define PPG_SAMPLE_RATE_HZ      (1000000 / PPG_ADC_OSR)
+
+/* Samples of each half of the DMA buffer, 51.2 ms at 5 kHz */
+#ifndef PPG_BUFFER_SAMPLES
+#define PPG_BUFFER_SAMPLES      256
+#endif
+
+typedef struct {
+    uint32_t buffers;           /* Halves filled */
+    uint32_t overruns;          /* Halves filled again before ppg_acquisition_release() */
+} ppg_acquisition_stats_t;
+
+/** Called from the DMA interrupt with a half just filled
+ *
+ * The samples are the raw ADC results, two's complement. The DMA writes
+ * the other half meanwhile: the samples stay valid for one half period,
+ * PPG_BUFFER_SAMPLES / PPG_SAMPLE_RATE_HZ, and are handed back with
+ * ppg_acquisition_release().
+ */
+typedef void (*ppg_buffer_handler_t)(const int16_t *samples, uint16_t count);
+
+/** Calibrate the ADC and start the conversions
+ */
+void ppg_acquisition_start(ppg_buffer_handler_t handler);
+
+/** Stop the conversions and the DMA
+ */
+void ppg_acquisition_stop(void);
+
+/** The samples of a half are no longer used
+ */
+void ppg_acquisition_release(const int16_t *samples);
+
+/** Copy the buffer counters accumulated since the start
+ */
+void ppg_acquisition_stats_get(ppg_acquisition_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
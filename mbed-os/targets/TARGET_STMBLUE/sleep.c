@@ -0,0 +1,85 @@
+/* mbed Microcontroller Library
+ *******************************************************************************
+ * hal_deepsleep() asks the BLE stack for the deepest state it can afford and
+ * the time spent in every state is accumulated for sleep_residency_get().
+ *
+ * NOTE: in SLEEP_STATE_WAKETIMER and SLEEP_STATE_NOTIMER the BlueNRG-1 can
+ * power off its digital core, but the wake up goes through the reset vector
+ * and needs the CS_contextSave()/CS_contextRestore() pair, which is not part
+ * of this target (see __low_level_init in system_bluenrg1.c). Until then
+ * these states halt the CPU, and the radio interrupt that serves the stack
+ * virtual timers wakes it up: the time is booked as SLEEP_STATE_CPU_HALT and
+ * only the request is counted under the state the stack allowed.
+ *******************************************************************************
+ */
+#include <string.h>
+#include "sleep_api.h"
+#include "sleep_residency.h"
+#include "us_ticker_api.h"
+#include "cmsis.h"
+#include "mbed_critical.h"
+#include "mbed_toolchain.h"
+
+#if DEVICE_SLEEP
+
+static sleep_residency_t residency;
+static uint32_t last_wakeup = 0;
+
+MBED_WEAK uint8_t bluenrg1_sleep_check(void)
+{
+    return SLEEP_STATE_NOTIMER;
+}
+
+/* Called with interrupts disabled: a pending interrupt still ends the WFI */
+static void sleep_enter(sleep_state_t state)
+{
+    uint32_t start = us_ticker_read();
+
+    residency.time_us[SLEEP_STATE_RUNNING] += (uint32_t)(start - last_wakeup);
+
+    if (state != SLEEP_STATE_RUNNING) {
+        __WFI();
+    }
+
+    last_wakeup = us_ticker_read();
+    if (state != SLEEP_STATE_RUNNING) {
+        /* WFI whatever the stack allowed, see the note above */
+        residency.time_us[SLEEP_STATE_CPU_HALT] += (uint32_t)(last_wakeup - start);
+    }
+    residency.count[state]++;
+}
+
+void hal_sleep(void)
+{
+    sleep_enter(SLEEP_STATE_CPU_HALT);
+}
+
+void hal_deepsleep(void)
+{
+    uint8_t state = bluenrg1_sleep_check();
+
+    if (state >= SLEEP_STATE_COUNT) {
+        state = SLEEP_STATE_CPU_HALT;
+    }
+    /* SLEEP_STATE_RUNNING: the stack has work pending, return at once */
+    sleep_enter((sleep_state_t)state);
+}
+
+void sleep_residency_get(sleep_residency_t *res)
+{
+    core_util_critical_section_enter();
+    *res = residency;
+    /* Count the current running period as well */
+    res->time_us[SLEEP_STATE_RUNNING] += (uint32_t)(us_ticker_read() - last_wakeup);
+    core_util_critical_section_exit();
+}
+
+void sleep_residency_reset(void)
+{
+    core_util_critical_section_enter();
+    memset(&residency, 0, sizeof(residency));
+    last_wakeup = us_ticker_read();
+    core_util_critical_section_exit();
+}
+
+#endif
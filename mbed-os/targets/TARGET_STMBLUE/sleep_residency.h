@@ -0,0 +1,50 @@
+/* mbed Microcontroller Library
+ *******************************************************************************
+ * Time spent by the BlueNRG-1 in each of the states reported by
+ * BlueNRG_Stack_Perform_Deep_Sleep_Check().
+ *******************************************************************************
+ */
+#ifndef MBED_SLEEP_RESIDENCY_H
+#define MBED_SLEEP_RESIDENCY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same values as the stack SleepModes */
+typedef enum {
+    SLEEP_STATE_RUNNING   = 0,  /* Awake, or deep sleep refused by the stack */
+    SLEEP_STATE_CPU_HALT  = 1,  /* WFI */
+    SLEEP_STATE_WAKETIMER = 2,  /* Deep sleep allowed, a stack timer will wake up the device */
+    SLEEP_STATE_NOTIMER   = 3,  /* Deep sleep allowed, no stack timer running */
+    SLEEP_STATE_COUNT
+} sleep_state_t;
+
+typedef struct {
+    uint64_t time_us[SLEEP_STATE_COUNT];  /* Residency in the state entered, in microseconds: only
+                                             RUNNING and CPU_HALT until the target saves its context */
+    uint32_t count[SLEEP_STATE_COUNT];    /* Number of sleep requests the stack allowed this state */
+} sleep_residency_t;
+
+/** Copy the residency counters accumulated since boot or the last reset
+ */
+void sleep_residency_get(sleep_residency_t *residency);
+
+/** Clear the residency counters
+ */
+void sleep_residency_reset(void);
+
+/** Deepest state the BLE stack allows, a sleep_state_t
+ *
+ * Weak, the default allows SLEEP_STATE_NOTIMER. The BLE port overrides it
+ * with BlueNRG_Stack_Perform_Deep_Sleep_Check() once the stack is running.
+ */
+uint8_t bluenrg1_sleep_check(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __APP_GATT_DB_H__
+#define __APP_GATT_DB_H__
+
+#include "ble/GattCharacteristic.h"
+#include "BlueNRG1_GattDb.h"
+#include "BlueNRG1_Links.h"
+
+/* GATT database registered by the application, used by btle.h to size the
+ * BlueNRG-1 stack. Keep it in sync with the services added in main.cpp;
+ * the OTA and telemetry services of the port are counted by btle.h, and
+ * BlueNRG1_GattServer::addService() refuses services beyond these sizes.
+ */
+
+/* Heart Rate Measurement values up to the largest notification payload, for
+ * the RR-intervals. Every file including HeartRateService.h must see the
+ * same size, so it is set by the build: mbed_app.json, Heart.ewp and the
+ * simulator CMakeLists.txt define it as 155, the default BLE_MAX_ATT_MTU
+ * less the 3 bytes of the ATT header. Change them together with the MTU. */
+#ifndef HEART_RATE_SERVICE_MAX_VALUE_BYTES
+#error "HEART_RATE_SERVICE_MAX_VALUE_BYTES is set by the build configuration"
+#endif
+#if HEART_RATE_SERVICE_MAX_VALUE_BYTES > (BLE_MAX_ATT_MTU - 3)
+#error "HEART_RATE_SERVICE_MAX_VALUE_BYTES exceeds the notification payload of BLE_MAX_ATT_MTU"
+#endif
+
+/* Heart Rate service (HeartRateService.h):
+ *  - Heart Rate Measurement: notify, flags + 16 bit value + energy expended
+ *    + RR-intervals
+ *  - Body Sensor Location: read, 1 byte
+ */
+typedef BlueNRG1_GattDbService<BLUENRG1_UUID_16,
+            BlueNRG1_GattDbChar<BLUENRG1_UUID_16, HEART_RATE_SERVICE_MAX_VALUE_BYTES,
+                                GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY, true>,
+            BlueNRG1_GattDbChar<BLUENRG1_UUID_16, 1, GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ> > HeartRateGattDb;
+
+typedef BlueNRG1_GattDb<HeartRateGattDb> AppGattDb;
+
+#endif //__APP_GATT_DB_H__
@@ -18,45 +18,299 @@
 #include <mbed.h>
 #include "ble/BLE.h"
 #include "ble/Gap.h"
+#include "app_gatt_db.h"
 #include "ble/services/HeartRateService.h"
+#include "BlueNRG1_Links.h"
+#include "BlueNRG1_Gap.h"
+#include "BlueNRG1_GattClient.h"
+#include "BlueNRG1_GattServer.h"
+#include "BlueNRG1_OtaService.h"
+#include "BlueNRG1_SecurityManager.h"
+#include "BlueNRG1_Trace.h"
+#include "ppg_acquisition.h"
+
+/* Gateway build: collect the heart rate of up to MAX_ACTIVE_CONNECTIONS
+ * sensors instead of being one. Define HRM_COLLECTOR=1 and BLE_MAX_LINKS=7
+ * for the whole project. */
+#ifndef HRM_COLLECTOR
+#define HRM_COLLECTOR 0
+#endif
 
 DigitalOut led1(LED1, 1);
 
 const static char     DEVICE_NAME[] = "HRM";
 static const uint16_t uuid16_list[] = {GattService::UUID_HEART_RATE_SERVICE};
 
-static uint8_t hrmCounter = 100; // init HRM to 100bps
+static uint16_t hrmCounter = 100; // init HRM to 100bps, then the pulse rate measured
 static HeartRateService *hrServicePtr;
 
+/* btle.h reserved the stack memory for the measurement size of app_gatt_db.h */
+MBED_STATIC_ASSERT(HeartRateService::MAX_VALUE_BYTES == HeartRateGattDb::MAX_VALUE_LEN,
+                   "HeartRateService and app_gatt_db.h disagree on the measurement size");
+
 static EventQueue eventQueue(/* event count */ 16 * EVENTS_EVENT_SIZE);
 
+static uint8_t connectionCount = 0;
+
+#if !HRM_COLLECTOR
+/* The measurement is taken this long before the connection event that sends it */
+static const uint16_t SENSOR_LEAD_US = 2000;
+
+/* Only the bonded collectors may connect for this long, then anybody may pair */
+static const int BONDED_ADVERTISING_MS = 10000;
+static int reopenAdvertisingEvent = 0;
+
+/* The PPG is averaged down to this rate for the pulse detection */
+static const uint16_t PULSE_RATE_HZ = 100;
+static const uint16_t PULSE_DECIMATION = PPG_SAMPLE_RATE_HZ / PULSE_RATE_HZ;
+/* Pulses closer than 220 bpm are ignored, further than 30 bpm restart the intervals */
+static const uint16_t PULSE_MIN_INTERVAL = (60 * PULSE_RATE_HZ) / 220;
+static const uint16_t PULSE_MAX_INTERVAL = (60 * PULSE_RATE_HZ) / 30;
+
+static struct {
+    int32_t  sum;           // of the samples averaged so far
+    uint16_t count;
+    int32_t  baseline;      // DC level, 1/256 units
+    int32_t  amplitude;     // mean absolute AC level, 1/256 units
+    bool     rising;        // above the threshold since the last pulse
+    uint16_t sinceBeat;     // samples since the last pulse
+    bool     beatSeen;
+} pulse;
+#endif
+
+#if HRM_COLLECTOR
+static const uint8_t MAX_SENSORS = (MAX_ACTIVE_CONNECTIONS < BLE_MAX_LINKS) ? MAX_ACTIVE_CONNECTIONS : BLE_MAX_LINKS;
+
+/* Look for the Heart Rate service in the 16 bit UUID lists of the payload */
+static bool advertisesHeartRate(const Gap::AdvertisementCallbackParams_t *params)
+{
+    const uint8_t *data = params->advertisingData;
+    uint8_t pos = 0;
+
+    while ((pos + 1) < params->advertisingDataLen) {
+        uint8_t fieldLen  = data[pos];
+        uint8_t fieldType = data[pos + 1];
+
+        if ((fieldLen == 0) || ((pos + fieldLen) >= params->advertisingDataLen)) {
+            break;
+        }
+        if ((fieldType == GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS) ||
+            (fieldType == GapAdvertisingData::INCOMPLETE_LIST_16BIT_SERVICE_IDS)) {
+            for (uint8_t i = pos + 2; (i + 1) <= pos + fieldLen; i += 2) {
+                if ((data[i] | (data[i + 1] << 8)) == GattService::UUID_HEART_RATE_SERVICE) {
+                    return true;
+                }
+            }
+        }
+        pos += fieldLen + 1;
+    }
+
+    return false;
+}
+
+void advertisementCallback(const Gap::AdvertisementCallbackParams_t *params)
+{
+    if ((params->type != GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED) || !advertisesHeartRate(params)) {
+        return;
+    }
+
+    BlueNRG1_Gap &gap = BlueNRG1_Gap::getInstance();
+    gap.connect(params->peerAddr, gap.getReportAddressType(), NULL, NULL); // the scan resumes once connected
+}
+
+void startCollectorScan()
+{
+    if (connectionCount < MAX_SENSORS) {
+        BLE::Instance().gap().startScan(advertisementCallback); // no-op while scanning or connecting
+    }
+}
+
+void connectionCallback(const Gap::ConnectionCallbackParams_t *params)
+{
+    connectionCount++;
+    BlueNRG1_GattClient::getInstance().subscribeHeartRate(params->handle);
+    startCollectorScan();
+}
+
 void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *params)
 {
-    BLE::Instance().gap().startAdvertising(); // restart advertising
+    connectionCount--;
+    startCollectorScan();
 }
 
-void updateSensorValue() {
-    // Do blocking calls or whatever is necessary for sensor polling.
-    // In our case, we simply update the HRM measurement.
-    hrmCounter++;
+void printHeartRates()
+{
+    BlueNRG1_HrmSample_t sample;
+
+    while (BlueNRG1_GattClient::getInstance().readHeartRate(&sample)) {
+        printf("%lu %u %u\r\n", (unsigned long)sample.timestamp, sample.connHandle, sample.heartRate);
+    }
+}
+#else
+/* The fast advertising phase is there to find a collector, not to offer
+   the remaining slots once one is connected */
+ble_error_t advertise(bool fastPhase)
+{
+    if (fastPhase) {
+        return BLE::Instance().gap().startAdvertising();
+    }
+    return BlueNRG1_Gap::getInstance().startSlowAdvertising();
+}
+
+void reopenAdvertising()
+{
+    Gap &gap = BLE::Instance().gap();
+
+    if (gap.getState().advertising && (gap.getAdvertisingPolicyMode() != Gap::ADV_POLICY_IGNORE_WHITELIST)) {
+        bool fastPhase = (BlueNRG1_Gap::getInstance().getAdvScheduler().getPhase() == BlueNRG1_AdvScheduler::ADV_PHASE_FAST);
 
-    //  100 <= HRM bps <=175
-    if (hrmCounter == 175) {
-        hrmCounter = 100;
+        gap.stopAdvertising();
+        gap.setAdvertisingPolicyMode(Gap::ADV_POLICY_IGNORE_WHITELIST);
+        advertise(fastPhase);
     }
+}
 
-    hrServicePtr->updateHeartRate(hrmCounter);
+/* Advertise to the bonded collectors first, to anybody without bond */
+void startBondedAdvertising(bool fastPhase)
+{
+    Gap &gap = BLE::Instance().gap();
+
+    eventQueue.cancel(reopenAdvertisingEvent);
+    gap.stopAdvertising(); // the whitelist is not changed while in use
+    if (BlueNRG1_SecurityManager::getInstance().whitelistBondedPeers() == BLE_ERROR_NONE) {
+        gap.setAdvertisingPolicyMode(Gap::ADV_POLICY_FILTER_CONN_REQS);
+        reopenAdvertisingEvent = eventQueue.call_in(BONDED_ADVERTISING_MS, reopenAdvertising);
+    } else {
+        gap.setAdvertisingPolicyMode(Gap::ADV_POLICY_IGNORE_WHITELIST);
+    }
+    advertise(fastPhase);
 }
 
+void connectionCallback(const Gap::ConnectionCallbackParams_t *params)
+{
+    connectionCount++;
+    // encrypt with the keys of a bonded collector, or pair and bond
+    BLE::Instance().securityManager().setLinkSecurity(params->handle, SecurityManager::SECURITY_MODE_ENCRYPTION_NO_MITM);
+    if (connectionCount < BLE_MAX_LINKS) {
+        startBondedAdvertising(false); // keep a slot open for another collector
+    }
+}
+
+void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *params)
+{
+    BLEProtocol::AddressType_t  peerAddrType;
+    BLEProtocol::AddressBytes_t peerAddr;
+
+    connectionCount--;
+
+    // call a bonded collector back at once, the whitelist follows on the advertising timeout
+    if (BlueNRG1_SecurityManager::getInstance().getLastBondedPeer(&peerAddrType, peerAddr) &&
+        (BlueNRG1_Gap::getInstance().startDirectedAdvertising(peerAddrType, peerAddr) == BLE_ERROR_NONE)) {
+        return;
+    }
+    startBondedAdvertising(true);
+}
+
+void timeoutCallback(const Gap::TimeoutSource_t source)
+{
+    if (source == Gap::TIMEOUT_SRC_ADVERTISING) {
+        startBondedAdvertising(true); // the collector did not come back
+    }
+}
+
+/* A pulse: the interval since the previous one is an RR-interval */
+void onPulse()
+{
+    if (pulse.beatSeen && (pulse.sinceBeat <= PULSE_MAX_INTERVAL)) {
+        uint16_t rrInterval = (uint16_t)(((uint32_t)pulse.sinceBeat * 1024) / PULSE_RATE_HZ);
+
+        hrServicePtr->addRRInterval(rrInterval);
+        hrmCounter = (3 * hrmCounter + (60 * 1024) / rrInterval + 2) / 4;
+    }
+    pulse.beatSeen  = true;
+    pulse.sinceBeat = 0;
+}
+
+/* Rising edge of the AC part above twice its mean absolute level */
+void detectPulse(int32_t sample)
+{
+    pulse.baseline += ((sample << 8) - pulse.baseline) >> 6;
+
+    int32_t ac = sample - (pulse.baseline >> 8);
+    pulse.amplitude += (((ac < 0) ? -ac : ac) * 256 - pulse.amplitude) >> 7;
+
+    if (pulse.sinceBeat < UINT16_MAX) {
+        pulse.sinceBeat++;
+    }
+    if (ac < 0) {
+        pulse.rising = false;
+    } else if (!pulse.rising && (ac > (pulse.amplitude >> 7)) && (pulse.sinceBeat >= PULSE_MIN_INTERVAL)) {
+        pulse.rising = true;
+        onPulse();
+    }
+}
+
+/* A half of the DMA buffer, processed in place before the DMA comes back to it */
+void processPpgBuffer(const int16_t *samples, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        pulse.sum += samples[i];
+        if (++pulse.count == PULSE_DECIMATION) {
+            detectPulse(pulse.sum / PULSE_DECIMATION);
+            pulse.sum   = 0;
+            pulse.count = 0;
+        }
+    }
+    ppg_acquisition_release(samples);
+}
+
+/* DMA interrupt: the buffer goes to the event loop as it is */
+void onPpgBuffer(const int16_t *samples, uint16_t count)
+{
+    if (eventQueue.call(processPpgBuffer, samples, count) == 0) {
+        ppg_acquisition_release(samples);
+    }
+}
+
+void updateSensorValue() {
+    hrServicePtr->updateHeartRate(hrmCounter, BlueNRG1_GattServer::getInstance().getMaxPayload());
+}
+#endif
+
 void periodicCallback(void)
 {
     led1 = !led1; /* Do blinky on LED1 while we're waiting for BLE events */
 
+#if HRM_COLLECTOR
+    eventQueue.call(printHeartRates);
+    eventQueue.call(startCollectorScan); // after a failed connection attempt
+#else
     if (BLE::Instance().getGapState().connected) {
-        eventQueue.call(updateSensorValue);
+        BlueNRG1_RadioScheduler &scheduler = BlueNRG1_Gap::getInstance().getRadioScheduler();
+        if (scheduler.callBeforeConnectionEvent(updateSensorValue, SENSOR_LEAD_US) != BLE_ERROR_NONE) {
+            eventQueue.call(updateSensorValue);
+        }
     }
+#endif
 }
 
+#if BLE_TRACE
+/* Print the ACI/HCI trace on the console, for trace2btsnoop.py */
+void printTrace()
+{
+    uint8_t  buffer[2 * (8 + BLE_TRACE_PAYLOAD)];
+    uint16_t length;
+
+    while ((length = BlueNRG1_Trace::getInstance().read(buffer, sizeof(buffer))) > 0) {
+        printf("T:");
+        for (uint16_t i = 0; i < length; i++) {
+            printf("%02x", buffer[i]);
+        }
+        printf("\r\n");
+    }
+}
+#endif
+
 void onBleInitError(BLE &ble, ble_error_t error)
 {
     (void)ble;
@@ -91,10 +345,24 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
         return;
     }
 
+    ble.gap().onConnection(connectionCallback);
     ble.gap().onDisconnection(disconnectionCallback);
 
+#if HRM_COLLECTOR
+    ble.gap().setScanParams(100 /* interval ms */, 50 /* window ms */);
+    startCollectorScan();
+#else
+
+    /* Bond without IO: Just Works pairing, the keys stay in flash */
+    ble.securityManager().init(true, false, SecurityManager::IO_CAPS_NONE);
+    ble.gap().onTimeout(timeoutCallback);
+
     /* Setup primary service. */
     hrServicePtr = new HeartRateService(ble, hrmCounter, HeartRateService::LOCATION_FINGER);
+    ppg_acquisition_start(onPpgBuffer);
+#if BLE_OTA
+    BlueNRG1_OtaService::getInstance().init();
+#endif
 
     /* Setup advertising. */
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
@@ -102,8 +370,9 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::GENERIC_HEART_RATE_SENSOR);
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::COMPLETE_LOCAL_NAME, (uint8_t *)DEVICE_NAME, sizeof(DEVICE_NAME));
     ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED);
-    ble.gap().setAdvertisingInterval(1000); /* 1000ms */
-    ble.gap().startAdvertising();
+    ble.gap().setAdvertisingInterval(1000); /* 1000ms, once the fast advertising window is over */
+    startBondedAdvertising(true);
+#endif
 
     printMacAddress();
 }
@@ -116,6 +385,9 @@ void scheduleBleEventsProcessing(BLE::OnEventsToProcessCallbackContext* context)
 int main()
 {
     eventQueue.call_every(500, periodicCallback);
+#if BLE_TRACE
+    eventQueue.call_every(1000, printTrace);
+#endif
 
     BLE &ble = BLE::Instance();
     ble.onEventsToProcess(scheduleBleEventsProcessing);